@@ -1,6 +1,8 @@
 #include <algorithm>
+#include <array>
 #include <assimp/material.h>
 #include <assimp/types.h>
+#include <cstring>
 #include <format>
 #include <glm/ext/matrix_float4x4.hpp>
 #include <glm/ext/matrix_transform.hpp>
@@ -8,8 +10,10 @@
 #include <iterator>
 #include <random>
 #include <ranges>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <assimp/Importer.hpp>
@@ -28,7 +32,29 @@
 #include <filesystem>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <batch_math.hpp>
+#include <bloom.hpp>
+#include <bvh.hpp>
+#include <clustered.hpp>
+#include <command_list.hpp>
+#include <culling.hpp>
+#include <deferred.hpp>
+#include <dynamic_resolution.hpp>
+#include <ecs.hpp>
+#include <frame_arena.hpp>
+#include <jobs.hpp>
+#include <gpu_query.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <instancing.hpp>
+#include <occlusion.hpp>
+#include <post_process.hpp>
+#include <render_graph.hpp>
+#include <resources.hpp>
+#include <shadows.hpp>
+#include <transform.hpp>
+#include <transparency.hpp>
+#include <triple_buffer.hpp>
+#include <upload_ring.hpp>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -40,19 +66,11 @@
 
 namespace fs = std::filesystem;
 
-void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
-  glViewport(0, 0, width, height);
-}
-
 template <typename... Args> void console_log(Args... args) {
   (std::cout << ... << args) << std::endl;
 }
-static float deltaTime{};
-static float lastFrame = 0.0f;
 const static int width = 800;
 const static int height = 600;
-static float lastX = static_cast<float>(width) / 2;
-static float lastY = static_cast<float>(height) / 2;
 static float fov{45.0f};
 template <typename T> void print_vector(const T &vector) {
   for (std::size_t i = 0; i < vector.length(); i++) {
@@ -63,29 +81,77 @@ template <typename T> void print_vector(const T &vector) {
 const auto cameraPos = glm::vec3(.0f, .0f, 3.0f);
 const auto cameraFront = glm::vec3(.0f, .0f, -1.0f);
 const auto cameraUp = glm::vec3(.0f, 1.0f, .0f);
+// 只由模拟线程访问
 static cg::Camera camera{cameraPos, cameraFront, cameraUp};
 
-GLuint LoadTexture(const char *path, bool = false);
-GLuint TextureFromFile(const std::string &path, const std::string &dir) {
-  if (!fs::exists(dir)) {
-    throw std::runtime_error("dir not exists");
-  }
-  fs::path parent{dir};
-  fs::path file_path = parent / path;
-  GLuint textureID = LoadTexture(file_path.string().c_str());
-  return textureID;
+// 移动按键, 同时按下时取靠前的一个
+constexpr std::array moveKeys{GLFW_KEY_W,  GLFW_KEY_S,  GLFW_KEY_A,
+                              GLFW_KEY_D,  GLFW_KEY_UP, GLFW_KEY_DOWN};
+/**
+ * @brief GL 线程采样的输入快照, 每帧发布给模拟线程
+ * 光标位置和滚轮都是累计值, 由模拟线程求差, 被跳过的快照不会丢失移动
+ */
+struct InputState {
+  std::array<bool, moveKeys.size()> keys{};
+  double cursorX{}, cursorY{};
+  bool cursorValid{};
+  double scroll{};
+  // 帧缓冲的像素大小, 高 DPI 屏幕上大于窗口大小
+  int framebufferWidth{}, framebufferHeight{};
+};
+// 只由 GL 线程 (窗口回调) 访问
+static InputState input;
+
+// 只记录新的大小, 渲染目标在大小稳定之后由主循环重建
+void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
+  input.framebufferWidth = width;
+  input.framebufferHeight = height;
 }
+
+// 同一路径只加载一次, 失败时返回空句柄
+cg::TextureHandle LoadTexture(cg::ResourceManager &resources, const char *path,
+                              bool = false);
+/**
+ * @brief 解码后的图像: 解码可以在任意线程进行, 上传必须在 GL 线程
+ */
+struct Image {
+  unsigned char *data{};
+  int width{}, height{}, channels{};
+  const char *error{};
+};
+// 翻转方式由调用前的 stbi_set_flip_vertically_on_load 决定
+Image DecodeImage(const std::string &path);
+// 上传到已创建的纹理对象并释放图像数据, 失败时返回 false
+bool UploadTexture(GLuint texture, Image &image, bool clip);
 struct Vertex {
   glm::vec3 Position;
   glm::vec3 Normal;
   glm::vec2 TexCoords;
 };
 
-// 纹理贴图  材质
-struct Texture {
-  GLuint id;
-  std::string type;
-  aiString path;
+/**
+ * @brief 录制网格绘制用到的 uniform location, 每个着色器在 GL 线程上查一次
+ */
+struct MeshUniforms {
+  static constexpr int maxTextures = 4;
+  GLuint program;
+  GLint model, normalMatrix;
+  // material.texture_diffuseN / material.texture_specularN, N 从 1 开始
+  std::array<GLint, maxTextures> diffuse, specular;
+
+  static MeshUniforms of(const cg::Shader &shader) {
+    MeshUniforms uniforms{shader.ID};
+    uniforms.model = glGetUniformLocation(shader.ID, "model");
+    uniforms.normalMatrix = glGetUniformLocation(shader.ID, "normalMatrix");
+    for (int i{}; i < maxTextures; i++) {
+      auto n = std::to_string(i + 1);
+      uniforms.diffuse[i] = glGetUniformLocation(
+          shader.ID, ("material.texture_diffuse" + n).c_str());
+      uniforms.specular[i] = glGetUniformLocation(
+          shader.ID, ("material.texture_specular" + n).c_str());
+    }
+    return uniforms;
+  }
 };
 
 class Mesh {
@@ -94,20 +160,31 @@ public:
   // 网格数据
   std::vector<Vertex> vertices;
   std::vector<unsigned int> indices;
-  std::vector<Texture> textures;
-
-  Mesh(std::vector<Vertex> t_vertices, std::vector<unsigned int> t_indices,
-       std::vector<Texture> t_textures)
-      : vertices(t_vertices), indices(t_indices), textures(t_textures) {
-    setupMesh();
+  // 导入时计算的包围体 (模型空间)
+  cg::Aabb bounds;
+  cg::Sphere sphere;
+  // GL 对象和纹理归 ResourceManager 所有, 网格只保存句柄
+  cg::MeshHandle handle;
+  cg::MaterialHandle material;
+
+  Mesh(cg::ResourceManager &resources, std::vector<Vertex> t_vertices,
+       std::vector<unsigned int> t_indices,
+       std::vector<cg::MaterialTexture> t_textures, cg::Aabb t_bounds = {},
+       cg::Sphere t_sphere = {})
+      : vertices(t_vertices), indices(t_indices), bounds(t_bounds),
+        sphere(t_sphere) {
+    setupMesh(resources);
+    material = resources.addMaterial({{}, std::move(t_textures)});
   }
-  void Draw(cg::Shader);
+  // 只写入命令列表, 可以在工作线程调用
+  void record(cg::CommandList &list, const MeshUniforms &uniforms,
+              const cg::ResourceManager &resources) const;
 
 private:
-  GLuint VAO, VBO, EBO;
-  void setupMesh();
+  void setupMesh(cg::ResourceManager &resources);
 };
-void Mesh::setupMesh() {
+void Mesh::setupMesh(cg::ResourceManager &resources) {
+  GLuint VAO, VBO, EBO;
   glGenVertexArrays(1, &VAO);
   glGenBuffers(1, &VBO);
   glGenBuffers(1, &EBO);
@@ -130,52 +207,123 @@ void Mesh::setupMesh() {
   glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
                         (void *)offsetof(Vertex, TexCoords));
   glBindVertexArray(0);
+  handle = resources.addMesh(
+      {VAO, 0, static_cast<GLsizei>(indices.size()), true,
+       {resources.addBuffer(VBO), resources.addBuffer(EBO)}});
 }
-void Mesh::Draw(cg::Shader shader) {
-  shader.use();
-  unsigned int diffuseNr = 1;
-  unsigned int specularNr = 1;
+void Mesh::record(cg::CommandList &list, const MeshUniforms &uniforms,
+                  const cg::ResourceManager &resources) const {
+  const auto *mesh = resources.mesh(handle);
+  if (!mesh) {
+    return;
+  }
+  const auto &textures = resources.material(material)->textures;
+  int diffuseNr{}, specularNr{};
   for (std::size_t i{}; i < textures.size(); i++) {
-    glActiveTexture(GL_TEXTURE0 + i);
-    std::string name = textures[i].type;
-    std::string number{};
-    if (name == "texture_diffuse") {
-      number = std::to_string(diffuseNr++);
-    } else if (name == "texture_specular") {
-      number = std::to_string(specularNr++);
+    const auto &name = textures[i].type;
+    auto unit = static_cast<GLint>(i);
+    if (name == "texture_diffuse" && diffuseNr < MeshUniforms::maxTextures) {
+      list.setInt(uniforms.diffuse[diffuseNr++], unit);
+    } else if (name == "texture_specular" &&
+               specularNr < MeshUniforms::maxTextures) {
+      list.setInt(uniforms.specular[specularNr++], unit);
     }
-    shader.setInt(("material." + name + number).c_str(), i);
-
-    glBindTexture(GL_TEXTURE_2D, textures[i].id);
+    list.bindTexture(GL_TEXTURE_2D, static_cast<GLuint>(i),
+                     resources.texture(textures[i].texture));
   }
-
-  glActiveTexture(GL_TEXTURE0);
-  glBindVertexArray(VAO);
-  glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-  glBindVertexArray(0);
+  list.bindVertexArray(mesh->vao);
+  list.drawElements(GL_TRIANGLES, mesh->count, GL_UNSIGNED_INT);
 }
 class Model {
 public:
-  Model(const std::string &path) { loadModel(path); }
+  Model(const std::string &path, cg::ResourceManager &resources)
+      : resources(resources) {
+    loadModel(path);
+  }
   void Draw(cg::Shader);
+  // visible 与 meshes 一一对应, 为 0 的网格不提交
+  void Draw(cg::Shader, std::span<const std::uint8_t> visible);
+  // 把 [begin, end) 中可见的网格录入命令列表, visible 为空时全部录入
+  void record(cg::CommandList &list, const MeshUniforms &uniforms,
+              std::size_t begin, std::size_t end,
+              std::span<const std::uint8_t> visible) const;
+  const std::vector<Mesh> &getMeshes() const { return meshes; }
+  // 网格所在节点的世界矩阵 (模型空间到模型根节点)
+  const glm::mat4 &meshTransform(std::size_t mesh) const {
+    return transforms.world(meshNodes[mesh]);
+  }
 
 private:
-  std::vector<Texture> textures_loaded;
+  cg::ResourceManager &resources;
   std::vector<Mesh> meshes;
+  // aiNode 的层次, meshNodes[i] 为第 i 个网格所在的节点
+  cg::TransformHierarchy transforms;
+  std::vector<std::uint32_t> meshNodes;
   std::string directory;
   void loadModel(const std::string &path);
-  void processNode(aiNode *node, const aiScene *scene);
+  void processNode(aiNode *node, const aiScene *scene,
+                   std::uint32_t parent = cg::TransformHierarchy::invalid);
+  // 着色器的 uniform location 缓存, 以程序对象为键
+  std::vector<MeshUniforms> uniformCache;
+  const MeshUniforms &uniformsOf(const cg::Shader &shader);
+  // 绘制时每 recordGrain 个网格一个命令列表, 由作业系统并行录制
+  static constexpr std::size_t recordGrain = 32;
+  std::vector<cg::CommandList> commandLists;
+  // 纹理对象在解析材质时创建并按路径登记, 图像在 loadModel 末尾并行解码后
+  // 统一上传
+  struct PendingTexture {
+    GLuint id;
+    std::string path;
+  };
+  std::vector<PendingTexture> pendingTextures;
+  void decodeTextures();
   Mesh processMesh(aiMesh *mesh, const aiScene *scene);
-  std::vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type,
-                                            std::string typenName);
+  std::vector<cg::MaterialTexture> loadMaterialTextures(aiMaterial *mat,
+                                                       aiTextureType type,
+                                                       std::string typenName);
 };
 
-void Model::Draw(cg::Shader shader) {
-  for (std::size_t i{}; i < meshes.size(); i++) {
-    meshes[i].Draw(shader);
+const MeshUniforms &Model::uniformsOf(const cg::Shader &shader) {
+  auto it = std::ranges::find(uniformCache, shader.ID, &MeshUniforms::program);
+  if (it != uniformCache.end()) {
+    return *it;
+  }
+  uniformCache.push_back(MeshUniforms::of(shader));
+  return uniformCache.back();
+}
+
+void Model::record(cg::CommandList &list, const MeshUniforms &uniforms,
+                   std::size_t begin, std::size_t end,
+                   std::span<const std::uint8_t> visible) const {
+  list.useProgram(uniforms.program);
+  for (auto i = begin; i < end; i++) {
+    if (!visible.empty() && !visible[i]) {
+      continue;
+    }
+    // 覆盖调用方设置的 model, 网格按所在节点的变换绘制
+    const auto &world = meshTransform(i);
+    list.setMat4(uniforms.model, world);
+    list.setMat3(uniforms.normalMatrix, cg::normalMatrix(world));
+    meshes[i].record(list, uniforms, resources);
   }
 }
 
+void Model::Draw(cg::Shader shader) { Draw(shader, {}); }
+
+void Model::Draw(cg::Shader shader, std::span<const std::uint8_t> visible) {
+  // 各块并行录制到自己的列表, 再在 GL 线程上按顺序回放
+  const auto &uniforms = uniformsOf(shader);
+  commandLists.resize((meshes.size() + recordGrain - 1) / recordGrain);
+  cg::JobSystem::shared().parallelFor(
+      0, meshes.size(), recordGrain, [&](std::size_t begin, std::size_t end) {
+        auto &list = commandLists[begin / recordGrain];
+        list.clear();
+        record(list, uniforms, begin, end, visible);
+      });
+  cg::CommandList::execute(commandLists);
+  glBindVertexArray(0);
+}
+
 void Model::loadModel(const std::string &path) {
   Assimp::Importer importer;
   const auto scene =
@@ -186,23 +334,52 @@ void Model::loadModel(const std::string &path) {
     return;
   }
   directory = fs::path(path).parent_path().string();
+  if (!fs::exists(directory)) {
+    throw std::runtime_error("dir not exists");
+  }
   processNode(scene->mRootNode, scene);
+  transforms.update();
+  decodeTextures();
+}
+void Model::decodeTextures() {
+  std::vector<Image> images(pendingTextures.size());
+  stbi_set_flip_vertically_on_load(true);
+  cg::JobSystem::shared().parallelFor(
+      0, images.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (auto i = begin; i < end; i++) {
+          images[i] = DecodeImage(pendingTextures[i].path);
+        }
+      });
+  for (std::size_t i{}; i < images.size(); i++) {
+    UploadTexture(pendingTextures[i].id, images[i], false);
+  }
+  pendingTextures.clear();
 }
-void Model::processNode(aiNode *node, const aiScene *scene) {
+void Model::processNode(aiNode *node, const aiScene *scene,
+                        std::uint32_t parent) {
+  // aiMatrix4x4 按行存储, glm 按列存储
+  const auto &m = node->mTransformation;
+  auto transform = transforms.add(
+      glm::mat4(m.a1, m.b1, m.c1, m.d1, m.a2, m.b2, m.c2, m.d2, m.a3, m.b3,
+                m.c3, m.d3, m.a4, m.b4, m.c4, m.d4),
+      parent);
   for (std::size_t i{}; i < node->mNumMeshes; i++) {
     auto mesh =
         scene->mMeshes
             [node->mMeshes[i]]; // node中存储着的是索引,通过这个索引获取mesh
     meshes.push_back(processMesh(mesh, scene));
+    meshNodes.push_back(transform);
   }
+  // 递归顺序即先序, 满足 TransformHierarchy 的要求
   for (std::size_t i{}; i < node->mNumChildren; i++) {
-    processNode(node->mChildren[i], scene);
+    processNode(node->mChildren[i], scene, transform);
   }
 }
 Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene) {
   std::vector<Vertex> vertices;
   std::vector<unsigned int> indices;
-  std::vector<Texture> textures;
+  std::vector<cg::MaterialTexture> textures;
+  cg::Aabb bounds;
   for (unsigned int i{}; i < mesh->mNumVertices; i++) {
     Vertex v{
         .Position{mesh->mVertices[i].x, mesh->mVertices[i].y,
@@ -215,8 +392,15 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene) {
       vec.y = mesh->mTextureCoords[0][i].y;
       v.TexCoords = vec;
     }
+    bounds.expand(v.Position);
     vertices.push_back(v);
   }
+  // 包围球以包围盒中心为圆心, 半径取最远顶点
+  cg::Sphere sphere{bounds.center(), 0.0f};
+  for (const auto &v : vertices) {
+    sphere.radius =
+        std::max(sphere.radius, glm::distance(sphere.center, v.Position));
+  }
   for (unsigned int i{}; i < mesh->mNumFaces; i++) {
     auto face = mesh->mFaces[i];
     // for(unsigned int j{};j<face.mNumIndices;j++){
@@ -234,27 +418,25 @@ Mesh Model::processMesh(aiMesh *mesh, const aiScene *scene) {
     textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
     textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
   }
-  Mesh my_mesh{vertices, indices, textures};
+  Mesh my_mesh{resources, vertices, indices, textures, bounds, sphere};
   return my_mesh;
 }
-std::vector<Texture> Model::loadMaterialTextures(aiMaterial *mat,
-                                                 aiTextureType type,
-                                                 std::string typeName) {
-  std::vector<Texture> textures;
+std::vector<cg::MaterialTexture>
+Model::loadMaterialTextures(aiMaterial *mat, aiTextureType type,
+                            std::string typeName) {
+  std::vector<cg::MaterialTexture> textures;
   for (unsigned int i{}; i < mat->GetTextureCount(type); i++) {
     aiString texturePath;
     mat->GetTexture(type, i, &texturePath);
-    auto it = std::ranges::find(textures_loaded, texturePath, &Texture::path);
-    if (it == textures_loaded.end()) {
-      Texture texture;
-      texture.id = TextureFromFile(texturePath.C_Str(), directory);
-      texture.type = typeName;
-      texture.path = texturePath;
-      textures.push_back(texture);
-      textures_loaded.push_back(texture);
-    } else {
-      textures.push_back(*it);
+    auto path = (fs::path(directory) / texturePath.C_Str()).string();
+    auto texture = resources.findTexture(path);
+    if (!texture) {
+      GLuint id;
+      glGenTextures(1, &id);
+      pendingTextures.push_back({id, path});
+      texture = resources.addTexture(id, GL_TEXTURE_2D, path);
     }
+    textures.push_back({texture, typeName});
   }
   return textures;
 }
@@ -289,76 +471,80 @@ unsigned int loadCubemap(std::vector<std::string> faces) {
   stbi_set_flip_vertically_on_load(GL_TRUE);
   return cubeTexture;
 }
+// GL 线程: 处理退出并采样移动按键
 void processInput(GLFWwindow *window) {
   if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
     glfwSetWindowShouldClose(window, true);
   }
-  float cameraSpeed = 2.5f * deltaTime;
-  camera.setSpeed(cameraSpeed);
-  if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
-    camera.MoveForward();
-  } else if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
-    camera.MoveBackward();
-  } else if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
-    camera.MoveLeft();
-  } else if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
-    camera.MoveRight();
-  } else if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
-    camera.MoveUp();
-  } else if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
-    camera.MoveDown();
+  for (std::size_t k{}; k < moveKeys.size(); k++) {
+    input.keys[k] = glfwGetKey(window, moveKeys[k]) == GLFW_PRESS;
   }
 }
-
-void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
-  if (fov >= 1.0f && fov <= 45.0f) {
-    fov -= yoffset;
-  }
-  if (fov <= 1.0f) {
-    fov = 1.0f;
+// 模拟线程: 按两次快照之间的变化移动和旋转相机
+void applyInput(const InputState &state, const InputState &previous,
+                float deltaTime) {
+  constexpr std::array moves{
+      &cg::Camera::MoveForward, &cg::Camera::MoveBackward,
+      &cg::Camera::MoveLeft,    &cg::Camera::MoveRight,
+      &cg::Camera::MoveUp,      &cg::Camera::MoveDown};
+  camera.setSpeed(2.5f * deltaTime);
+  for (std::size_t k{}; k < moves.size(); k++) {
+    if (state.keys[k]) {
+      (camera.*moves[k])();
+      break;
+    }
   }
-  if (fov >= 45.0f) {
-    fov = 45.0f;
+  if (state.cursorValid && previous.cursorValid) {
+    camera.Rotate(static_cast<float>(state.cursorX - previous.cursorX),
+                  static_cast<float>(state.cursorY - previous.cursorY));
   }
+  fov = std::clamp(fov - static_cast<float>(state.scroll - previous.scroll),
+                   1.0f, 45.0f);
+}
+// 按键从松开变为按下时返回 true, 用于切换渲染开关
+bool keyPressed(GLFWwindow *window, int key) {
+  static bool down[GLFW_KEY_LAST + 1]{};
+  auto pressed = glfwGetKey(window, key) == GLFW_PRESS;
+  auto edge = pressed && !down[key];
+  down[key] = pressed;
+  return edge;
+}
+
+void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
+  input.scroll += yoffset;
 }
 void cursor_position_callback(GLFWwindow *window, double xpos, double ypos) {
-  static auto firstMouse{true};
-  if (firstMouse) {
-    lastX = xpos;
-    lastY = ypos;
-    firstMouse = false;
-  }
-  float xoffset = xpos - lastX;
-  float yoffset = ypos - lastY;
-  camera.Rotate(xoffset, yoffset);
-  lastX = xpos;
-  lastY = ypos;
+  input.cursorX = xpos;
+  input.cursorY = ypos;
+  input.cursorValid = true;
 }
 
-GLuint LoadTexture(const char *path, bool clip) {
-  // 生成纹理
-  GLuint texture;
-  glGenTextures(1, &texture);
-  stbi_set_flip_vertically_on_load(true);
-  // 加载图像
-  int img_width, img_height, nrChannels;
-  unsigned char *data =
-      stbi_load(path, &img_width, &img_height, &nrChannels, 0);
-  if (data) {
+Image DecodeImage(const std::string &path) {
+  Image image;
+  image.data = stbi_load(path.c_str(), &image.width, &image.height,
+                         &image.channels, 0);
+  if (!image.data) {
+    image.error = stbi_failure_reason();
+  }
+  return image;
+}
+
+bool UploadTexture(GLuint texture, Image &image, bool clip) {
+  if (image.data) {
     GLenum format;
-    if (nrChannels == 1) {
+    if (image.channels == 1) {
       format = GL_RED;
-    } else if (nrChannels == 3) {
+    } else if (image.channels == 3) {
       format = GL_RGB;
-    } else if (nrChannels == 4) {
+    } else if (image.channels == 4) {
       format = GL_RGBA;
     } else {
       throw std::runtime_error("No available format.");
     }
 
     glBindTexture(GL_TEXTURE_2D, texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, img_width, img_height, 0, format,
-                 GL_UNSIGNED_BYTE, data);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0,
+                 format, GL_UNSIGNED_BYTE, image.data);
     glGenerateMipmap(GL_TEXTURE_2D);
     if (clip) {
       glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -373,14 +559,114 @@ GLuint LoadTexture(const char *path, bool clip) {
 
   } else {
     std::cerr << "Failed to load texture" << std::endl;
-    std::cout << "Error: Failed to load the image because "
-              << stbi_failure_reason();
-    return -1;
+    std::cout << "Error: Failed to load the image because " << image.error;
+    return false;
   }
 
-  stbi_image_free(data);
-  return texture;
+  stbi_image_free(image.data);
+  image.data = nullptr;
+  return true;
+}
+
+cg::TextureHandle LoadTexture(cg::ResourceManager &resources, const char *path,
+                              bool clip) {
+  if (auto loaded = resources.findTexture(path)) {
+    return loaded;
+  }
+  // 生成纹理
+  GLuint texture;
+  glGenTextures(1, &texture);
+  stbi_set_flip_vertically_on_load(true);
+  // 加载图像
+  auto image = DecodeImage(path);
+  if (!UploadTexture(texture, image, clip)) {
+    glDeleteTextures(1, &texture);
+    return {};
+  }
+  return resources.addTexture(texture, GL_TEXTURE_2D, path);
 }
+
+/**
+ * @brief 场景实体的组件
+ * 实体的世界矩阵保存在变换层次中, 组件只记录节点号
+ */
+struct SceneNode {
+  std::uint32_t node;
+};
+// 由 InstanceBatcher 按材质实例化绘制
+struct Renderable {
+  std::uint32_t mesh;
+  std::uint32_t material;
+};
+// 局部包围盒, object 为其在场景索引和可见性数组中的编号
+struct Bounds {
+  cg::Aabb local;
+  std::uint32_t object;
+};
+struct ShadowCaster {};
+struct Occluder {};
+// 光源位置上的小立方体
+struct LightMarker {};
+// 透明的窗户, 由 OIT 或排序路径绘制
+struct Transparent {};
+struct LightOrbit {
+  float radius, height, speed, phase;
+};
+
+// 通过剔除的实例, 材质由渲染线程按当前的渲染开关替换
+struct DrawInstance {
+  std::uint32_t mesh;
+  std::uint32_t material;
+  glm::mat4 world;
+};
+struct ShadowedLightState {
+  int slot;
+  glm::vec3 position;
+  float radius;
+};
+// 世界包围盒改变的对象, 渲染线程据此更新场景索引和局部阴影
+struct MovedObject {
+  std::uint32_t object;
+  cg::Aabb from, to;
+  bool caster;
+};
+// 着色器中 std140 的 Lighting 块: vec3 按 16 字节对齐,
+// 聚光的 cutOff 紧跟在 direction 之后
+struct LightingBlock {
+  glm::vec4 dirDirection, dirAmbient, dirDiffuse, dirSpecular;
+  glm::vec4 spotPosition;
+  glm::vec3 spotDirection;
+  float spotCutOff;
+  float spotOuterCutOff, padding[3];
+  glm::vec4 spotAmbient, spotDiffuse, spotSpecular;
+  glm::vec4 viewPos;
+};
+static_assert(sizeof(LightingBlock) == 176);
+/**
+ * @brief 模拟线程每帧产出的帧数据, 发布后只读
+ * 渲染线程只根据它提交 GL 命令, 不再访问相机, 变换层次和光源组件
+ */
+struct FramePacket {
+  float time{};
+  float fov{45.0f};
+  // 投影的宽高比, 跟随当前的帧缓冲大小
+  float aspect{1.0f};
+  glm::mat4 view{1.0f}, projection{1.0f};
+  glm::vec3 cameraPos{}, cameraFront{0.0f, 0.0f, -1.0f};
+  std::vector<cg::ClusterLight> lights;
+  std::vector<ShadowedLightState> shadowedLights;
+  // 按场景索引编号的可见性
+  std::vector<std::uint8_t> visible;
+  std::vector<DrawInstance> instances;
+  std::vector<glm::mat4> lightMarkers;
+  // 可见的窗户及其到相机的距离
+  std::vector<glm::mat4> windows;
+  std::vector<float> windowDepths;
+  // 按场景索引编号的世界矩阵 (模型网格除外), 局部阴影查询后取用
+  std::vector<glm::mat4> objectWorlds;
+  std::vector<MovedObject> movedObjects;
+};
+
 int main() {
   if (!glfwInit()) {
     std::cerr << "Failed to initialize GLFW" << std::endl;
@@ -414,6 +700,12 @@ int main() {
     glfwTerminate();
     return -1;
   }
+  // 以帧缓冲的像素大小渲染, 高 DPI 屏幕上不会先渲染低分辨率再放大
+  glfwGetFramebufferSize(window, &input.framebufferWidth,
+                         &input.framebufferHeight);
+  GLsizei renderWidth = std::max(input.framebufferWidth, 1);
+  GLsizei renderHeight = std::max(input.framebufferHeight, 1);
+  cg::ResizeDebouncer resize{renderWidth, renderHeight};
   glEnable(GL_DEPTH_TEST); // 启用深度和模板测试
   // glDepthFunc(GL_LESS);
   // glEnable(GL_BLEND);
@@ -425,13 +717,19 @@ int main() {
 
   // glStencilMask(0xff);                       // 启用模板写入
 
-  auto texture = LoadTexture("./resources/textures/container2.png");
+  /**
+   * @brief 纹理, 缓冲, 网格和着色器程序都登记在这里, 退出时统一删除
+   */
+  cg::ResourceManager resources;
+  auto texture = LoadTexture(resources, "./resources/textures/container2.png");
   auto texture_sepc =
-      LoadTexture("./resources/textures/container2_specular.png");
-  auto texture_emission = LoadTexture("./resources/textures/matrix.jpg");
-  auto grass_texture = LoadTexture("./resources/textures/grass.png", true);
-  auto window_texture =
-      LoadTexture("./resources/textures/blending_transparent_window.png", true);
+      LoadTexture(resources, "./resources/textures/container2_specular.png");
+  auto texture_emission =
+      LoadTexture(resources, "./resources/textures/matrix.jpg");
+  auto grass_texture =
+      LoadTexture(resources, "./resources/textures/grass.png", true);
+  auto window_texture = LoadTexture(
+      resources, "./resources/textures/blending_transparent_window.png", true);
   // 着色器编写
   // auto vertexShaderSource = R"(
   //   #version 400 core
@@ -461,8 +759,37 @@ int main() {
                                 "./resources/shaders/shaderSingleColor.frag"};
   cg::Shader grassShaderProgram{"./resources/shaders/vertexShader.vert",
                                 "./resources/shaders/grassShader.frag"};
-  cg::Shader windowShaderProgram{"./resources/shaders/vertexShader.vert",
-                                 "./resources/shaders/windowShader.frag"};
+  // 实例化版本: 模型矩阵来自实例缓冲
+  cg::Shader instancedShaderProgram{"./resources/shaders/instanced.vert",
+                                    fragmentShaderFile};
+  cg::Shader instancedGrassProgram{"./resources/shaders/instanced.vert",
+                                   "./resources/shaders/grassShader.frag"};
+  // 透明窗户: OIT 累积以及排序对照路径
+  cg::Shader windowAccumProgram{"./resources/shaders/instanced.vert",
+                                "./resources/shaders/oit_accum.frag"};
+  cg::Shader instancedWindowProgram{"./resources/shaders/instanced.vert",
+                                    "./resources/shaders/windowShader.frag"};
+  // 延迟着色: 几何阶段写 G-buffer, 光照阶段读 G-buffer
+  cg::Shader gBufferProgram{vertexShaderFile,
+                            "./resources/shaders/gbuffer.frag"};
+  cg::Shader instancedGBufferProgram{"./resources/shaders/instanced.vert",
+                                     "./resources/shaders/gbuffer.frag"};
+  cg::Shader lightVolumeShader{"./resources/shaders/deferred_light.vs",
+                               "./resources/shaders/deferred_light.fs"};
+  // 深度预通道: 只读位置属性, 片段着色器为空
+  cg::Shader depthProgram{"./resources/shaders/depth_only.vert",
+                          "./resources/shaders/depth_only.frag"};
+  cg::Shader instancedDepthProgram{
+      "./resources/shaders/depth_only_instanced.vert",
+      "./resources/shaders/depth_only.frag"};
+  // 点光源阴影: 几何着色器一遍写入立方体阴影的 6 个面
+  cg::Shader pointShadowProgram{"./resources/shaders/depth_only.vert",
+                                "./resources/shaders/point_shadow.frag",
+                                "./resources/shaders/point_shadow.gs"};
+  cg::Shader instancedPointShadowProgram{
+      "./resources/shaders/depth_only_instanced.vert",
+      "./resources/shaders/point_shadow.frag",
+      "./resources/shaders/point_shadow.gs"};
   // auto fragmentShaderSource = R"(
   //   #version 400 core
   //   out vec4 FragColor;
@@ -482,24 +809,7 @@ int main() {
 
   // glDeleteShader(vertexShader);
   // glDeleteShader(fragmentShader);
-  Model loaded_model{"./resources/models/nanosuit/nanosuit.obj"};
-
-  GLuint fbo;
-  glGenFramebuffers(1, &fbo);
-  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-
-  unsigned int textureColorbuffer;
-  glGenTextures(1, &textureColorbuffer);
-  glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
-
-  // 纹理缓冲
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB,
-               GL_UNSIGNED_BYTE, NULL);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-  // 附加颜色附件  此外还可以附加深度和模板缓冲纹理
-  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                         textureColorbuffer, 0);
+  Model loaded_model{"./resources/models/nanosuit/nanosuit.obj", resources};
 
   /**
    * @brief 立方体贴图
@@ -507,13 +817,16 @@ int main() {
    */
   std::vector<std::string> faces{"right.jpg",  "left.jpg",  "top.jpg",
                                  "bottom.jpg", "front.jpg", "back.jpg"};
-  unsigned int cubemapTexture = loadCubemap([&faces]() {
-    std::ranges::for_each(faces, [](std::string &face) {
-      face = (std::string("./resources/skybox/") / fs::path(face)).string();
-      return face;
-    });
-    return faces;
-  }());
+  auto cubemapTexture = resources.addTexture(
+      loadCubemap([&faces]() {
+        std::ranges::for_each(faces, [](std::string &face) {
+          face =
+              (std::string("./resources/skybox/") / fs::path(face)).string();
+          return face;
+        });
+        return faces;
+      }()),
+      GL_TEXTURE_CUBE_MAP);
   float skyboxVertices[] = {
       // positions
       -1.0f, 1.0f,  -1.0f, -1.0f, -1.0f, -1.0f, 1.0f,  -1.0f, -1.0f,
@@ -546,21 +859,11 @@ int main() {
   glEnableVertexAttribArray(0);
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
 
-  // 渲染缓冲对象
-  unsigned int rbo;
-  glGenRenderbuffers(1, &rbo);
-  glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
-  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT,
-                            GL_RENDERBUFFER, rbo);
-  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-    std::cerr << "error::framebuffer:: framebuffer is not complete!"
-              << std::endl;
-  }
-  // glPolygonMode(GL_FRONT_AND_BACK,GL_LINE);
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  // 场景颜色, 深度模板以及 G-buffer, OIT 目标由渲染图分配
+  cg::TransparencyPass transparency;
+  cg::DeferredRenderer deferred;
 
-  GLuint VAO, VBO, EBO;
+  GLuint VAO, VBO;
   GLuint lightVAO, lightVBO;
   // ------------------------------------------------------------------
   float vertices[] = {
@@ -605,7 +908,7 @@ int main() {
   glBindVertexArray(VAO);
   glGenBuffers(1, &VBO);
   glBindBuffer(GL_ARRAY_BUFFER, VBO);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STREAM_DRAW);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *)0);
   glEnableVertexAttribArray(0);
   glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
@@ -614,6 +917,59 @@ int main() {
   glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float),
                         (void *)(6 * sizeof(float)));
   glEnableVertexAttribArray(2);
+  /**
+   * @brief 每帧数据的上传环: 每帧重建的实例数据和各 uniform 块 (相机,
+   * 光照, 阴影, 分簇参数) 都从当前帧区域分配, 每个块有固定的绑定点
+   */
+  cg::UploadRing uploadRing{1 << 20};
+  constexpr GLuint cameraBlockBinding = 0;
+  constexpr GLuint lightingBlockBinding = 1;
+  constexpr GLuint cascadesBlockBinding = 2;
+  constexpr GLuint localShadowsBlockBinding = 3;
+  constexpr GLuint clustersBlockBinding = 4;
+  GLint uniformAlignment{};
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+  for (const auto *program :
+       {&shaderProgram, &grassShaderProgram, &gBufferProgram,
+        &instancedShaderProgram, &instancedGrassProgram, &windowAccumProgram,
+        &instancedWindowProgram, &instancedGBufferProgram,
+        &lightVolumeShader}) {
+    program->bindUniformBlock("Camera", cameraBlockBinding);
+    program->bindUniformBlock("Lighting", lightingBlockBinding);
+    program->bindUniformBlock("Cascades", cascadesBlockBinding);
+    program->bindUniformBlock("LocalShadows", localShadowsBlockBinding);
+    program->bindUniformBlock("Clusters", clustersBlockBinding);
+  }
+  // 把一个 std140 块写入本帧区域并绑定到 binding
+  auto uploadBlock = [&](GLuint binding, const auto &block) {
+    if (auto range = uploadRing.allocate(sizeof(block), uniformAlignment);
+        range.data) {
+      std::memcpy(range.data, &block, sizeof(block));
+      uploadRing.commit();
+      glBindBufferRange(GL_UNIFORM_BUFFER, binding, uploadRing.buffer(),
+                        range.offset, static_cast<GLsizeiptr>(range.size));
+    }
+  };
+  /**
+   * @brief 立方体和草共用 VAO, 按 (mesh, material) 合批实例化绘制
+   */
+  cg::InstanceBatcher batcher{&uploadRing, &resources};
+  auto cubeMesh = batcher.addMesh({VAO, 0, 36});
+  auto grassMesh = batcher.addMesh({VAO, 0, 6});
+  auto cubeMaterial =
+      batcher.addMaterial({&instancedShaderProgram, {texture, texture_sepc}});
+  auto grassMaterial =
+      batcher.addMaterial({&instancedGrassProgram, {grass_texture}});
+  auto cubeGBufferMaterial = batcher.addMaterial(
+      {&instancedGBufferProgram, {texture, texture_sepc}});
+  auto cubeDepthMaterial = batcher.addMaterial({&instancedDepthProgram});
+  // 透明物体单独合批, 在所有不透明物体之后绘制
+  cg::InstanceBatcher transparentBatcher{&uploadRing, &resources};
+  auto windowMesh = transparentBatcher.addMesh({VAO, 0, 6});
+  auto windowAccumMaterial =
+      transparentBatcher.addMaterial({&windowAccumProgram, {window_texture}});
+  auto windowSortedMaterial = transparentBatcher.addMaterial(
+      {&instancedWindowProgram, {window_texture}});
   float cubeVertices[] = {
       // Back face
       -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, // Bottom-left
@@ -684,7 +1040,6 @@ int main() {
       -0.5f, 0.5f,  -0.5f, 0.5f,  0.5f,  -0.5f, 0.5f,  0.5f,  0.5f,  0.5f,
       0.5f,  0.5f,  -0.5f, 0.5f,  0.5f,  -0.5f, 0.5f,  -0.5f,
   };
-  float lightCenter[] = {.0f, .0f, .0f};
   glGenVertexArrays(1, &lightVAO);
   glBindVertexArray(lightVAO);
   glGenBuffers(1, &lightVBO);
@@ -729,8 +1084,6 @@ int main() {
   //                                  LWA_COLORKEY | LWA_ALPHA);
   //   }
   // #endif
-  float currentFrame = 0.0f;
-
   std::random_device rd;
   std::mt19937 gen(rd());
   std::uniform_real_distribution<float> dis(-90.0f, 90.0f);
@@ -773,118 +1126,519 @@ int main() {
   auto quadFragmentShaderFile = "./resources/shaders/quad.fs";
   cg::Shader quadShader{quadVertexShaderFile, quadFragmentShaderFile};
   quadShader.setInt("texture1", 0);
+  // 最终合成用同一个着色器的另一个程序对象, 色调映射和泛光的 uniform
+  // 不会影响后处理中的颜色阶段
+  cg::Shader presentShader{quadVertexShaderFile, quadFragmentShaderFile};
+  presentShader.setInt("texture1", 0);
+  cg::Shader oitCompositeShader{quadVertexShaderFile,
+                                "./resources/shaders/oit_composite.fs"};
+  cg::Shader deferredAmbientShader{quadVertexShaderFile,
+                                   "./resources/shaders/deferred_ambient.fs"};
+  deferredAmbientShader.bindUniformBlock("Camera", cameraBlockBinding);
+  deferredAmbientShader.bindUniformBlock("Lighting", lightingBlockBinding);
+  deferredAmbientShader.bindUniformBlock("Cascades", cascadesBlockBinding);
+  deferredAmbientShader.bindUniformBlock("LocalShadows",
+                                         localShadowsBlockBinding);
+  cg::Shader postBlurShader{quadVertexShaderFile,
+                            "./resources/shaders/post_blur.fs"};
+  cg::Shader postKernelShader{quadVertexShaderFile,
+                              "./resources/shaders/post_kernel.fs"};
+  cg::Shader bloomDownsampleShader{quadVertexShaderFile,
+                                   "./resources/shaders/bloom_downsample.fs"};
+  cg::Shader bloomUpsampleShader{quadVertexShaderFile,
+                                 "./resources/shaders/bloom_upsample.fs"};
+  // 以上的 VAO, 顶点缓冲和着色器程序交给 resources, 退出时统一删除
+  resources.addMesh({VAO, 0, 36, false, {resources.addBuffer(VBO)}});
+  resources.addMesh({lightVAO, 0, 36, false, {resources.addBuffer(lightVBO)}});
+  resources.addMesh(
+      {skyboxVAO, 0, 36, false, {resources.addBuffer(skyboxVBO)}});
+  resources.addMesh({cubeVAO, 0, 36, false, {resources.addBuffer(cubeVBO)}});
+  resources.addMesh({quadVAO, 0, 6, false, {resources.addBuffer(quadVBO)}});
+  for (const auto *program :
+       {&shaderProgram, &lightShaderProgram, &largeShaderProgram,
+        &grassShaderProgram, &instancedShaderProgram, &instancedGrassProgram,
+        &windowAccumProgram, &instancedWindowProgram, &gBufferProgram,
+        &instancedGBufferProgram, &lightVolumeShader, &depthProgram,
+        &instancedDepthProgram, &pointShadowProgram,
+        &instancedPointShadowProgram, &skyboxShader, &quadShader,
+        &oitCompositeShader, &deferredAmbientShader, &postBlurShader,
+        &postKernelShader, &presentShader, &bloomDownsampleShader,
+        &bloomUpsampleShader}) {
+    resources.addProgram(program->ID);
+  }
 
   skyboxShader.setInt("cubeTexture", 0);
+  /**
+   * @brief 场景变换层次: 立方体上的草是立方体的子节点,
+   * 其余为根节点. 每帧 update 一次, 没有改动时不做任何计算
+   */
+  cg::TransformHierarchy sceneTransforms;
+  const cg::Aabb cubeBounds{glm::vec3(-0.5f), glm::vec3(0.5f)};
+  // 草和窗户使用立方体的第一个面 (z = -0.5)
+  const cg::Aabb quadBounds{glm::vec3(-0.5f, -0.5f, -0.5f),
+                            glm::vec3(0.5f, 0.5f, -0.5f)};
+  /**
+   * @brief 场景实体: 渲染循环只遍历组件查询, 新的对象类型只需换一种组件组合
+   */
+  cg::World scene;
+  for (const auto &position : cubePositions) {
+    auto cube = sceneTransforms.add(
+        glm::rotate(glm::translate(glm::mat4{1.0f}, position),
+                    glm::radians(0.0f), glm::vec3(1.0f, 0.3f, 0.5f)));
+    scene.create(SceneNode{cube}, Renderable{cubeMesh, cubeMaterial},
+                 Bounds{cubeBounds}, ShadowCaster{}, Occluder{});
+    auto grass = sceneTransforms.add(
+        glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.f, -0.01f)), cube);
+    scene.create(SceneNode{grass}, Renderable{grassMesh, grassMaterial},
+                 Bounds{quadBounds});
+  }
+  int grass_count{40};
+  for (int i : std::ranges::iota_view(0, grass_count)) {
+    float theta = glm::radians(360.0f / grass_count * i);
+    auto location = glm::vec3(10.0f * std::cos(theta), 0.0f,
+                              10.0f * std::sin(theta));
+    auto grass = sceneTransforms.add(glm::translate(glm::mat4(1.0f), location));
+    scene.create(SceneNode{grass}, Renderable{grassMesh, grassMaterial},
+                 Bounds{quadBounds});
+  }
+  // 四个带阴影的点光源及其标记, 以及窗户
+  int shadowSlot{};
+  for (const auto &position : pointLightPositions) {
+    cg::ClusterLight light{position};
+    light.ambient = glm::vec3(.2f, .2f, .2f);
+    light.diffuse = glm::vec3(.8f, .8f, .8f);
+    light.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+    light.radius = cg::lightRange(light);
+    light.shadowSlot = shadowSlot++;
+    auto node = sceneTransforms.add(glm::scale(
+        glm::translate(glm::mat4(1.0f), position), glm::vec3(.2f)));
+    scene.create(SceneNode{node}, Bounds{cubeBounds}, LightMarker{}, light);
+  }
+  for (const auto &position : windowPositions) {
+    scene.create(SceneNode{sceneTransforms.add(
+                     glm::translate(glm::mat4(1.0f), position))},
+                 Bounds{quadBounds}, Transparent{});
+  }
+  sceneTransforms.update();
+
+  /**
+   * @brief 场景索引与批量剔除的对象: 先是模型网格, 然后是所有带包围盒的实体
+   * 每帧统一做一次批量视锥剔除, 拾取和范围查询也使用同样的编号
+   */
+  cg::BoundsSoA sceneBounds;
+  std::vector<cg::Aabb> sceneBoxes;
+  auto modelMeshCount = loaded_model.getMeshes().size();
+  for (std::size_t i{}; i < modelMeshCount; i++) {
+    // 网格的包围体在其节点空间中, 包围球半径按最大缩放放大
+    const auto &mesh = loaded_model.getMeshes()[i];
+    const auto &transform = loaded_model.meshTransform(i);
+    auto scale = std::max({glm::length(glm::vec3(transform[0])),
+                           glm::length(glm::vec3(transform[1])),
+                           glm::length(glm::vec3(transform[2]))});
+    sceneBoxes.push_back(mesh.bounds.transformed(transform));
+    sceneBounds.push(sceneBoxes.back(), mesh.sphere.radius * scale);
+  }
+  std::vector<cg::Entity> objectEntities;
+  scene.each<SceneNode, Bounds>(
+      [&](cg::Entity entity, const SceneNode &node, Bounds &bounds) {
+        bounds.object = static_cast<std::uint32_t>(sceneBoxes.size());
+        sceneBoxes.push_back(
+            bounds.local.transformed(sceneTransforms.world(node.node)));
+        sceneBounds.push(sceneBoxes.back());
+        objectEntities.push_back(entity);
+      });
+
+  /**
+   * @brief 阴影投射体: 与相机视锥无关, 立方体实例一次性上传
+   * staticCasterVersion 在静态投射体增删或移动时递增, 使缓存的级联失效
+   */
+  cg::InstanceBatcher casterBatcher;
+  auto casterCube = casterBatcher.addMesh({VAO, 0, 36});
+  auto casterMaterial = casterBatcher.addMaterial({&instancedDepthProgram});
+  // 目前只有立方体投射阴影
+  std::vector<std::uint32_t> casterObjects;
+  scene.each<SceneNode, Bounds, ShadowCaster>(
+      [&](const SceneNode &node, const Bounds &bounds, const ShadowCaster &) {
+        casterObjects.push_back(bounds.object);
+        casterBatcher.append(casterCube, casterMaterial,
+                             sceneTransforms.world(node.node));
+      });
+  casterBatcher.upload();
+  std::uint64_t staticCasterVersion{1};
+  const glm::vec3 dirLightDirection{-0.2f, -1.0f, -0.3f};
+  cg::CascadedShadowMap cascades;
+  // 保存为 std::function, 每帧传参时不再构造新的闭包对象
+  const cg::CascadedShadowMap::DrawCasters drawCasters =
+      [&](const glm::mat4 &lightViewProjection, bool staticOnly) {
+        // 目前场景中的投射体都是静态的, 动态投射体只在 !staticOnly 时绘制
+        depthProgram.use();
+        depthProgram.setMat4("model", glm::mat4(1.0f));
+        depthProgram.setMat4("view", glm::mat4(1.0f));
+        depthProgram.setMat4("projection", lightViewProjection);
+        glBindVertexArray(VAO);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+        loaded_model.Draw(depthProgram);
+        instancedDepthProgram.use();
+        instancedDepthProgram.setMat4("view", glm::mat4(1.0f));
+        instancedDepthProgram.setMat4("projection", lightViewProjection);
+        casterBatcher.draw();
+      };
+
+  cg::Bvh sceneIndex;
+  sceneIndex.build(sceneBoxes);
+  auto describeObject = [&](std::size_t object) -> std::string {
+    if (object < modelMeshCount) {
+      return std::format("model mesh {}", object);
+    }
+    auto entity = objectEntities[object - modelMeshCount];
+    auto kind = scene.has<LightMarker>(entity)   ? "point light"
+                : scene.has<Transparent>(entity) ? "window"
+                                                 : "instance";
+    return std::format("{} (entity {})", kind, entity);
+  };
+  bool picking{false};
+  // 默认 OIT, 按 T 切换到按深度基数排序后混合的对照路径
+  bool sortedTransparency{false};
+  std::vector<std::uint32_t> windowOrder;
+  // 按 G 在前向 (分簇) 与延迟着色之间切换
+  bool deferredShading{false};
+  // 按 Z 开关深度预通道 (仅前向模式), 标题栏每秒显示一次着色样本数
+  bool depthPrepassEnabled{false};
+  cg::QueryRing shadedSamples{GL_SAMPLES_PASSED};
+  float lastReport{};
+  /**
+   * @brief 动态分辨率: 用计时查询测量渲染图的 GPU 时间, 调整场景的渲染
+   * 比例使其不超过一个刷新周期; 场景目标按完整大小分配, 只渲染其中一部分,
+   * 由 present 放大到窗口. 按 R 开关
+   */
+  bool dynamicResolution{true};
+  cg::QueryRing gpuTime{GL_TIME_ELAPSED};
+  cg::ResolutionSettings resolutionSettings;
+  if (auto *mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+      mode && mode->refreshRate > 0) {
+    resolutionSettings.targetMilliseconds = 1000.0f / mode->refreshRate;
+  }
+  cg::ResolutionController resolution{resolutionSettings};
+  /**
+   * @brief 后处理链, 按 P 在几组预设之间切换. 模糊在低分辨率下分离计算,
+   * 逐像素操作合并进相邻阶段或 present
+   */
+  cg::PostStack post{quadShader, postBlurShader, postKernelShader, quadVAO};
+  const std::vector<std::vector<cg::PostEffect>> postPresets{
+      {},
+      {cg::PostEffect::blur(2.0f, 6, 2)},
+      {cg::PostEffect::grayscale(), cg::PostEffect::blur(3.0f, 8, 4)},
+      {cg::PostEffect::sharpen(), cg::PostEffect::grayscale()},
+      {cg::PostEffect::blur(1.5f, 4, 2), cg::PostEffect::edgeDetect(),
+       cg::PostEffect::invert(), cg::PostEffect::grayscale()},
+  };
+  std::size_t postPreset{};
+  /**
+   * @brief HDR: 场景以 R11F_G11F_B10F 渲染, 泛光在逐级减半的链上计算,
+   * present 中叠加泛光并色调映射. 按 B 开关泛光, 按 H 切换色调映射
+   */
+  constexpr GLenum hdrFormat = GL_R11F_G11F_B10F;
+  cg::Bloom bloom{bloomDownsampleShader, bloomUpsampleShader, quadVAO};
+  bool bloomEnabled{true};
+  constexpr std::array tonemapNames{"none", "reinhard", "aces"};
+  int tonemapOperator{2};
+  /**
+   * @brief 每帧的临时内存: 渲染线程和模拟线程各一个帧内存, 每帧重置
+   * 稳定之后一帧 (两个线程合计) 不应再有任何 operator new; 单帧分配数
+   * 超过之前的最大值时报告, 退出时汇总有分配的帧数. 同样的检查由
+   * bench/frame_alloc_bench 在 CTest 中运行
+   */
+  cg::FrameArena renderArena;
+  cg::FrameArena::Scope renderArenaScope{renderArena};
+  constexpr std::uint64_t warmupFrames = 240;
+  std::uint64_t frameCount{};
+  std::uint64_t frameAllocations{};
+  auto allocationsBefore = cg::allocationCount();
+  std::uint64_t allocatingFrames{}, worstFrameAllocations{};
+
+  /**
+   * @brief CPU 遮挡剔除: 立方体本身作为遮挡体 (8 个顶点, 12 个三角形)
+   */
+  cg::OcclusionCuller occlusion;
+  std::vector<glm::vec3> cubeOccluderVertices;
+  for (int corner{}; corner < 8; corner++) {
+    cubeOccluderVertices.push_back({corner & 1 ? .5f : -.5f,
+                                    corner & 2 ? .5f : -.5f,
+                                    corner & 4 ? .5f : -.5f});
+  }
+  const std::vector<std::uint32_t> cubeOccluderIndices{
+      0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5, 0, 4, 5, 0, 5, 1,
+      2, 3, 7, 2, 7, 6, 0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3};
+  /**
+   * @brief 分簇光源: 场景中的四个点光源加上一圈绕场景运动的小光源
+   * 模拟线程每帧把光源组件收集到帧数据, 渲染线程据此构建分簇
+   */
+  constexpr int dynamicLightCount = 512;
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  for (int i{}; i < dynamicLightCount; i++) {
+    LightOrbit orbit{3.0f + 12.0f * unit(gen), -3.0f + 8.0f * unit(gen),
+                     0.2f + 0.6f * unit(gen), glm::radians(360.0f) * unit(gen)};
+    cg::ClusterLight light{};
+    light.diffuse = 0.5f * glm::vec3(unit(gen), unit(gen), unit(gen));
+    light.specular = light.diffuse;
+    light.linear = 1.4f;
+    light.quadratic = 7.2f;
+    // 每八个里有一个向下照的聚光
+    if (i % 8 == 0) {
+      light.direction = glm::vec3(0.0f, -1.0f, 0.0f);
+      light.cutOff = glm::cos(glm::radians(25.0f));
+      light.outerCutOff = glm::cos(glm::radians(35.0f));
+    }
+    light.radius = cg::lightRange(light);
+    scene.create(light, orbit);
+  }
+  /**
+   * @brief 模拟线程产出的帧数据, frame 指向渲染线程本帧使用的一份
+   */
+  cg::TripleBuffer<FramePacket> packets;
+  const FramePacket *frame{};
+  /**
+   * @brief 四个点光源的立方体阴影和手电筒阴影
+   * 只有光源移动或范围内的投射体移动时才重绘 (见 applyMovedObjects),
+   * 每次重绘用场景索引做球查询, 只绘制范围内的投射体
+   */
+  cg::LocalShadowMaps localShadows;
+  cg::InstanceBatcher localCasterBatcher{&uploadRing};
+  auto localCasterCube = localCasterBatcher.addMesh({VAO, 0, 36});
+  auto localCubeMaterial =
+      localCasterBatcher.addMaterial({&instancedPointShadowProgram});
+  auto localSpotMaterial =
+      localCasterBatcher.addMaterial({&instancedDepthProgram});
+  std::vector<std::uint8_t> localCasterMeshes(modelMeshCount);
+  const cg::LocalShadowMaps::DrawCasters drawLocalCasters =
+      [&](const cg::LocalShadowMaps::Pass &pass) {
+        auto material = pass.cube ? localCubeMaterial : localSpotMaterial;
+        std::ranges::fill(localCasterMeshes, 0);
+        localCasterBatcher.clear();
+        sceneIndex.query(pass.bounds, [&](std::uint32_t object) {
+          if (object < modelMeshCount) {
+            localCasterMeshes[object] = 1;
+          } else if (auto entity = objectEntities[object - modelMeshCount];
+                     scene.has<ShadowCaster>(entity)) {
+            localCasterBatcher.append(localCasterCube, material,
+                                      frame->objectWorlds[object]);
+          }
+        });
+        localCasterBatcher.upload();
+        // 点光源: 顶点着色器输出世界坐标, 由几何着色器投影到 6 个面
+        auto &program = pass.cube ? pointShadowProgram : depthProgram;
+        auto &instancedProgram =
+            pass.cube ? instancedPointShadowProgram : instancedDepthProgram;
+        for (auto *shader : {&program, &instancedProgram}) {
+          shader->use();
+          shader->setMat4("view", glm::mat4(1.0f));
+          if (pass.cube) {
+            shader->setMat4("projection", glm::mat4(1.0f));
+            for (int face{}; face < 6; face++) {
+              cg::FrameString name;
+              std::format_to(std::back_inserter(name), "faceMatrices[{}]", face);
+              shader->setMat4(name.c_str(), pass.matrices[face]);
+            }
+            shader->setInt("layerBase", pass.layer);
+            shader->setVec3("lightPosition", pass.bounds.center);
+            shader->setFloat("farPlane", pass.bounds.radius);
+          } else {
+            shader->setMat4("projection", pass.matrices[0]);
+          }
+        }
+        program.use();
+        program.setMat4("model", glm::mat4(1.0f));
+        if (cg::intersects(pass.bounds, cubeBounds)) {
+          glBindVertexArray(VAO);
+          glDrawArrays(GL_TRIANGLES, 0, 36);
+        }
+        loaded_model.Draw(program, localCasterMeshes);
+        localCasterBatcher.draw();
+      };
+  cg::LightClusters lightClusters;
+  // 定向光和手电筒, 每帧写入 Lighting 块
+  auto lightingBlock = [&] {
+    LightingBlock block{};
+    block.dirDirection = glm::vec4(dirLightDirection, 0.0f);
+    block.dirAmbient = glm::vec4(0.05f, .05f, 0.05f, 0.0f);
+    block.dirDiffuse = glm::vec4(0.4f, .4f, 0.4f, 0.0f);
+    block.dirSpecular = glm::vec4(0.5f, .5f, 0.5f, 0.0f);
+    block.spotPosition = glm::vec4(frame->cameraPos, 1.0f);
+    block.spotDirection = frame->cameraFront;
+    block.spotCutOff = glm::cos(glm::radians(12.5f));
+    block.spotOuterCutOff = glm::cos(glm::radians(15.5f));
+    block.spotAmbient = glm::vec4(.2f, .2f, .2f, 0.0f);
+    block.spotDiffuse = glm::vec4(.8f, .8f, .8f, 0.0f);
+    block.spotSpecular = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
+    block.viewPos = glm::vec4(frame->cameraPos, 1.0f);
+    return block;
+  };
+  // 光照参数在 uniform 块中, 这里只绑定阴影和分簇光源表的纹理
+  auto setLighting = [&](const cg::Shader &shader) {
+    cascades.bind(shader, 11);
+    localShadows.bind(shader, 12);
+    // 点光源与聚光: 纹理单元 8..10 留给分簇光源表
+    lightClusters.bind(shader, 8);
+  };
   glEnable(GL_STENCIL_TEST);
   glEnable(GL_BLEND);
   glEnable(GL_DEPTH_TEST);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
   glStencilFunc(GL_ALWAYS, 1, 0xff);         // 设置模板测试函数
   glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE); // 设置模板测试操作
-  while (!glfwWindowShouldClose(window)) {
-    currentFrame = glfwGetTime();
-    deltaTime = currentFrame - lastFrame;
-    lastFrame = currentFrame;
-    processInput(window);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-    glStencilFunc(GL_ALWAYS, 1, 0xff); // 设置模板测试函数
-    glEnable(GL_STENCIL_TEST);
-    glEnable(GL_BLEND);
-    glEnable(GL_DEPTH_TEST);
-
-    glStencilMask(0xff);
-
-    glClearColor(.0f, .0f, .0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-    float randomAngle = std::sin(glfwGetTime()) * 180.0f;
-    randomAngle = std::sin(glfwGetTime()) * 180.0f;
-    auto view = camera.lookAt();
-    auto projection{glm::perspective(
-        glm::radians(fov), (float)width / (float)height, 0.1f, 100.0f)};
-
-    auto model{glm::mat4(1.0f)};
-    auto trans = projection * view * model;
+  /**
+   * @brief 模拟线程: 相机, 光源运动, 变换层次以及视锥和遮挡剔除
+   * 渲染线程绘制第 N 帧时模拟线程准备第 N + 1 帧, 发布后等它被取走再
+   * 继续, 最多领先一帧. 相机, 场景组件和遮挡缓冲在启动后只由这个线程
+   * 修改; GLFW 要求事件和输入在主线程处理, 所以主线程就是渲染线程.
+   */
+  cg::TripleBuffer<InputState> inputs;
+  auto simulate = [&](FramePacket &packet, const InputState &state,
+                      const InputState &previous, float time,
+                      float deltaTime) {
+    applyInput(state, previous, deltaTime);
+    scene.parallelEach<cg::ClusterLight, LightOrbit>(
+        [&](cg::ClusterLight &light, const LightOrbit &orbit) {
+          auto theta = orbit.phase + orbit.speed * time;
+          light.position = glm::vec3(orbit.radius * std::cos(theta),
+                                     orbit.height,
+                                     orbit.radius * std::sin(theta));
+        });
+    // 传播本帧修改过的局部变换, 没有节点改动时立即返回
+    sceneTransforms.update();
+    // 有节点更新时刷新世界包围盒, 场景索引和阴影交给渲染线程
+    packet.movedObjects.clear();
+    if (sceneTransforms.updatedCount() > 0) {
+      scene.each<SceneNode, Bounds>([&](cg::Entity entity,
+                                        const SceneNode &node,
+                                        const Bounds &bounds) {
+        auto box = bounds.local.transformed(sceneTransforms.world(node.node));
+        auto &old = sceneBoxes[bounds.object];
+        if (box.min != old.min || box.max != old.max) {
+          packet.movedObjects.push_back(
+              {bounds.object, old, box, scene.has<ShadowCaster>(entity)});
+          old = box;
+          sceneBounds.set(bounds.object, box);
+        }
+      });
+    }
+    packet.time = time;
+    packet.fov = fov;
+    // 最小化时帧缓冲为 0, 沿用之前的宽高比
+    if (state.framebufferWidth > 0 && state.framebufferHeight > 0) {
+      packet.aspect =
+          (float)state.framebufferWidth / (float)state.framebufferHeight;
+    }
+    packet.view = camera.lookAt();
+    packet.projection = glm::perspective(glm::radians(fov), packet.aspect,
+                                         0.1f, 100.0f);
+    packet.cameraPos = camera.cameraPos;
+    packet.cameraFront = camera.cameraFront;
+    packet.lights.clear();
+    packet.shadowedLights.clear();
+    scene.each<cg::ClusterLight>([&](const cg::ClusterLight &light) {
+      packet.lights.push_back(light);
+      if (light.shadowSlot >= 0) {
+        packet.shadowedLights.push_back(
+            {light.shadowSlot, light.position, light.radius});
+      }
+    });
 
-    glStencilMask(0x00);
-    /**
-     * @brief 绘制天空盒
-     *
-     */
-    skyboxShader.use();
-    skyboxShader.setMat4("view", glm::mat4(glm::mat3(view)));
-    skyboxShader.setMat4("projection", projection);
-    glBindVertexArray(skyboxVAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-    glDepthMask(GL_FALSE);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
-    glDepthMask(GL_TRUE);
+    auto &visible = packet.visible;
+    cg::cullBounds(camera.frustum(packet.projection), sceneBounds, visible);
+    auto viewProjection = packet.projection * packet.view;
+    occlusion.clear();
+    scene.each<SceneNode, Bounds, Occluder>(
+        [&](const SceneNode &node, const Bounds &bounds, const Occluder &) {
+          if (visible[bounds.object]) {
+            occlusion.rasterize(viewProjection *
+                                    sceneTransforms.world(node.node),
+                                cubeOccluderVertices, cubeOccluderIndices);
+          }
+        });
+    occlusion.buildHierarchy();
+    for (std::size_t i{}; i < visible.size(); i++) {
+      if (visible[i] && !occlusion.isVisible(sceneBoxes[i], viewProjection)) {
+        visible[i] = 0;
+      }
+    }
 
-    /**
-     * @brief 绘制光源
-     */
-    lightShaderProgram.use();
-    glBindVertexArray(lightVAO);
-    for (std::size_t i{}; i < std::size(pointLightPositions); i++) {
-      model = glm::translate(model, pointLightPositions[i]);
-      trans = projection * view * model;
-      lightShaderProgram.setMat4("trans", trans);
-      glDrawArrays(GL_TRIANGLES, 0, 36);
+    packet.lightMarkers.clear();
+    scene.each<SceneNode, Bounds, LightMarker>(
+        [&](const SceneNode &node, const Bounds &bounds, const LightMarker &) {
+          if (visible[bounds.object]) {
+            packet.lightMarkers.push_back(sceneTransforms.world(node.node));
+          }
+        });
+    packet.instances.clear();
+    scene.each<SceneNode, Renderable, Bounds>([&](const SceneNode &node,
+                                                  const Renderable &renderable,
+                                                  const Bounds &bounds) {
+      if (visible[bounds.object]) {
+        packet.instances.push_back({renderable.mesh, renderable.material,
+                                    sceneTransforms.world(node.node)});
+      }
+    });
+    packet.windows.clear();
+    packet.windowDepths.clear();
+    scene.each<SceneNode, Bounds, Transparent>(
+        [&](const SceneNode &node, const Bounds &bounds, const Transparent &) {
+          if (visible[bounds.object]) {
+            const auto &world = sceneTransforms.world(node.node);
+            packet.windows.push_back(world);
+            packet.windowDepths.push_back(
+                glm::distance(camera.cameraPos, glm::vec3(world[3])));
+          }
+        });
+    packet.objectWorlds.resize(sceneBoxes.size());
+    scene.each<SceneNode, Bounds>([&](const SceneNode &node,
+                                      const Bounds &bounds) {
+      packet.objectWorlds[bounds.object] = sceneTransforms.world(node.node);
+    });
+  };
+  std::jthread simulation{[&] {
+    cg::FrameArena simulationArena;
+    cg::FrameArena::Scope arenaScope{simulationArena};
+    InputState previous;
+    auto lastTime = static_cast<float>(glfwGetTime());
+    while (packets.waitConsumed()) {
+      auto time = static_cast<float>(glfwGetTime());
+      inputs.acquire();
+      simulate(packets.back(), inputs.front(), previous, time,
+               time - lastTime);
+      previous = inputs.front();
+      lastTime = time;
+      packets.publish();
+      simulationArena.reset();
     }
-    /**
-     * @brief 绘制立方体以及光源
-     */
-    shaderProgram.use();
+  }};
+  // 工作线程占用其余核心, GL 线程绑定到留给它的 0 号核心;
+  // 放在模拟线程启动之后, 它不会继承这个亲和性
+  cg::JobSystem::shared().pinCallingThread();
+
+  /**
+   * @brief 渲染图: 各阶段声明读写的纹理, 临时目标由图分配, 生命周期不重叠
+   * 的同格式目标共用纹理 (例如 G-buffer 位置与 OIT 累积). 阶段内容在
+   * execute 时读取当前的帧数据; 切换着色或透明路径时重新声明并编译
+   */
+  bool depthPrepass{false};
+  // 不透明物体中非实例化的部分: 原点处带描边的立方体和模型
+  auto drawOpaque = [&](cg::Shader &geometryProgram) {
+    geometryProgram.use();
     glBindVertexArray(VAO);
-    auto lightCenterPos =
-        trans * glm::vec4(lightCenter[0], lightCenter[1], lightCenter[2], 1.0f);
-
-    // 定向光
-    shaderProgram.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-    shaderProgram.setVec3("dirLight.ambient", 0.05f, .05f, 0.05f);
-    shaderProgram.setVec3("dirLight.diffuse", 0.4f, .4f, 0.4f);
-    shaderProgram.setVec3("dirLight.specular", 0.5f, .5f, 0.5f);
-
-    // 点光源
-    for (std::size_t i{}; i < std::size(pointLightPositions); i++) {
-      std::string pl_format = std::format("pointLights[{}].", i);
-      shaderProgram.setVec3(pl_format + std::string("position"),
-                            pointLightPositions[i]);
-      shaderProgram.setFloat(pl_format + std::string("constant"), 1.0f);
-      shaderProgram.setFloat(pl_format + std::string("linear"), .09f);
-      shaderProgram.setFloat(pl_format + std::string("quadratic"), .032f);
-      shaderProgram.setVec3(pl_format + std::string("ambient"),
-                            glm::vec3(.2f, .2f, .2f));
-      shaderProgram.setVec3(pl_format + std::string("diffuse"),
-                            glm::vec3(.8f, .8f, .8f));
-      shaderProgram.setVec3(pl_format + std::string("specular"),
-                            glm::vec3(1.0f, 1.0f, 1.0f));
-    }
-    model = glm::mat4(1.0f);
-    shaderProgram.setVec3("spotLight.ambient", glm::vec3(.2f, .2f, .2f));
-    shaderProgram.setVec3("spotLight.diffuse", glm::vec3(.8f, .8f, .8f));
-    shaderProgram.setVec3("spotLight.specular", glm::vec3(1.0f, 1.0f, 1.0f));
-
-    shaderProgram.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-    shaderProgram.setFloat("spotLight.outerCutOff",
-                           glm::cos(glm::radians(15.5f)));
-    shaderProgram.setVec3("spotLight.direction", camera.cameraFront);
-    shaderProgram.setVec3("spotLight.position", camera.cameraPos);
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture);
-    shaderProgram.setInt("material.diffuse", 0);
+    glBindTexture(GL_TEXTURE_2D, resources.texture(texture));
+    geometryProgram.setInt("material.diffuse", 0);
     glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, texture_sepc);
-    shaderProgram.setInt("material.specular", 1);
-    shaderProgram.setFloat("material.shininess", 64.0f);
+    glBindTexture(GL_TEXTURE_2D, resources.texture(texture_sepc));
+    geometryProgram.setInt("material.specular", 1);
+    geometryProgram.setFloat("material.shininess", 64.0f);
     auto coord_trans = glm::vec2(.0f, 1.0f + std::sin(glfwGetTime()) / 2.0f);
-    shaderProgram.setVec2("coord_trans", coord_trans);
+    geometryProgram.setVec2("coord_trans", coord_trans);
 
-    shaderProgram.setVec3("viewPos", camera.cameraPos);
-    shaderProgram.setMat4("model", model);
-    shaderProgram.setMat4("view", view);
-    shaderProgram.setMat4("projection", projection);
+    auto model = glm::mat4(1.0f);
+    geometryProgram.setMat4("model", model);
+    geometryProgram.setMat3("normalMatrix", cg::normalMatrix(model));
 
     glStencilFunc(GL_ALWAYS, 1, 0xFF);
     glStencilMask(0xFF);
@@ -894,108 +1648,481 @@ int main() {
     /**
      * @brief 加载并绘制模型
      */
-    loaded_model.Draw(shaderProgram);
+    loaded_model.Draw(geometryProgram,
+                      std::span(frame->visible).first(modelMeshCount));
+  };
+  cg::RenderTargetPool renderTargets;
+  cg::RenderGraph graph{renderTargets};
+  cg::RenderGraph::Resource sceneColor{};
+  auto buildGraph = [&] {
+    graph.reset();
+    // 场景阶段的目标都按动态分辨率渲染, 直到 present 放大
+    sceneColor = graph.createTexture(
+        "scene color", {renderWidth, renderHeight, hdrFormat}, true);
+    const auto sceneDepth = graph.createTexture(
+        "scene depth", {renderWidth, renderHeight, GL_DEPTH24_STENCIL8}, true);
+    const auto backbuffer = graph.backbuffer(renderWidth, renderHeight);
+
+    // 阴影贴图跨帧缓存, 不属于渲染图管理的临时目标
+    graph
+        .addPass("shadows",
+                 [&](const cg::RenderGraph &) {
+                   cascades.update(frame->view, glm::radians(frame->fov),
+                                   frame->aspect, 0.1f,
+                                   dirLightDirection, staticCasterVersion,
+                                   drawCasters);
+                   for (const auto &light : frame->shadowedLights) {
+                     localShadows.setPointLight(light.slot, light.position,
+                                                light.radius);
+                   }
+                   localShadows.setSpotLight(frame->cameraPos,
+                                             frame->cameraFront,
+                                             glm::radians(15.5f), 50.0f);
+                   localShadows.update(drawLocalCasters);
+                   uploadBlock(cascadesBlockBinding, cascades.block());
+                   uploadBlock(localShadowsBlockBinding,
+                               localShadows.block());
+                 })
+        .sideEffect();
+
+    graph
+        .addPass(
+            "background",
+            [&](const cg::RenderGraph &) {
+              glStencilFunc(GL_ALWAYS, 1, 0xff); // 设置模板测试函数
+              glEnable(GL_STENCIL_TEST);
+              glEnable(GL_BLEND);
+              glEnable(GL_DEPTH_TEST);
+              glStencilMask(0xff);
+              glClearColor(.0f, .0f, .0f, 1.0f);
+              glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT |
+                      GL_STENCIL_BUFFER_BIT);
+              glStencilMask(0x00);
+              /**
+               * @brief 绘制天空盒
+               */
+              skyboxShader.use();
+              skyboxShader.setMat4("view", glm::mat4(glm::mat3(frame->view)));
+              skyboxShader.setMat4("projection", frame->projection);
+              glBindVertexArray(skyboxVAO);
+              glActiveTexture(GL_TEXTURE0);
+              glBindTexture(GL_TEXTURE_CUBE_MAP,
+                            resources.texture(cubemapTexture));
+              glDepthMask(GL_FALSE);
+              glDrawArrays(GL_TRIANGLES, 0, 36);
+              glDepthMask(GL_TRUE);
+              /**
+               * @brief 绘制光源
+               */
+              auto viewProjection = frame->projection * frame->view;
+              lightShaderProgram.use();
+              glBindVertexArray(lightVAO);
+              for (const auto &world : frame->lightMarkers) {
+                lightShaderProgram.setMat4("trans", viewProjection * world);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+              }
+            })
+        .write(sceneColor)
+        .write(sceneDepth);
+
+    if (deferredShading) {
+      // 延迟模式下不透明物体只写 G-buffer, 光照在之后统一计算
+      std::array<cg::RenderGraph::Resource, 3> gBuffer;
+      constexpr std::array gBufferNames{"g-buffer position", "g-buffer normal",
+                                        "g-buffer albedo"};
+      for (std::size_t i{}; i < gBuffer.size(); i++) {
+        gBuffer[i] = graph.createTexture(
+            gBufferNames[i],
+            {renderWidth, renderHeight,
+             cg::DeferredRenderer::gBufferFormats[i]},
+            true);
+      }
+      graph
+          .addPass("g-buffer",
+                   [&](const cg::RenderGraph &) {
+                     deferred.beginGeometry();
+                     // 通过深度测试的样本数, 即不透明物体的片段着色次数
+                     shadedSamples.begin();
+                     drawOpaque(gBufferProgram);
+                     instancedGBufferProgram.use();
+                     instancedGBufferProgram.setInt("material.diffuse", 0);
+                     instancedGBufferProgram.setInt("material.specular", 1);
+                     batcher.draw(cubeGBufferMaterial);
+                     shadedSamples.end();
+                   })
+          .write(gBuffer[0])
+          .write(gBuffer[1])
+          .write(gBuffer[2])
+          .write(sceneDepth);
+      graph
+          .addPass("deferred lighting",
+                   [&, gBuffer](const cg::RenderGraph &g) {
+                     deferredAmbientShader.use();
+                     setLighting(deferredAmbientShader);
+                     deferredAmbientShader.setFloat("shininess", 64.0f);
+                     lightVolumeShader.use();
+                     lightVolumeShader.setMat4("view", frame->view);
+                     lightVolumeShader.setMat4("projection",
+                                               frame->projection);
+                     lightVolumeShader.setVec3("viewPos", frame->cameraPos);
+                     lightVolumeShader.setFloat("shininess", 64.0f);
+                     localShadows.bind(lightVolumeShader, 12);
+                     deferred.light(
+                         {g.texture(gBuffer[0]), g.texture(gBuffer[1]),
+                          g.texture(gBuffer[2])},
+                         deferredAmbientShader, quadVAO, lightVolumeShader,
+                         lightClusters.lightDataTexture(),
+                         static_cast<GLsizei>(lightClusters.lightCount()));
+                   })
+          .read(gBuffer[0])
+          .read(gBuffer[1])
+          .read(gBuffer[2])
+          .write(sceneColor)
+          .write(sceneDepth);
+    } else {
+      graph
+          .addPass(
+              "forward opaque",
+              [&](const cg::RenderGraph &) {
+                /**
+                 * @brief 深度预通道: 不透明物体只写深度, 主阶段以 GL_LEQUAL
+                 * 且不写深度绘制, 每个像素只有最前面的片段会执行光照着色器
+                 * 草带 alpha 测试, 不参与预通道
+                 */
+                if (depthPrepass) {
+                  glStencilMask(0x00);
+                  depthProgram.use();
+                  depthProgram.setMat4("model", glm::mat4(1.0f));
+                  depthProgram.setMat4("view", frame->view);
+                  depthProgram.setMat4("projection", frame->projection);
+                  glBindVertexArray(VAO);
+                  glDrawArrays(GL_TRIANGLES, 0, 36);
+                  loaded_model.Draw(
+                      depthProgram,
+                      std::span(frame->visible).first(modelMeshCount));
+                  instancedDepthProgram.use();
+                  instancedDepthProgram.setMat4("view", frame->view);
+                  instancedDepthProgram.setMat4("projection",
+                                                frame->projection);
+                  batcher.draw(cubeDepthMaterial);
+                  glDepthFunc(GL_LEQUAL);
+                  glDepthMask(GL_FALSE);
+                }
+                shadedSamples.begin();
+                shaderProgram.use();
+                setLighting(shaderProgram);
+                drawOpaque(shaderProgram);
+                instancedShaderProgram.use();
+                setLighting(instancedShaderProgram);
+                instancedShaderProgram.setInt("material.diffuse", 0);
+                instancedShaderProgram.setInt("material.specular", 1);
+                instancedShaderProgram.setFloat("material.shininess", 64.0f);
+                batcher.draw(cubeMaterial);
+                shadedSamples.end();
+                if (depthPrepass) {
+                  glDepthMask(GL_TRUE);
+                  glDepthFunc(GL_LESS);
+                }
+              })
+          .write(sceneColor)
+          .write(sceneDepth);
+    }
 
-    glBindVertexArray(VAO);
-    for (std::size_t i{}; i < sizeof(cubePositions) / sizeof(glm::vec3); i++) {
-      glm::mat4 model{1.0f};
-      model = glm::rotate(glm::translate(model, cubePositions[i]),
-                          glm::radians(0.0f), glm::vec3(1.0f, 0.3f, 0.5f));
-
-      shaderProgram.setMat4("model", model);
-      glActiveTexture(GL_TEXTURE0);
-      glBindTexture(GL_TEXTURE_2D, texture);
-      glActiveTexture(GL_TEXTURE1);
-      glBindTexture(GL_TEXTURE_2D, texture_sepc);
-      glDrawArrays(GL_TRIANGLES, 0, 36);
-      grassShaderProgram.use();
-      glActiveTexture(GL_TEXTURE0);
-      glBindTexture(GL_TEXTURE_2D, grass_texture);
-      grassShaderProgram.setInt("texture1", 0);
-      grassShaderProgram.setMat4("view", view);
-      grassShaderProgram.setMat4("projection", projection);
-      grassShaderProgram.setVec3("viewPos", camera.cameraPos);
-      model = glm::translate(model, glm::vec3(0.0f, 0.f, -0.01f));
-      grassShaderProgram.setMat4("model", model);
-      glDrawArrays(GL_TRIANGLES, 0, 6);
-      shaderProgram.use();
-    }
-    grassShaderProgram.use();
-    glBindVertexArray(VAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, grass_texture);
-    grassShaderProgram.setInt("texture1", 0);
-    grassShaderProgram.setMat4("view", view);
-    grassShaderProgram.setMat4("projection", projection);
-    float radius = 10.f;
-    int grass_count{40};
-    for (int i : std::ranges::iota_view(0, grass_count)) {
-      model = glm::mat4(1.0f);
-      float theta = glm::radians(360.0f / grass_count * i);
-      auto location =
-          glm::vec3(radius * std::cos(theta), 0.0f, radius * std::sin(theta));
-      model = glm::translate(model, location);
-      grassShaderProgram.setMat4("model", model);
-      glDrawArrays(GL_TRIANGLES, 0, 6);
+    graph
+        .addPass("forward",
+                 [&](const cg::RenderGraph &) {
+                   // 草只做 alpha 测试不受光照, 两种模式下都前向绘制
+                   instancedGrassProgram.use();
+                   instancedGrassProgram.setInt("texture1", 0);
+                   instancedGrassProgram.setVec3("viewPos", frame->cameraPos);
+                   batcher.draw(grassMaterial);
+                   /**
+                    * @brief 绘制边框
+                    */
+                   auto model = glm::scale(glm::mat4(1.0f), glm::vec3(1.1f));
+                   largeShaderProgram.use();
+                   glBindVertexArray(VAO);
+                   largeShaderProgram.setMat4("model", model);
+                   largeShaderProgram.setMat4("view", frame->view);
+                   largeShaderProgram.setMat4("projection",
+                                              frame->projection);
+                   glStencilFunc(GL_NOTEQUAL, 1, 0xff);
+                   glStencilMask(0x00);
+                   glDrawArrays(GL_TRIANGLES, 0, 36);
+                   glStencilFunc(GL_ALWAYS, 1, 0xff);
+                   if (sortedTransparency) {
+                     instancedWindowProgram.use();
+                     instancedWindowProgram.setInt("texture1", 0);
+                     transparentBatcher.draw();
+                   }
+                 })
+        .write(sceneColor)
+        .write(sceneDepth);
+
+    if (!sortedTransparency) {
+      const auto accum = graph.createTexture(
+          "oit accum",
+          {renderWidth, renderHeight, cg::TransparencyPass::accumFormat},
+          true);
+      const auto reveal = graph.createTexture(
+          "oit reveal",
+          {renderWidth, renderHeight, cg::TransparencyPass::revealFormat},
+          true);
+      graph
+          .addPass("oit accumulate",
+                   [&](const cg::RenderGraph &) {
+                     transparency.beginAccumulate();
+                     windowAccumProgram.use();
+                     windowAccumProgram.setInt("texture1", 0);
+                     transparentBatcher.draw();
+                   })
+          .write(accum)
+          .write(reveal)
+          .write(sceneDepth);
+      graph
+          .addPass("oit composite",
+                   [&, accum, reveal](const cg::RenderGraph &g) {
+                     transparency.composite(g.texture(accum),
+                                            g.texture(reveal),
+                                            oitCompositeShader, quadVAO);
+                   })
+          .read(accum)
+          .read(reveal)
+          .write(sceneColor);
     }
-    /**
-     * @brief 绘制边框
-     *
-     */
-    model = glm::mat4(1.0f);
-    largeShaderProgram.use();
-    glBindVertexArray(VAO);
-    model = glm::scale(model, glm::vec3(1.1f));
-    largeShaderProgram.setMat4("model", model);
-    largeShaderProgram.setMat4("view", view);
-    largeShaderProgram.setMat4("projection", projection);
-    glStencilFunc(GL_NOTEQUAL, 1, 0xff);
-    glStencilMask(0x00);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
 
-    glStencilFunc(GL_ALWAYS, 1, 0xff);
+    // 泛光取自后处理之前的 HDR 场景
+    const auto bloomOutput =
+        bloomEnabled ? bloom.addPasses(graph, sceneColor) : sceneColor;
+    const auto postOutput = post.addPasses(graph, sceneColor);
+    auto present = graph.addPass(
+        "present", [&, postOutput, bloomOutput](const cg::RenderGraph &g) {
+          // 默认帧缓冲随窗口大小变化
+          int framebufferWidth, framebufferHeight;
+          glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+          glViewport(0, 0, framebufferWidth, framebufferHeight);
+          glDisable(GL_STENCIL_TEST);
+          glDisable(GL_DEPTH_TEST);
+          glClearColor(.0f, .0f, .0f, 1.0f);
+          glClear(GL_COLOR_BUFFER_BIT);
+          // 只采样本帧渲染的区域, 双线性放大到窗口
+          auto [sceneWidth, sceneHeight] = g.extent(postOutput);
+          const auto &desc = g.desc(postOutput);
+          auto size = glm::vec2(desc.width, desc.height);
+          auto extent = glm::vec2(sceneWidth, sceneHeight);
+          presentShader.use();
+          presentShader.setVec2("uvScale", extent / size);
+          presentShader.setVec2("uvMax", (extent - 0.5f) / size);
+          post.setPresentOps(presentShader);
+          if (bloomEnabled) {
+            bloom.bind(g, bloomOutput, presentShader, 1);
+          } else {
+            presentShader.setFloat("bloomIntensity", 0.0f);
+          }
+          presentShader.setInt("tonemap", tonemapOperator);
+          glBindVertexArray(quadVAO);
+          glActiveTexture(GL_TEXTURE0);
+          glBindTexture(GL_TEXTURE_2D, g.texture(postOutput));
+          glDrawArrays(GL_TRIANGLES, 0, 6);
+          glStencilFunc(GL_ALWAYS, 1, 0xff);
+        });
+    present.read(postOutput).write(backbuffer);
+    if (bloomEnabled) {
+      present.read(bloomOutput);
+    }
+    graph.compile();
+    console_log("render graph: ", graph.executedPassCount(), "/",
+                graph.passCount(), " passes at ", renderWidth, "x",
+                renderHeight, ", ", graph.textureCount(), " targets, ",
+                graph.textureBytes() / 1024, " KiB (",
+                graph.requestedBytes() / 1024, " KiB without aliasing), ",
+                renderTargets.idleCount(), " idle in pool, ",
+                renderTargets.createdCount(), " created in total");
+    console_log("post process: ", post.effects().size(), " effects in ",
+                post.passCount(), " passes, ", post.samplesPerPixel(),
+                " samples/pixel (", post.naiveSamplesPerPixel(),
+                " with one full resolution pass per effect)");
+    if (bloomEnabled) {
+      console_log("bloom: ", bloom.levelCount(), " levels, ",
+                  bloom.samplesPerPixel(), " samples/pixel");
+    }
+  };
+  bool graphDirty{true};
+  // 场景索引和阴影缓存只由渲染线程访问, 在这里跟上模拟线程的移动
+  auto applyMovedObjects = [&] {
+    auto castersMoved = false;
+    for (const auto &moved : frame->movedObjects) {
+      sceneIndex.update(moved.object, moved.to);
+      if (moved.caster) {
+        localShadows.invalidate(moved.from);
+        localShadows.invalidate(moved.to);
+        castersMoved = true;
+      }
+    }
+    if (castersMoved) {
+      casterBatcher.clear();
+      for (auto object : casterObjects) {
+        casterBatcher.append(casterCube, casterMaterial,
+                             frame->objectWorlds[object]);
+      }
+      casterBatcher.upload();
+      staticCasterVersion++;
+    }
+  };
 
-    /**
-     * @brief 绘制窗户
-     */
-    windowShaderProgram.use();
-    glBindVertexArray(VAO);
-    windowShaderProgram.setMat4("view", view);
-    windowShaderProgram.setMat4("projection", projection);
-    windowShaderProgram.setInt("texture1", 0);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, window_texture);
-    for (std::size_t i{}; i < std::size(windowPositions); i++) {
-      model = glm::translate(model, windowPositions[i]);
-      windowShaderProgram.setMat4("model", model);
-      glDrawArrays(GL_TRIANGLES, 0, 6);
+  while (!glfwWindowShouldClose(window)) {
+    processInput(window);
+    inputs.back() = input;
+    inputs.publish();
+    packets.waitPublished();
+    packets.acquire();
+    frame = &packets.front();
+    applyMovedObjects();
+    // 左键拾取: 沿视线方向查询场景索引
+    auto clicked =
+        glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+    if (clicked && !picking) {
+      float distance{};
+      auto hit = sceneIndex.raycast({frame->cameraPos, frame->cameraFront},
+                                    &distance);
+      if (hit != cg::Bvh::invalid) {
+        console_log("picked ", describeObject(hit), " at ", distance);
+      }
+    }
+    picking = clicked;
+    if (keyPressed(window, GLFW_KEY_T)) {
+      sortedTransparency = !sortedTransparency;
+      console_log("transparency: ",
+                  sortedTransparency ? "radix sorted" : "weighted blended OIT");
+      graphDirty = true;
+    }
+    if (keyPressed(window, GLFW_KEY_G)) {
+      deferredShading = !deferredShading;
+      console_log("shading: ", deferredShading ? "deferred" : "forward");
+      graphDirty = true;
+    }
+    if (keyPressed(window, GLFW_KEY_Z)) {
+      depthPrepassEnabled = !depthPrepassEnabled;
+      console_log("depth prepass: ", depthPrepassEnabled ? "on" : "off");
+    }
+    if (keyPressed(window, GLFW_KEY_P)) {
+      postPreset = (postPreset + 1) % postPresets.size();
+      post.setEffects(postPresets[postPreset]);
+      graphDirty = true;
+    }
+    if (keyPressed(window, GLFW_KEY_B)) {
+      bloomEnabled = !bloomEnabled;
+      console_log("bloom: ", bloomEnabled ? "on" : "off");
+      graphDirty = true;
+    }
+    if (keyPressed(window, GLFW_KEY_H)) {
+      tonemapOperator = (tonemapOperator + 1) % tonemapNames.size();
+      console_log("tonemap: ", tonemapNames[tonemapOperator]);
+    }
+    if (keyPressed(window, GLFW_KEY_R)) {
+      dynamicResolution = !dynamicResolution;
+      resolution.reset();
+      console_log("dynamic resolution: ", dynamicResolution ? "on" : "off");
     }
 
-    /**
-     * @brief 绑定到默认的framebuffer
-     */
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glDisable(GL_STENCIL_TEST);
-    glDisable(GL_DEPTH_TEST);
-    glClearColor(.0f, .0f, .0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
-    quadShader.use();
-    glBindVertexArray(quadVAO);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glStencilFunc(GL_ALWAYS, 1, 0xff);
+    // 拖动窗口时继续使用旧大小的目标, 由 present 拉伸到窗口
+    resize.request(input.framebufferWidth, input.framebufferHeight,
+                   glfwGetTime());
+    if (resize.settle(glfwGetTime(), renderWidth, renderHeight)) {
+      graphDirty = true;
+    }
+    if (graphDirty) {
+      buildGraph();
+      graphDirty = false;
+    }
+
+    // 等待 GPU 用完本帧区域, 然后先写入相机块和光照块
+    uploadRing.beginFrame();
+    uploadBlock(cameraBlockBinding,
+                std::array<glm::mat4, 2>{frame->view, frame->projection});
+    uploadBlock(lightingBlockBinding, lightingBlock());
+    lightClusters.setProjection(frame->projection, 0.1f, 100.0f);
+    lightClusters.build(frame->lights, frame->view);
+
+    batcher.clear();
+    depthPrepass = depthPrepassEnabled && !deferredShading;
+    for (const auto &instance : frame->instances) {
+      auto material = deferredShading && instance.material == cubeMaterial
+                          ? cubeGBufferMaterial
+                          : instance.material;
+      batcher.append(instance.mesh, material, instance.world);
+      if (depthPrepass && instance.material == cubeMaterial) {
+        batcher.append(instance.mesh, cubeDepthMaterial, instance.world);
+      }
+    }
+    batcher.upload();
+    // OIT 路径与提交顺序无关, 排序路径按视深从远到近依次混合
+    transparentBatcher.clear();
+    if (sortedTransparency) {
+      cg::sortBackToFront(frame->windowDepths, windowOrder);
+      for (auto k : windowOrder) {
+        transparentBatcher.append(windowMesh, windowSortedMaterial,
+                                  frame->windows[k]);
+      }
+    } else {
+      for (const auto &world : frame->windows) {
+        transparentBatcher.append(windowMesh, windowAccumMaterial, world);
+      }
+    }
+    transparentBatcher.upload();
+
+    // 计时结果来自几帧之前, 关闭时按完整分辨率渲染
+    auto gpuMilliseconds = static_cast<float>(gpuTime.result()) / 1.0e6f;
+    graph.setRenderScale(
+        dynamicResolution ? resolution.update(gpuMilliseconds) : 1.0f);
+    auto [sceneWidth, sceneHeight] = graph.extent(sceneColor);
+    // 分簇的屏幕分块按场景本帧实际渲染的像素大小划分
+    uploadBlock(clustersBlockBinding,
+                lightClusters.block(glm::vec2(sceneWidth, sceneHeight)));
+    gpuTime.begin();
+    graph.execute();
+    gpuTime.end();
+    if (frame->time - lastReport >= 1.0f) {
+      lastReport = frame->time;
+      cg::FrameString status;
+      std::format_to(std::back_inserter(status),
+                     "{} | render scale {:.0f}% ({:.1f} ms GPU) | "
+                     "shaded samples {} | depth prepass {} | "
+                     "shadow cascades redrawn {} | local shadow maps "
+                     "redrawn {} | heap allocations/frame {}",
+                     title, graph.renderScale() * 100.0f, gpuMilliseconds,
+                     shadedSamples.result(),
+                     depthPrepass ? "on" : "off", cascades.renderedCascades(),
+                     localShadows.renderedMaps(), frameAllocations);
+      glfwSetWindowTitle(window, status.c_str());
+    }
+    uploadRing.endFrame();
+    renderTargets.endFrame();
 
     glfwPollEvents();
     glfwSwapBuffers(window);
+
+    renderArena.reset();
+    auto allocations = cg::allocationCount();
+    frameAllocations = allocations - allocationsBefore;
+    allocationsBefore = allocations;
+    if (++frameCount > warmupFrames && frameAllocations > 0) {
+      allocatingFrames++;
+      if (frameAllocations > worstFrameAllocations) {
+        worstFrameAllocations = frameAllocations;
+        std::cerr << "frame " << frameCount << ": " << frameAllocations
+                  << " heap allocations in steady state" << std::endl;
+      }
+    }
+  }
+  packets.close();
+  simulation.join();
+  if (allocatingFrames > 0) {
+    std::cerr << allocatingFrames << " of " << frameCount - warmupFrames
+              << " steady-state frames allocated, at most "
+              << worstFrameAllocations << " per frame" << std::endl;
   }
 
-  glDeleteBuffers(1, &VBO);
-  glDeleteBuffers(1, &lightVBO);
-  glDeleteVertexArrays(1, &VAO);
-  glDeleteVertexArrays(1, &lightVAO);
-  glDeleteBuffers(1, &EBO);
-  glDeleteProgram(shaderProgram.ID);
-  glDeleteProgram(lightShaderProgram.ID);
+  resources.clear();
   glfwTerminate();
 }
\ No newline at end of file
@@ -0,0 +1,45 @@
+#version 400 core
+in vec2 TexCoord;
+out vec4 FragColor;
+uniform sampler2D texture1;
+uniform vec2 uvScale = vec2(1.0);
+uniform vec2 uvMax = vec2(1.0);
+// 输入 (较大一级) 一个像素在纹理坐标中的大小
+uniform vec2 texel;
+// 第一级: Karis 平均并去掉阈值以下的亮度
+uniform bool prefilter;
+uniform float threshold;
+uniform float knee;
+vec3 fetch(vec2 uv, float x, float y){
+    return texture(texture1, min(uv + vec2(x, y) * texel, uvMax)).rgb;
+}
+float karisWeight(vec3 c){
+    return 1.0 / (1.0 + max(max(c.r, c.g), c.b));
+}
+// 四个采样的平均, 预过滤时按亮度降低权重, 压制单个极亮像素
+vec4 group(vec3 a, vec3 b, vec3 c, vec3 d){
+    vec3 color = (a + b + c + d) * 0.25;
+    float weight = prefilter ? karisWeight(color) : 1.0;
+    return vec4(color * weight, weight);
+}
+void main(){
+    vec2 uv = min(TexCoord * uvScale, uvMax);
+    // 13 个双线性采样覆盖输入的 6x6 像素
+    vec3 a = fetch(uv, -2.0, 2.0), b = fetch(uv, 0.0, 2.0), c = fetch(uv, 2.0, 2.0);
+    vec3 d = fetch(uv, -1.0, 1.0), e = fetch(uv, 1.0, 1.0);
+    vec3 f = fetch(uv, -2.0, 0.0), g = fetch(uv, 0.0, 0.0), h = fetch(uv, 2.0, 0.0);
+    vec3 i = fetch(uv, -1.0, -1.0), j = fetch(uv, 1.0, -1.0);
+    vec3 k = fetch(uv, -2.0, -2.0), l = fetch(uv, 0.0, -2.0), m = fetch(uv, 2.0, -2.0);
+    vec4 sum = group(d, e, i, j) * 0.5 +
+               (group(a, b, f, g) + group(b, c, g, h) +
+                group(f, g, k, l) + group(g, h, l, m)) * 0.125;
+    vec3 color = sum.rgb / max(sum.a, 1e-4);
+    if (prefilter) {
+        // 软阈值: 在 threshold 附近 knee 的范围内平滑过渡
+        float brightness = max(max(color.r, color.g), color.b);
+        float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+        soft = soft * soft / (4.0 * knee + 1e-4);
+        color *= max(soft, brightness - threshold) / max(brightness, 1e-4);
+    }
+    FragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,27 @@
+#version 400 core
+in vec2 TexCoord;
+out vec4 FragColor;
+// 同一级的下采样结果
+uniform sampler2D baseTexture;
+uniform vec2 baseUvScale = vec2(1.0);
+uniform vec2 baseUvMax = vec2(1.0);
+// 较小一级已经累积的泛光
+uniform sampler2D texture1;
+uniform vec2 uvScale = vec2(1.0);
+uniform vec2 uvMax = vec2(1.0);
+// tent 滤波的步长, 较小一级的像素乘以半径
+uniform vec2 texel;
+vec3 fetch(vec2 uv, float x, float y){
+    return texture(texture1, min(uv + vec2(x, y) * texel, uvMax)).rgb;
+}
+void main(){
+    vec2 uv = min(TexCoord * uvScale, uvMax);
+    // 3x3 tent: 1 2 1 / 2 4 2 / 1 2 1
+    vec3 bloom = (fetch(uv, -1.0, 1.0) + fetch(uv, 1.0, 1.0) +
+                  fetch(uv, -1.0, -1.0) + fetch(uv, 1.0, -1.0)) +
+                 (fetch(uv, 0.0, 1.0) + fetch(uv, -1.0, 0.0) +
+                  fetch(uv, 1.0, 0.0) + fetch(uv, 0.0, -1.0)) * 2.0 +
+                 fetch(uv, 0.0, 0.0) * 4.0;
+    vec3 base = texture(baseTexture, min(TexCoord * baseUvScale, baseUvMax)).rgb;
+    FragColor = vec4(base + bloom / 16.0, 1.0);
+}
@@ -0,0 +1,69 @@
+#version 400 core
+in vec2 TexCoord;
+out vec4 FragColor;
+struct DirLight {
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+struct SpotLight{
+    vec3 position;
+    vec3 direction;
+    float cutOff;
+    float outerCutOff;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+uniform float shininess;
+// 与 multi_lights.frag 相同的 std140 块
+layout(std140) uniform Lighting {
+    DirLight dirLight;
+    SpotLight spotLight;
+    vec3 viewPos;
+};
+// 选择级联所需的观察空间深度
+layout(std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+};
+// 级联和手电筒的阴影, 与 multi_lights.frag 共用
+#include "shadows.glsl"
+void main(){
+    // 动态分辨率下只渲染目标的一部分, 按像素读取而不是用全屏的纹理坐标
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 position = texelFetch(gPosition, pixel, 0);
+    if (position.w == 0.0) {
+        discard;
+    }
+    vec3 fragPos = position.xyz;
+    vec3 norm = normalize(texelFetch(gNormal, pixel, 0).rgb);
+    vec4 albedoSpec = texelFetch(gAlbedoSpec, pixel, 0);
+    vec3 viewDir = normalize(viewPos - fragPos);
+
+    // 定向光
+    vec3 lightDir = normalize(-dirLight.direction);
+    float diff = max(dot(norm, lightDir), 0.0);
+    float spec = pow(max(dot(reflect(-lightDir, norm), viewDir), 0.0), shininess);
+    float shadow = DirShadow(fragPos, norm, -(view * vec4(fragPos, 1.0)).z);
+    vec3 result = albedoSpec.rgb * (dirLight.ambient + dirLight.diffuse * diff * shadow) +
+                  albedoSpec.a * dirLight.specular * spec * shadow;
+
+    // 手电筒
+    lightDir = normalize(spotLight.position - fragPos);
+    float theta = dot(-lightDir, normalize(spotLight.direction));
+    float epsilon = spotLight.cutOff - spotLight.outerCutOff;
+    float intensity = clamp((theta - spotLight.outerCutOff) / epsilon, 0.0, 1.0);
+    shadow = SpotShadow(fragPos, norm);
+    diff = max(dot(norm, lightDir), 0.0);
+    spec = pow(max(dot(reflect(-lightDir, norm), viewDir), 0.0), shininess);
+    result += albedoSpec.rgb * (spotLight.ambient + spotLight.diffuse * diff * intensity * shadow) +
+              albedoSpec.a * spotLight.specular * spec * intensity * shadow;
+    FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,57 @@
+#version 400 core
+flat in int LightIndex;
+out vec4 FragColor;
+#define LIGHT_TEXELS 6
+uniform samplerBuffer lightData;
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+uniform vec3 viewPos;
+uniform float shininess;
+// 光源数据第 5 个纹素的 z 为立方体阴影层, 见 multi_lights.frag
+#include "shadows.glsl"
+void main(){
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    vec4 position = texelFetch(gPosition, pixel, 0);
+    if (position.w == 0.0) {
+        discard;
+    }
+    int base = LightIndex * LIGHT_TEXELS;
+    vec4 positionRadius = texelFetch(lightData, base);
+    vec3 toLight = positionRadius.xyz - position.xyz;
+    float distance = length(toLight);
+    if (distance >= positionRadius.w) {
+        discard;
+    }
+    vec4 ambientConstant = texelFetch(lightData, base + 1);
+    vec4 diffuseLinear = texelFetch(lightData, base + 2);
+    vec4 specularQuadratic = texelFetch(lightData, base + 3);
+    vec3 direction = texelFetch(lightData, base + 4).xyz;
+    vec4 cutOffSlot = texelFetch(lightData, base + 5);
+    vec2 cutOff = cutOffSlot.xy;
+    int shadowSlot = int(cutOffSlot.z);
+
+    vec3 norm = normalize(texelFetch(gNormal, pixel, 0).rgb);
+    vec4 albedoSpec = texelFetch(gAlbedoSpec, pixel, 0);
+    vec3 lightDir = toLight / distance;
+    vec3 viewDir = normalize(viewPos - position.xyz);
+    float diff = max(dot(norm, lightDir), 0.0);
+    float spec = pow(max(dot(viewDir, reflect(-lightDir, norm)), 0.0), shininess);
+    float attenuation = 1.0 / (ambientConstant.w + diffuseLinear.w * distance +
+                               specularQuadratic.w * distance * distance);
+    // 与前向路径 (multi_lights.frag) 相同的半径窗口和聚光衰减
+    float ratio = distance / positionRadius.w;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    float intensity = window * window * attenuation;
+    if (cutOff.y >= -1.0) {
+        float theta = dot(-lightDir, direction);
+        intensity *= clamp((theta - cutOff.y) / (cutOff.x - cutOff.y), 0.0, 1.0);
+    }
+    if (shadowSlot >= 0) {
+        intensity *= PointShadow(shadowSlot, positionRadius.xyz, positionRadius.w,
+                                 position.xyz, norm);
+    }
+    vec3 result = albedoSpec.rgb * (ambientConstant.rgb + diffuseLinear.rgb * diff) +
+                  albedoSpec.a * specularQuadratic.rgb * spec;
+    FragColor = vec4(result * intensity, 1.0);
+}
@@ -0,0 +1,13 @@
+#version 400 core
+layout(location = 0) in vec3 aPos;
+// 每个光源 LIGHT_TEXELS 个纹素, 布局见 cg::LightClusters
+#define LIGHT_TEXELS 6
+uniform samplerBuffer lightData;
+uniform mat4 view;
+uniform mat4 projection;
+flat out int LightIndex;
+void main(){
+    LightIndex = gl_InstanceID;
+    vec4 positionRadius = texelFetch(lightData, gl_InstanceID * LIGHT_TEXELS);
+    gl_Position = projection * view * vec4(positionRadius.xyz + aPos * positionRadius.w, 1.0);
+}
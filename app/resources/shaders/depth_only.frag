@@ -0,0 +1,4 @@
+#version 400 core
+// 只写深度
+void main(){
+}
@@ -0,0 +1,12 @@
+#version 400 core
+layout(location = 0) in vec3 aPos;
+// 深度预通道与光照阶段的程序不同, 声明不变性保证两者的深度逐位一致
+invariant gl_Position;
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+void main() {
+    // 与 vertexShader.vert 相同的运算顺序, 主阶段的 GL_LEQUAL 才能稳定通过
+    vec3 FragPos = vec3(model * vec4(aPos, 1.0));
+    gl_Position = projection*view*vec4(FragPos, 1.0f);
+}
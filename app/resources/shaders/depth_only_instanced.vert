@@ -0,0 +1,10 @@
+#version 400 core
+layout(location = 0) in vec3 aPos;
+layout(location = 3) in mat4 aModel;
+invariant gl_Position;
+uniform mat4 view;
+uniform mat4 projection;
+void main() {
+    vec3 FragPos = vec3(aModel * vec4(aPos, 1.0));
+    gl_Position = projection*view*vec4(FragPos, 1.0f);
+}
@@ -0,0 +1,19 @@
+#version 400 core
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 TextCoord;
+layout(location = 0) out vec4 gPosition;
+layout(location = 1) out vec3 gNormal;
+layout(location = 2) out vec4 gAlbedoSpec;
+struct Material{
+    sampler2D diffuse;
+    sampler2D specular;
+};
+uniform Material material;
+void main(){
+    // w = 1 标记该像素有几何体, 光照阶段据此跳过背景
+    gPosition = vec4(FragPos, 1.0);
+    gNormal = normalize(Normal);
+    gAlbedoSpec = vec4(texture(material.diffuse, TextCoord).rgb,
+                       texture(material.specular, TextCoord).r);
+}
@@ -0,0 +1,23 @@
+#version 400 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(location = 2) in vec2 aTexCoords;
+// 每实例的模型矩阵, 占用 location 3..6
+layout(location = 3) in mat4 aModel;
+// 每实例的法线矩阵, 由 CPU 批量计算, 占用 location 7..9
+layout(location = 7) in mat3 aNormalMatrix;
+out vec3 Normal;
+out vec3 FragPos;
+out vec2 TextCoord;
+invariant gl_Position;
+// 每帧的相机矩阵, 由 CPU 写入上传环并绑定到 0 号绑定点
+layout(std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+};
+void main() {
+    FragPos = vec3(aModel * vec4(aPos, 1.0));
+    gl_Position = projection*view*vec4(FragPos, 1.0f);
+    Normal = aNormalMatrix*aNormal;
+    TextCoord = aTexCoords;
+}
@@ -36,34 +36,59 @@ struct Material{
     sampler2D specular;
     float shininess;
 };
-vec3 CalcDirLight(DirLight light,vec3 normal,vec3 viewDir);
+vec3 CalcDirLight(DirLight light,vec3 normal,vec3 viewDir,float shadow);
 vec3 CalcPointLight(PointLight light,vec3 normal,vec3 fragPos,vec3 viewDir);
-vec3 CalcSpotLight(SpotLight light,vec3 normal,vec3 fragPos,vec3 viewDir);
+vec3 CalcSpotLight(SpotLight light,vec3 normal,vec3 fragPos,vec3 viewDir,float shadow);
+vec3 CalcClusterLight(int index,vec3 normal,vec3 fragPos,vec3 viewDir);
 
-uniform vec3 viewPos;
-
-#define NR_POINT_LIGHTS 4
-// 定向光
-uniform DirLight dirLight;
-// 点光源
-uniform PointLight pointLights[NR_POINT_LIGHTS];
-// 聚光
-uniform SpotLight spotLight;
+// 每帧的光照参数都在 std140 块中, 由上传环写入后按绑定点共享
+// 定向光, 手电筒和相机位置
+layout(std140) uniform Lighting {
+    DirLight dirLight;
+    SpotLight spotLight;
+    vec3 viewPos;
+};
+// 点光源与聚光: 分簇光源表, 由 cg::LightClusters 每帧在 CPU 上构建
+#define LIGHT_TEXELS 6
+uniform samplerBuffer lightData;
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer lightIndices;
+layout(std140) uniform Clusters {
+    ivec3 clusterDims;
+    vec2 clusterTileSize;
+    float clusterNear;
+    float clusterSliceScale;
+};
+// 与顶点着色器相同的相机块, 用于计算观察空间深度
+layout(std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+};
+// 级联, 点光源和手电筒的阴影
+#include "shadows.glsl"
 uniform Material material;
 
 void main() {
     vec3 norm = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
-    vec3 result = CalcDirLight(dirLight,norm,viewDir);
-    for(int i =0; i<NR_POINT_LIGHTS; i++){
-        result += CalcPointLight(pointLights[i],norm,FragPos,viewDir);
+    float depth = -(view * vec4(FragPos, 1.0)).z;
+    vec3 result = CalcDirLight(dirLight,norm,viewDir,DirShadow(FragPos,norm,depth));
+    // 只遍历片段所在簇的光源
+    ivec2 tile = min(ivec2(gl_FragCoord.xy / clusterTileSize), clusterDims.xy - 1);
+    int slice = clamp(int(log(max(depth, clusterNear) / clusterNear) * clusterSliceScale),
+                      0, clusterDims.z - 1);
+    int cluster = (slice * clusterDims.y + tile.y) * clusterDims.x + tile.x;
+    uvec2 range = texelFetch(clusterGrid, cluster).rg;
+    for(uint i = 0u; i < range.y; i++){
+        int light = int(texelFetch(lightIndices, int(range.x + i)).r);
+        result += CalcClusterLight(light,norm,FragPos,viewDir);
     }
-    result += CalcSpotLight(spotLight,norm,FragPos,viewDir);
+    result += CalcSpotLight(spotLight,norm,FragPos,viewDir,SpotShadow(FragPos,norm));
     FragColor = vec4(result,1.0);
     // FragColor = vec4(vec3(gl_FragCoord.z),1.0);
 }
 
-vec3 CalcDirLight(DirLight light,vec3 normal,vec3 viewDir){
+vec3 CalcDirLight(DirLight light,vec3 normal,vec3 viewDir,float shadow){
     vec3 norm = normalize(normal);
     vec3 lightDir = normalize(-light.direction);
     // 环境光
@@ -75,12 +100,11 @@ vec3 CalcDirLight(DirLight light,vec3 normal,vec3 viewDir){
     vec3 reflectDir = reflect(-lightDir,norm);
     float spec = pow(max(dot(reflectDir,viewDir),0.0),material.shininess);
     vec3 specular = texture(material.specular, TextCoord).rgb * light.specular * spec;
-    //叠加
-    vec3 result = ambient + diffuse + specular;
+    //叠加, 阴影只影响漫反射和镜面反射
+    vec3 result = ambient + (diffuse + specular) * shadow;
     return result;
 }
 
-
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
 {
     vec3 lightDir = normalize(light.position - fragPos);
@@ -102,7 +126,7 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     return (ambient + diffuse + specular);
 }
 
-vec3 CalcSpotLight(SpotLight light,vec3 normal,vec3 fragPos,vec3 viewDir){
+vec3 CalcSpotLight(SpotLight light,vec3 normal,vec3 fragPos,vec3 viewDir,float shadow){
     vec3 norm = normalize(normal);
     vec3 lightDir = normalize(light.position - fragPos);
     float theta = dot(-lightDir,normalize(light.direction));
@@ -117,5 +141,32 @@ vec3 CalcSpotLight(SpotLight light,vec3 normal,vec3 fragPos,vec3 viewDir){
     vec3 reflectDir = reflect(-lightDir,norm);
     float spec = pow(max(dot(reflectDir,viewDir),.0),material.shininess);
     vec3 specular = spec*texture(material.specular, TextCoord).rgb * light.specular*intensity;
-    return ambient + diffuse + specular;
-}
\ No newline at end of file
+    return ambient + (diffuse + specular) * shadow;
+}
+
+vec3 CalcClusterLight(int index,vec3 normal,vec3 fragPos,vec3 viewDir){
+    int base = index * LIGHT_TEXELS;
+    vec4 positionRadius = texelFetch(lightData, base);
+    vec4 ambientConstant = texelFetch(lightData, base + 1);
+    vec4 diffuseLinear = texelFetch(lightData, base + 2);
+    vec4 specularQuadratic = texelFetch(lightData, base + 3);
+    vec3 direction = texelFetch(lightData, base + 4).xyz;
+    vec4 cutOffSlot = texelFetch(lightData, base + 5);
+    vec2 cutOff = cutOffSlot.xy;
+    int shadowSlot = int(cutOffSlot.z);
+    PointLight light = PointLight(positionRadius.xyz,
+                                  ambientConstant.w, diffuseLinear.w, specularQuadratic.w,
+                                  ambientConstant.rgb, diffuseLinear.rgb, specularQuadratic.rgb);
+    // 在分簇半径处平滑衰减到 0, 避免簇边界处的硬边
+    float ratio = length(light.position - fragPos) / positionRadius.w;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    float intensity = window * window;
+    if (cutOff.y >= -1.0) {
+        float theta = dot(normalize(fragPos - light.position), direction);
+        intensity *= clamp((theta - cutOff.y) / (cutOff.x - cutOff.y), 0.0, 1.0);
+    }
+    if (shadowSlot >= 0) {
+        intensity *= PointShadow(shadowSlot, light.position, positionRadius.w, fragPos, normal);
+    }
+    return CalcPointLight(light,normal,fragPos,viewDir) * intensity;
+}
@@ -0,0 +1,13 @@
+#version 400 core
+in vec2 TextCoord;
+layout(location = 0) out vec4 accum;
+layout(location = 1) out float reveal;
+uniform sampler2D texture1;
+void main(){
+    vec4 color = texture(texture1, TextCoord);
+    // McGuire & Bavoil 的深度权重: 越近、越不透明的片段权重越大
+    float weight = clamp(pow(min(1.0, color.a * 10.0) + 0.01, 3.0) * 1e8 *
+                         pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+    accum = vec4(color.rgb * color.a, color.a) * weight;
+    reveal = color.a;
+}
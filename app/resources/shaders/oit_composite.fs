@@ -0,0 +1,21 @@
+#version 400 core
+in vec2 TexCoord;
+out vec4 FragColor;
+uniform sampler2D accumTexture;
+uniform sampler2D revealTexture;
+void main(){
+    // 与累积目标逐像素对应, 动态分辨率下只覆盖目标的一部分
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float reveal = texelFetch(revealTexture, pixel, 0).r;
+    // 没有透明片段覆盖的像素
+    if (reveal >= 0.9999) {
+        discard;
+    }
+    vec4 accum = texelFetch(accumTexture, pixel, 0);
+    // 半精度溢出时退化为平均 alpha
+    if (isinf(max(max(abs(accum.r), abs(accum.g)), abs(accum.b)))) {
+        accum.rgb = vec3(accum.a);
+    }
+    vec3 average = accum.rgb / max(accum.a, 1e-5);
+    FragColor = vec4(average, 1.0 - reveal);
+}
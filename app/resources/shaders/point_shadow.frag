@@ -0,0 +1,8 @@
+#version 400 core
+in vec3 WorldPos;
+uniform vec3 lightPosition;
+uniform float farPlane;
+void main(){
+    // 存到光源的距离, 采样时直接与片段到光源的距离比较
+    gl_FragDepth = length(WorldPos - lightPosition) / farPlane;
+}
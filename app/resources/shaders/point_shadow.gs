@@ -0,0 +1,38 @@
+#version 400 core
+// 一遍写入点光源阴影的 6 个面: 每次调用负责一个面
+layout(triangles, invocations = 6) in;
+layout(triangle_strip, max_vertices = 3) out;
+// 顶点着色器输出世界坐标 (view 与 projection 为单位矩阵)
+uniform mat4 faceMatrices[6];
+uniform int layerBase;
+out vec3 WorldPos;
+
+// 三个顶点都在同一个裁剪平面外侧时, 三角形不会落在这个面上
+bool Outside(vec4 a, vec4 b, vec4 c){
+    for(int k = 0; k < 3; k++){
+        if (a[k] < -a.w && b[k] < -b.w && c[k] < -c.w) {
+            return true;
+        }
+        if (a[k] > a.w && b[k] > b.w && c[k] > c.w) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void main(){
+    vec4 clip[3];
+    for(int i = 0; i < 3; i++){
+        clip[i] = faceMatrices[gl_InvocationID] * gl_in[i].gl_Position;
+    }
+    if (Outside(clip[0], clip[1], clip[2])) {
+        return;
+    }
+    for(int i = 0; i < 3; i++){
+        gl_Layer = layerBase + gl_InvocationID;
+        WorldPos = gl_in[i].gl_Position.xyz;
+        gl_Position = clip[i];
+        EmitVertex();
+    }
+    EndPrimitive();
+}
@@ -0,0 +1,27 @@
+#version 400 core
+in vec2 TexCoord;
+out vec4 FragColor;
+uniform sampler2D texture1;
+// 输入只有左下角 uvScale 的区域有效, uvMax 为最后一个有效像素的中心
+uniform vec2 uvScale = vec2(1.0);
+uniform vec2 uvMax = vec2(1.0);
+// 一个输入像素在纹理坐标中的步长, 水平或垂直
+uniform vec2 direction;
+// 线性采样的高斯权重 (cg::linearGaussian): 0 号为中心,
+// 其余采样点位于两个像素之间, 对称地各取一次
+#define MAX_TAPS 8
+uniform int tapCount;
+uniform float offsets[MAX_TAPS];
+uniform float weights[MAX_TAPS];
+vec4 tap(vec2 uv){
+    return texture(texture1, min(uv, uvMax));
+}
+void main(){
+    vec2 uv = min(TexCoord * uvScale, uvMax);
+    vec4 color = texture(texture1, uv) * weights[0];
+    for(int i = 1; i < tapCount; i++){
+        vec2 offset = direction * offsets[i];
+        color += (tap(uv + offset) + tap(uv - offset)) * weights[i];
+    }
+    FragColor = color;
+}
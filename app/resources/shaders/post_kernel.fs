@@ -0,0 +1,22 @@
+#version 400 core
+in vec2 TexCoord;
+out vec4 FragColor;
+uniform sampler2D texture1;
+uniform vec2 uvScale = vec2(1.0);
+uniform vec2 uvMax = vec2(1.0);
+// 一个输入像素在纹理坐标中的大小
+uniform vec2 texel;
+// 3x3 卷积核, 按行从左上到右下
+uniform float kernel[9];
+void main(){
+    vec2 uv = min(TexCoord * uvScale, uvMax);
+    vec3 color = vec3(0.0);
+    for(int y = 0; y < 3; y++){
+        for(int x = 0; x < 3; x++){
+            vec2 offset = vec2(x - 1, 1 - y) * texel;
+            color += texture(texture1, min(uv + offset, uvMax)).rgb * kernel[y * 3 + x];
+        }
+    }
+    // 浮点目标不会截断, 负的边缘响应按 0 处理
+    FragColor = vec4(max(color, vec3(0.0)), 1.0);
+}
@@ -2,60 +2,48 @@
 in vec2 TexCoord;
 out vec4 FragColor;
 uniform sampler2D texture1;
+// 动态分辨率: 输入只占纹理左下角 uvScale 的区域, 双线性放大到整个视口;
+// uvMax 是有效区域内最后一个像素的中心, 避免采样到区域外的旧内容
+uniform vec2 uvScale = vec2(1.0);
+uniform vec2 uvMax = vec2(1.0);
+// 融合的逐像素操作 (cg::PostStack): 每 4 位一个操作码, 低位先执行
+// 1 反相, 2 灰度
+uniform int opCodes = 0;
+// 最终合成 (只在 present 中设置): 叠加泛光 (cg::Bloom), 曝光后色调映射
+// 到 [0, 1]. 后处理的颜色阶段保持默认值, 仍在 HDR 下计算
+uniform sampler2D bloomTexture;
+uniform vec2 bloomUvScale = vec2(1.0);
+uniform vec2 bloomUvMax = vec2(1.0);
+uniform float bloomIntensity = 0.0;
+uniform float exposure = 1.0;
+// 0 不映射, 1 Reinhard, 2 ACES (Narkowicz 的拟合)
+uniform int tonemap = 0;
+vec3 tonemapColor(vec3 color){
+    color *= exposure;
+    if (tonemap == 1) {
+        return color / (1.0 + color);
+    } else if (tonemap == 2) {
+        return clamp((color * (2.51 * color + 0.03)) /
+                     (color * (2.43 * color + 0.59) + 0.14), 0.0, 1.0);
+    }
+    return color;
+}
+vec3 applyOps(vec3 color){
+    for(int code = opCodes; code != 0; code >>= 4){
+        int op = code & 15;
+        if (op == 1) {
+            // HDR 下超过 1 的部分反相后按 0 处理
+            color = max(1.0 - color, 0.0);
+        } else if (op == 2) {
+            color = vec3(dot(color, vec3(.2126, .7152, .0722)));
+        }
+    }
+    return color;
+}
 void main(){
-    // 反相
-    // vec3 col = 1 - texture(texture1, TexCoord).rgb;
-    // 灰度
-    FragColor = texture(texture1, TexCoord);
-//     float average = (.2126*FragColor.r + .7152* FragColor.g + .0722*FragColor.b) / 3.0;
-//     FragColor = vec4(average,average,average, 1.0); 
-
-
-// const float offset = 1.0 / 300.0;
-//     vec2[9] offsets = vec2[9](
-//         vec2(-offset,offset),
-//         vec2(.0f,offset),
-//         vec2(offset,offset),
-//         vec2(-offset,.0f),
-//         vec2(.0f,.0f),
-//         vec2(offset,.0f),
-//         vec2(-offset,-offset),
-//         vec2(.0f,-offset),
-//         vec2(offset,-offset)
-//     );
-//     vec3[9] sampleTex;
-//     for(int i=0;i<9;i++){
-//         sampleTex[i] = vec3(texture(texture1, TexCoord.st + offsets[i]));
-//     }
-//     // float[9] kernel = float[9](
-//     //     -1,-1,-1,
-//     //     -1,9,-1,
-//     //     -1,-1,-1
-//     // );
-//     vec3 col = vec3(0.0);
-//     // for(int i =0;i<9;i++){
-//     //     col += sampleTex[i] * kernel[i];
-//     // }
-//     //核效果
-    
-//     // 模糊
-//     // float[9] blur_kernel = float[9](
-//     //     1.0/16,2.0/16,1.0/16,
-//     //     2.0/16,4.0/16,2.0/16,
-//     //     1.0/16,2.0/16,1.0/16
-//     // );
-//     // for(int i = 0;i<9;i++){
-//     //     col += sampleTex[i] * blur_kernel[i];}
-
-//     //边缘检测
-//     float[9] detection_kernel = float[9](
-//         -1,-1,-1,
-//         -1,8,-1,
-//         -1,-1,-1
-//     );
-//     for(int i=0;i<9;i++){
-//         col += sampleTex[i] * detection_kernel[i];
-//     }
-//     FragColor = vec4(col, 1.0);
-
-}
\ No newline at end of file
+    vec4 color = texture(texture1, min(TexCoord * uvScale, uvMax));
+    if (bloomIntensity > 0.0) {
+        color.rgb += texture(bloomTexture, min(TexCoord * bloomUvScale, bloomUvMax)).rgb * bloomIntensity;
+    }
+    FragColor = vec4(applyOps(tonemapColor(color.rgb)), color.a);
+}
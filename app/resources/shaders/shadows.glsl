@@ -0,0 +1,61 @@
+// 各光照着色器共用的阴影采样, 由 cg::Shader 加载时按 #include 展开
+// 定向光的级联阴影, 由 cg::CascadedShadowMap 绑定
+#define CASCADE_COUNT 4
+uniform sampler2DArrayShadow shadowMap;
+layout(std140) uniform Cascades {
+    mat4 lightSpaceMatrices[CASCADE_COUNT];
+    vec4 cascadeSplits;
+};
+// 点光源与聚光的阴影, 由 cg::LocalShadowMaps 绑定;
+// 光源的立方体阴影层存放在光源数据第 5 个纹素的 z, 小于 0 为无阴影
+uniform samplerCubeArrayShadow pointShadowMaps;
+uniform sampler2DShadow spotShadowMap;
+layout(std140) uniform LocalShadows {
+    mat4 spotLightSpace;
+};
+
+float DirShadow(vec3 fragPos,vec3 normal,float depth){
+    // 选择覆盖该深度的级联; 缓存的级联暂未覆盖时退到下一级
+    vec3 offsetPos = fragPos + normal * 0.02;
+    for(int c = 0; c < CASCADE_COUNT; c++){
+        if (depth > cascadeSplits[c]) {
+            continue;
+        }
+        vec4 lightSpace = lightSpaceMatrices[c] * vec4(offsetPos, 1.0);
+        vec3 coord = lightSpace.xyz / lightSpace.w * 0.5 + 0.5;
+        if (any(lessThan(coord.xy, vec2(0.0))) || any(greaterThan(coord.xy, vec2(1.0)))) {
+            continue;
+        }
+        if (coord.z > 1.0) {
+            return 1.0;
+        }
+        // 3x3 PCF, 每次采样本身是硬件的 2x2 比较
+        vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+        float lit = 0.0;
+        for(int x = -1; x <= 1; x++){
+            for(int y = -1; y <= 1; y++){
+                lit += texture(shadowMap, vec4(coord.xy + vec2(x, y) * texel, c, coord.z));
+            }
+        }
+        return lit / 9.0;
+    }
+    return 1.0;
+}
+
+float PointShadow(int slot,vec3 lightPos,float radius,vec3 fragPos,vec3 normal){
+    // 阴影中存的是距离 / 半径, 比较前减去一个小的偏移
+    vec3 toFrag = fragPos + normal * 0.02 - lightPos;
+    return texture(pointShadowMaps, vec4(toFrag, slot), length(toFrag) / radius - 0.002);
+}
+
+float SpotShadow(vec3 fragPos,vec3 normal){
+    vec4 lightSpace = spotLightSpace * vec4(fragPos + normal * 0.02, 1.0);
+    if (lightSpace.w <= 0.0) {
+        return 1.0;
+    }
+    vec3 coord = lightSpace.xyz / lightSpace.w * 0.5 + 0.5;
+    if (any(lessThan(coord, vec3(0.0))) || any(greaterThan(coord, vec3(1.0)))) {
+        return 1.0;
+    }
+    return texture(spotShadowMap, coord);
+}
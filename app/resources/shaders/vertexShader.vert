@@ -6,14 +6,20 @@ layout(location = 2) in vec2 aTexCoords;
 out vec3 Normal;
 out vec3 FragPos;
 out vec2 TextCoord;
+invariant gl_Position;
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// 每帧的相机矩阵, 与 instanced.vert 共用上传环中的同一个块
+layout(std140) uniform Camera {
+    mat4 view;
+    mat4 projection;
+};
+// transpose(inverse(mat3(model))), 由 CPU 随 model 一起设置
+uniform mat3 normalMatrix;
 // uniform vec2 coord_trans;
 void main() {
     FragPos = vec3(model * vec4(aPos, 1.0));
     gl_Position = projection*view*vec4(FragPos, 1.0f);
     // TexCoord = aTexCoord;
-    Normal = mat3(transpose(inverse(model)))*aNormal;
+    Normal = normalMatrix*aNormal;
     TextCoord = aTexCoords;
 }
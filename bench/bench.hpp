@@ -0,0 +1,36 @@
+#pragma once
+#include <chrono>
+#include <iostream>
+
+namespace bench {
+/**
+ * @brief 检查类 bench 共用的结果统计: 每项输出 ok 或 FAIL,
+ * 有任一项失败时 exitCode 为 1, 供 CTest 判断
+ */
+class Checks {
+public:
+  bool operator()(bool ok, const char *what) {
+    m_failures += !ok;
+    std::cout << (ok ? "ok   " : "FAIL ") << what << std::endl;
+    return ok;
+  }
+  int failures() const { return m_failures; }
+  int exitCode() const { return m_failures == 0 ? 0 : 1; }
+
+private:
+  int m_failures{};
+};
+
+// 预热一次后运行 runs 次, 返回每次的平均耗时 (微秒)
+template <typename Fn> double microseconds(int runs, Fn &&fn) {
+  fn();
+  auto start = std::chrono::steady_clock::now();
+  for (int run{}; run < runs; run++) {
+    fn();
+  }
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - start)
+             .count() /
+         runs;
+}
+} // namespace bench
@@ -0,0 +1,178 @@
+#include "bench.hpp"
+#include <bvh.hpp>
+#include <culling.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+std::vector<std::uint32_t> collect(const cg::Bvh &bvh, const auto &shape) {
+  std::vector<std::uint32_t> result;
+  bvh.query(shape, [&](std::uint32_t object) { result.push_back(object); });
+  std::ranges::sort(result);
+  return result;
+}
+
+std::vector<std::uint32_t> bruteForce(const std::vector<cg::Aabb> &boxes,
+                                      const auto &shape) {
+  std::vector<std::uint32_t> result;
+  for (std::uint32_t i{}; i < boxes.size(); i++) {
+    if (cg::intersects(shape, boxes[i])) {
+      result.push_back(i);
+    }
+  }
+  return result;
+}
+
+bool contains(const std::vector<std::uint32_t> &objects,
+              std::uint32_t object) {
+  return std::ranges::binary_search(objects, object);
+}
+
+cg::Aabb boxAt(const glm::vec3 &center, float half) {
+  return {center - glm::vec3(half), center + glm::vec3(half)};
+}
+} // namespace
+
+/**
+ * @brief BVH refit 检查: 对象经 Bvh::update 移动后, 视锥, 球和射线查询
+ * 要在新位置找到它而旧位置不再返回; 之后随机移动一批对象, 查询结果与
+ * 逐个测试包围盒的结果比较. 结果不符时返回 1. 之后在 1k 到 1M 个
+ * 随机包围盒上输出构建, refit 和查询的耗时, 查询与逐个测试对比
+ */
+int main() {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+
+  // 地面上 32x32 的网格, 上方留空
+  std::vector<cg::Aabb> boxes;
+  for (int z{}; z < 32; z++) {
+    for (int x{}; x < 32; x++) {
+      boxes.push_back(boxAt({3.0f * x - 48.0f, 0.0f, 3.0f * z - 48.0f}, 0.5f));
+    }
+  }
+  cg::Bvh bvh;
+  bvh.build(boxes);
+
+  bench::Checks check;
+
+  // 把网格中间的一个对象移到上方的空处
+  constexpr std::uint32_t moved = 16 * 32 + 16;
+  auto oldCenter = boxes[moved].center();
+  glm::vec3 newCenter{20.0f, 40.0f, -20.0f};
+  boxes[moved] = boxAt(newCenter, 0.5f);
+  bvh.update(moved, boxes[moved]);
+
+  auto projection = glm::perspective(glm::radians(30.0f), 1.0f, 0.1f, 20.0f);
+  auto lookAt = [&](const glm::vec3 &target) {
+    auto eye = target + glm::vec3(0.0f, 0.0f, 5.0f);
+    return cg::Frustum::fromMatrix(
+        projection * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)));
+  };
+  check(contains(collect(bvh, lookAt(newCenter)), moved),
+        "frustum query finds the object at its new position");
+  // 旧位置上方没有其他对象, 视锥只看得到空处
+  auto above = oldCenter + glm::vec3(0.0f, 10.0f, 0.0f);
+  check(!contains(collect(bvh, lookAt(above)), moved) &&
+            !contains(collect(bvh, cg::Sphere{oldCenter, 1.0f}), moved),
+        "queries at the old position no longer return it");
+  check(collect(bvh, cg::Sphere{newCenter, 1.0f}) ==
+            std::vector<std::uint32_t>{moved},
+        "sphere query finds only the object at its new position");
+  cg::Ray down{newCenter + glm::vec3(0.0f, 10.0f, 0.0f), {0.0f, -1.0f, 0.0f}};
+  float distance{};
+  check(bvh.raycast(down, &distance) == moved &&
+            std::abs(distance - 9.5f) < 1e-4f,
+        "ray cast hits the object at its new position");
+
+  // 随机移动一批对象, 与逐个测试的结果比较
+  auto mismatches = 0;
+  for (int round{}; round < 50; round++) {
+    for (int k{}; k < 20; k++) {
+      auto object = static_cast<std::uint32_t>(gen() % boxes.size());
+      boxes[object] = boxAt({position(gen), position(gen), position(gen)},
+                            0.5f);
+      bvh.update(object, boxes[object]);
+    }
+    glm::vec3 target{position(gen), position(gen), position(gen)};
+    auto frustum = lookAt(target);
+    cg::Sphere sphere{target, 8.0f};
+    mismatches += collect(bvh, frustum) != bruteForce(boxes, frustum);
+    mismatches += collect(bvh, sphere) != bruteForce(boxes, sphere);
+
+    cg::Ray ray{target, glm::normalize(glm::vec3(position(gen), position(gen),
+                                                 position(gen)))};
+    auto nearest = cg::Bvh::invalid;
+    auto nearestDistance = ray.maxDistance;
+    for (std::uint32_t i{}; i < boxes.size(); i++) {
+      float t{};
+      if (cg::intersects(ray, boxes[i], &t) && t < nearestDistance) {
+        nearest = i;
+        nearestDistance = t;
+      }
+    }
+    // 距离相同的对象可能不止一个, 比较命中距离
+    float hitDistance{};
+    auto hit = bvh.raycast(ray, &hitDistance);
+    mismatches += (hit == cg::Bvh::invalid) != (nearest == cg::Bvh::invalid) ||
+                  (hit != cg::Bvh::invalid && hitDistance != nearestDistance);
+  }
+  check(mismatches == 0, "queries after random moves match brute force");
+
+  // 计时: 构建, refit 与查询, 查询与逐个测试包围盒对比
+  std::cout << std::fixed << std::setprecision(2);
+  for (std::size_t count : {1'000, 10'000, 100'000, 1'000'000}) {
+    // 对象数增加时场景等比例扩大, 查询命中的对象数大致不变
+    auto extent = 50.0f * std::cbrt(count / 1000.0f);
+    std::uniform_real_distribution<float> spread(-extent, extent);
+    auto randomBox = [&] {
+      return boxAt({spread(gen), spread(gen), spread(gen)}, 0.5f);
+    };
+    std::vector<cg::Aabb> scene(count);
+    std::ranges::generate(scene, randomBox);
+    cg::Bvh index;
+    auto build = bench::microseconds(3, [&] { index.build(scene); });
+    glm::vec3 target{spread(gen), spread(gen), spread(gen)};
+    auto frustum = lookAt(target);
+    cg::Sphere sphere{target, 8.0f};
+    cg::Ray ray{target, glm::normalize(glm::vec3(1.0f, 0.3f, -0.5f))};
+    std::size_t hits{};
+    auto countHits = [&](std::uint32_t) { hits++; };
+    auto bvhQueries = bench::microseconds(20, [&] {
+      index.query(frustum, countHits);
+      index.query(sphere, countHits);
+      index.raycast(ray);
+    });
+    auto bruteForceQueries = bench::microseconds(5, [&] {
+      for (std::uint32_t i{}; i < count; i++) {
+        hits += cg::intersects(frustum, scene[i]);
+        hits += cg::intersects(sphere, scene[i]);
+        hits += cg::intersects(ray, scene[i]);
+      }
+    });
+    // 查询在新建的树上计时; refit 随机移动对象, 之后树的质量会下降
+    constexpr int moves = 1000;
+    auto refit = bench::microseconds(5, [&] {
+      for (int k{}; k < moves; k++) {
+        auto object = static_cast<std::uint32_t>(gen() % count);
+        scene[object] = randomBox();
+        index.update(object, scene[object]);
+      }
+    });
+
+    std::cout << count << " boxes (depth " << index.depth()
+              << "): build " << build / 1000.0 << " ms, refit "
+              << refit / moves << " us per move, frustum + sphere + ray "
+              << bvhQueries << " us vs brute force " << bruteForceQueries
+              << " us (" << bruteForceQueries / bvhQueries << "x)"
+              << std::endl;
+  }
+  return check.exitCode();
+}
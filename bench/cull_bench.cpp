@@ -0,0 +1,101 @@
+#include "bench.hpp"
+#include <culling.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/**
+ * @brief 视锥剔除基准: 先检查 SIMD 的批量剔除与逐个对象的标量测试
+ * 结果一致 (不一致时返回 1), 再对随机分布的包围盒输出剔除数量和
+ * 每万个对象的耗时
+ */
+int main() {
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+  std::uniform_real_distribution<float> size(0.1f, 2.0f);
+  auto projection =
+      glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+  auto view = glm::lookAt(glm::vec3(.0f, .0f, 3.0f), glm::vec3(.0f),
+                          glm::vec3(.0f, 1.0f, .0f));
+  auto frustum = cg::Frustum::fromMatrix(projection * view);
+
+  /**
+   * 与标量测试比较: 随机包围盒, 中心在某个平面上 (跨过平面) 的包围盒,
+   * 以及刚好在平面外侧的包围盒. 一半对象使用比半对角线小的包围球,
+   * 与模型网格相同. 数量不是 8 的倍数, AVX2, SSE 和标量尾部都会用到
+   */
+  {
+    std::uniform_int_distribution<int> pickPlane(0, 5);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    cg::BoundsSoA bounds;
+    std::vector<cg::Aabb> boxes;
+    std::vector<float> radii;
+    for (int i{}; i < 10'007; i++) {
+      glm::vec3 center{position(gen), position(gen), position(gen)};
+      glm::vec3 half{size(gen), size(gen), size(gen)};
+      const auto &plane = frustum.planes[pickPlane(gen)];
+      glm::vec3 normal(plane);
+      auto projected = glm::dot(glm::abs(normal), half);
+      auto distance = glm::dot(normal, center) + plane.w;
+      if (i % 3 == 1) {
+        // 中心移到平面上
+        center -= distance * normal;
+      } else if (i % 3 == 2) {
+        // 移到平面外侧, 与平面相距 1% 的投影半径
+        center -= (distance + projected * 1.01f) * normal;
+      }
+      boxes.push_back({center - half, center + half});
+      radii.push_back(i % 2 ? glm::length(half) * (0.5f + 0.5f * unit(gen))
+                            : -1.0f);
+      bounds.push(boxes.back(), radii.back());
+    }
+    std::vector<std::uint8_t> visible;
+    cg::cullBounds(frustum, bounds, visible);
+    std::size_t mismatches{}, culled{};
+    for (std::size_t i{}; i < boxes.size(); i++) {
+      auto sphere = cg::Sphere{boxes[i].center(),
+                               radii[i] < 0.0f
+                                   ? glm::length(boxes[i].extents())
+                                   : radii[i]};
+      bool expected =
+          frustum.intersects(boxes[i]) && frustum.intersects(sphere);
+      mismatches += (visible[i] != 0) != expected;
+      culled += !expected;
+    }
+    bench::Checks check;
+    check(mismatches == 0 && culled > 0 && culled < boxes.size(),
+          "SIMD culling matches the scalar frustum test");
+    if (check.failures() > 0) {
+      std::cout << mismatches << " of " << boxes.size()
+                << " objects differ" << std::endl;
+      return check.exitCode();
+    }
+  }
+
+  for (std::size_t count : {10'000, 100'000, 1'000'000}) {
+    cg::BoundsSoA bounds;
+    for (std::size_t i{}; i < count; i++) {
+      glm::vec3 center{position(gen), position(gen), position(gen)};
+      glm::vec3 half{size(gen), size(gen), size(gen)};
+      bounds.push({center - half, center + half});
+    }
+    std::vector<std::uint8_t> visible;
+    cg::cullBounds(frustum, bounds, visible); // 预热
+    constexpr int runs = 20;
+    cg::CullStats total{};
+    for (int run{}; run < runs; run++) {
+      auto stats = cg::cullBounds(frustum, bounds, visible);
+      total.tested += stats.tested;
+      total.culled = stats.culled;
+      total.microseconds += stats.microseconds;
+    }
+    std::cout << count << " objects: culled " << total.culled << " ("
+              << 100.0 * total.culled / count << "%), "
+              << total.perTenThousand() << " us per 10k objects" << std::endl;
+  }
+}
@@ -0,0 +1,413 @@
+#include "bench.hpp"
+#include <batch_math.hpp>
+#include <bloom.hpp>
+#include <clustered.hpp>
+#include <command_list.hpp>
+#include <culling.hpp>
+#include <ecs.hpp>
+#include <frame_arena.hpp>
+#include <glad/glad.h>
+#include <instancing.hpp>
+#include <jobs.hpp>
+#include <post_process.hpp>
+#include <render_graph.hpp>
+#include <render_targets.hpp>
+#include <shader.hpp>
+#include <shadows.hpp>
+#include <transparency.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <format>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <vector>
+
+namespace {
+struct Orbit {
+  float radius, speed, phase;
+};
+struct Position {
+  glm::vec3 value;
+};
+
+// 没有 GL 上下文: 把用到的入口换成空函数, 只运行 CPU 一侧的路径
+template <typename R, typename... Args> R APIENTRY noop(Args...) {
+  return R{};
+}
+template <typename R, typename... Args>
+void install(R(APIENTRYP &entry)(Args...)) {
+  entry = noop<R, Args...>;
+}
+// 对象名从 1 开始依次分配, 与驱动一样不会返回 0
+void APIENTRY generateNames(GLsizei count, GLuint *names) {
+  static GLuint next{1};
+  for (GLsizei i{}; i < count; i++) {
+    names[i] = next++;
+  }
+}
+void installHeadlessGL() {
+  install(glad_glCreateShader);
+  install(glad_glShaderSource);
+  install(glad_glCompileShader);
+  install(glad_glGetShaderInfoLog);
+  install(glad_glCreateProgram);
+  install(glad_glAttachShader);
+  install(glad_glLinkProgram);
+  install(glad_glGetProgramInfoLog);
+  install(glad_glDeleteShader);
+  // 编译和链接总是成功
+  glad_glGetShaderiv = [](GLuint, GLenum, GLint *params) { *params = 1; };
+  glad_glGetProgramiv = [](GLuint, GLenum, GLint *params) { *params = 1; };
+  install(glad_glUseProgram);
+  install(glad_glGetUniformLocation);
+  install(glad_glUniform1i);
+  install(glad_glUniform1f);
+  install(glad_glUniform1fv);
+  install(glad_glUniform2f);
+  install(glad_glUniform3f);
+  install(glad_glUniform3fv);
+  install(glad_glUniform4fv);
+  install(glad_glUniformMatrix3fv);
+  install(glad_glUniformMatrix4fv);
+  glad_glGenBuffers = generateNames;
+  install(glad_glDeleteBuffers);
+  install(glad_glBindBuffer);
+  install(glad_glBindBufferRange);
+  install(glad_glBufferData);
+  install(glad_glBufferSubData);
+  install(glad_glBindVertexArray);
+  install(glad_glEnableVertexAttribArray);
+  install(glad_glVertexAttribPointer);
+  install(glad_glVertexAttribDivisor);
+  glad_glGenTextures = generateNames;
+  install(glad_glDeleteTextures);
+  install(glad_glActiveTexture);
+  install(glad_glBindTexture);
+  install(glad_glTexBuffer);
+  install(glad_glTexImage2D);
+  install(glad_glTexImage2DMultisample);
+  install(glad_glTexImage3D);
+  install(glad_glTexParameteri);
+  glad_glGenFramebuffers = generateNames;
+  install(glad_glDeleteFramebuffers);
+  install(glad_glBindFramebuffer);
+  install(glad_glFramebufferTexture);
+  install(glad_glFramebufferTexture2D);
+  install(glad_glFramebufferTextureLayer);
+  glad_glCheckFramebufferStatus = [](GLenum) -> GLenum {
+    return GL_FRAMEBUFFER_COMPLETE;
+  };
+  install(glad_glDrawBuffer);
+  install(glad_glDrawBuffers);
+  install(glad_glReadBuffer);
+  glad_glGetIntegerv = [](GLenum name, GLint *params) {
+    std::fill_n(params, name == GL_VIEWPORT ? 4 : 1, 0);
+  };
+  install(glad_glViewport);
+  install(glad_glEnable);
+  install(glad_glDisable);
+  install(glad_glPolygonOffset);
+  install(glad_glClear);
+  install(glad_glDrawArrays);
+  install(glad_glDrawElements);
+  install(glad_glDrawArraysInstanced);
+  install(glad_glDrawElementsInstanced);
+}
+} // namespace
+
+/**
+ * @brief 稳定帧的堆分配检查: 按渲染循环的方式每帧运行剔除, ECS 查询,
+ * 作业系统 (块数超过栈上的作业数), uniform 设置, 透明物体排序和实例合批,
+ * 再执行与 main.cpp 结构相同的渲染图: 级联与局部阴影, 分簇光源, 按
+ * Model::Draw 的方式并行录制的命令列表, 泛光和后处理. 预热之后统计
+ * operator new 次数, 不为零时返回 1
+ */
+int main() {
+  installHeadlessGL();
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  constexpr GLsizei width = 800, height = 600;
+  constexpr float aspect = static_cast<float>(width) / height;
+  auto projection =
+      glm::perspective(glm::radians(45.0f), aspect, 0.1f, 100.0f);
+
+  cg::World world;
+  cg::BoundsSoA bounds;
+  for (int i{}; i < 20'000; i++) {
+    glm::vec3 center{200.0f * unit(gen) - 100.0f, 0.0f,
+                     200.0f * unit(gen) - 100.0f};
+    bounds.push({center - glm::vec3(0.5f), center + glm::vec3(0.5f)});
+    world.create(Orbit{10.0f * unit(gen), unit(gen), 6.28f * unit(gen)},
+                 Position{center});
+  }
+  std::vector<std::uint8_t> visible;
+  std::vector<glm::vec3> positions;
+  std::vector<float> viewDepth;
+  std::vector<std::uint32_t> order;
+
+  cg::Shader shader{LEARN_GL_SHADER_DIR "/instanced.vert",
+                    LEARN_GL_SHADER_DIR "/multi_lights.frag"};
+  cg::InstanceBatcher batcher;
+  std::uint32_t meshes[]{batcher.addMesh({0, 0, 36}),
+                         batcher.addMesh({0, 0, 6})};
+  std::uint32_t materials[]{batcher.addMaterial({&shader}),
+                            batcher.addMaterial({&shader})};
+  // 栈上放得下 32 个作业, 这里每帧约 78 块, 多出的放在帧内存中;
+  // 固定两个工作线程, 单核机器上也会走到切块的路径
+  cg::JobSystem jobs{2};
+  constexpr std::size_t depthGrain = 256;
+
+  // 模型: 与 Model::Draw 相同, 各块并行录制到自己的命令列表再按顺序回放
+  constexpr std::size_t modelMeshes = 96, recordGrain = 16;
+  std::vector<glm::mat4> meshWorlds;
+  for (std::size_t i{}; i < modelMeshes; i++) {
+    meshWorlds.push_back(glm::translate(
+        glm::mat4(1.0f), glm::vec3(i % 8 * 2.0f, 0.0f, i / 8 * 2.0f)));
+  }
+  std::vector<cg::CommandList> commandLists(modelMeshes / recordGrain);
+  auto drawModel = [&](const cg::Shader &program) {
+    auto model = glGetUniformLocation(program.ID, "model");
+    auto normalMatrix = glGetUniformLocation(program.ID, "normalMatrix");
+    jobs.parallelFor(0, modelMeshes, recordGrain,
+                     [&](std::size_t begin, std::size_t end) {
+                       auto &list = commandLists[begin / recordGrain];
+                       list.clear();
+                       list.useProgram(program.ID);
+                       for (auto i = begin; i < end; i++) {
+                         list.setMat4(model, meshWorlds[i]);
+                         list.setMat3(normalMatrix,
+                                      cg::normalMatrix(meshWorlds[i]));
+                         list.bindVertexArray(1);
+                         list.bindTexture(GL_TEXTURE_2D, 0, 1);
+                         list.drawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT);
+                       }
+                     });
+    cg::CommandList::execute(commandLists);
+  };
+
+  // 阴影: 相机和光源每帧移动, 近处级联与点光源阴影每帧重绘
+  cg::Shader depthProgram{LEARN_GL_SHADER_DIR "/depth_only.vert",
+                          LEARN_GL_SHADER_DIR "/depth_only.frag"};
+  cg::Shader pointShadowProgram{LEARN_GL_SHADER_DIR "/depth_only.vert",
+                                LEARN_GL_SHADER_DIR "/point_shadow.frag",
+                                LEARN_GL_SHADER_DIR "/point_shadow.gs"};
+  cg::CascadedShadowMap cascades;
+  cg::LocalShadowMaps localShadows;
+  const cg::CascadedShadowMap::DrawCasters drawCasters =
+      [&](const glm::mat4 &lightViewProjection, bool) {
+        depthProgram.use();
+        depthProgram.setMat4("view", glm::mat4(1.0f));
+        depthProgram.setMat4("projection", lightViewProjection);
+        drawModel(depthProgram);
+      };
+  // 与局部阴影相同的格式化下标名
+  const cg::LocalShadowMaps::DrawCasters drawLocalCasters =
+      [&](const cg::LocalShadowMaps::Pass &pass) {
+        auto &program = pass.cube ? pointShadowProgram : depthProgram;
+        program.use();
+        program.setMat4("view", glm::mat4(1.0f));
+        if (pass.cube) {
+          program.setMat4("projection", glm::mat4(1.0f));
+          for (int face{}; face < 6; face++) {
+            cg::FrameString name;
+            std::format_to(std::back_inserter(name), "faceMatrices[{}]",
+                           face);
+            program.setMat4(name.c_str(), pass.matrices[face]);
+          }
+          program.setInt("layerBase", pass.layer);
+        } else {
+          program.setMat4("projection", pass.matrices[0]);
+        }
+        drawModel(program);
+      };
+
+  // 分簇光源, 前 maxPointLights 个带阴影
+  cg::LightClusters clusters;
+  std::vector<cg::ClusterLight> lights(256);
+  for (int i{}; i < static_cast<int>(lights.size()); i++) {
+    lights[i].diffuse = glm::vec3(unit(gen), unit(gen), unit(gen));
+    lights[i].linear = 0.7f;
+    lights[i].quadratic = 1.8f;
+    lights[i].radius = cg::lightRange(lights[i]);
+    if (i < cg::LocalShadowMaps::maxPointLights) {
+      lights[i].shadowSlot = i;
+    }
+  }
+
+  // 渲染图: 阴影, 场景, 泛光, 后处理和 present, 场景按动态分辨率渲染
+  auto quadVertexShaderFile = LEARN_GL_SHADER_DIR "/quad.vs";
+  cg::Shader quadShader{quadVertexShaderFile, LEARN_GL_SHADER_DIR "/quad.fs"};
+  cg::Shader presentShader{quadVertexShaderFile,
+                           LEARN_GL_SHADER_DIR "/quad.fs"};
+  cg::Shader postBlurShader{quadVertexShaderFile,
+                            LEARN_GL_SHADER_DIR "/post_blur.fs"};
+  cg::Shader postKernelShader{quadVertexShaderFile,
+                              LEARN_GL_SHADER_DIR "/post_kernel.fs"};
+  cg::Shader bloomDownsampleShader{quadVertexShaderFile,
+                                   LEARN_GL_SHADER_DIR "/bloom_downsample.fs"};
+  cg::Shader bloomUpsampleShader{quadVertexShaderFile,
+                                 LEARN_GL_SHADER_DIR "/bloom_upsample.fs"};
+  constexpr GLuint quadVAO = 1;
+  cg::PostStack post{quadShader, postBlurShader, postKernelShader, quadVAO};
+  post.setEffects({cg::PostEffect::blur(1.5f, 4, 2),
+                   cg::PostEffect::edgeDetect(), cg::PostEffect::invert(),
+                   cg::PostEffect::grayscale()});
+  cg::Bloom bloom{bloomDownsampleShader, bloomUpsampleShader, quadVAO};
+
+  glm::mat4 view{1.0f};
+  glm::vec3 cameraPos{}, cameraFront{0.0f, 0.0f, -1.0f};
+  const glm::vec3 lightDirection{-0.2f, -1.0f, -0.3f};
+  cg::RenderTargetPool renderTargets;
+  cg::RenderGraph graph{renderTargets};
+  const auto sceneColor = graph.createTexture(
+      "scene color", {width, height, GL_R11F_G11F_B10F}, true);
+  const auto sceneDepth = graph.createTexture(
+      "scene depth", {width, height, GL_DEPTH24_STENCIL8}, true);
+  const auto backbuffer = graph.backbuffer(width, height);
+  graph
+      .addPass("shadows",
+               [&](const cg::RenderGraph &) {
+                 cascades.update(view, glm::radians(45.0f), aspect, 0.1f,
+                                 lightDirection, 1, drawCasters);
+                 for (const auto &light : lights) {
+                   if (light.shadowSlot >= 0) {
+                     localShadows.setPointLight(
+                         light.shadowSlot, light.position, light.radius);
+                   }
+                 }
+                 localShadows.setSpotLight(cameraPos, cameraFront,
+                                           glm::radians(15.5f), 50.0f);
+                 localShadows.update(drawLocalCasters);
+               })
+      .sideEffect();
+  graph
+      .addPass("scene",
+               [&](const cg::RenderGraph &) {
+                 glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                 shader.use();
+                 clusters.bind(shader, 8);
+                 cascades.bind(shader, 11);
+                 localShadows.bind(shader, 12);
+                 drawModel(shader);
+                 batcher.draw();
+               })
+      .write(sceneColor)
+      .write(sceneDepth);
+  const auto bloomOutput = bloom.addPasses(graph, sceneColor);
+  const auto postOutput = post.addPasses(graph, sceneColor);
+  graph
+      .addPass("present",
+               [&](const cg::RenderGraph &g) {
+                 presentShader.use();
+                 post.setPresentOps(presentShader);
+                 bloom.bind(g, bloomOutput, presentShader, 1);
+                 glBindVertexArray(quadVAO);
+                 glActiveTexture(GL_TEXTURE0);
+                 glBindTexture(GL_TEXTURE_2D, g.texture(postOutput));
+                 glDrawArrays(GL_TRIANGLES, 0, 6);
+               })
+      .read(postOutput)
+      .read(bloomOutput)
+      .write(backbuffer);
+  graph.compile();
+
+  cg::FrameArena arena;
+  cg::FrameArena::Scope scope{arena};
+  auto orderErrors = 0, drawErrors = 0, shadowErrors = 0;
+  auto frame = [&](int index) {
+    auto time = index / 60.0f;
+    world.parallelEach<Position, Orbit>(
+        [&](Position &position, const Orbit &orbit) {
+          auto theta = orbit.phase + orbit.speed * time;
+          position.value = glm::vec3(orbit.radius * std::cos(theta), 0.0f,
+                                     orbit.radius * std::sin(theta));
+        });
+    positions.clear();
+    world.each<Position>(
+        [&](const Position &position) { positions.push_back(position.value); });
+    cameraPos = glm::vec3(std::sin(time), 1.0f, 3.0f);
+    cameraFront = glm::normalize(-cameraPos);
+    view = glm::lookAt(cameraPos, glm::vec3(0.0f),
+                       glm::vec3(0.0f, 1.0f, 0.0f));
+    cg::cullBounds(cg::Frustum::fromMatrix(projection * view), bounds,
+                   visible);
+    // 帧内的临时数组来自帧内存, 不产生堆分配
+    cg::FrameVector<std::uint32_t> scratch(positions.size());
+
+    // uniform 设置: 字符串字面量
+    shader.use();
+    shader.setMat4("view", view);
+    shader.setMat4("projection", projection);
+    shader.setVec3("viewPos", cameraPos);
+    shader.setInt("material.diffuse", 0);
+    shader.setFloat("material.shininess", 64.0f);
+
+    // 透明物体: 并行计算视深, 再按基数排序从远到近
+    viewDepth.resize(positions.size());
+    jobs.parallelFor(0, positions.size(), depthGrain,
+                     [&](std::size_t begin, std::size_t end) {
+                       for (auto i = begin; i < end; i++) {
+                         viewDepth[i] = glm::length(positions[i] - cameraPos);
+                       }
+                     });
+    cg::sortBackToFront(viewDepth, order);
+    for (std::size_t i = 1; i < order.size(); i++) {
+      orderErrors += viewDepth[order[i - 1]] < viewDepth[order[i]];
+    }
+
+    // 按排序后的顺序追加, 合批后同一批次内保持这个顺序
+    batcher.clear();
+    for (auto i : order) {
+      batcher.append(meshes[i % 2], materials[(i / 2) % 2],
+                     glm::translate(glm::mat4(1.0f), positions[i]));
+    }
+    batcher.upload();
+
+    // 光源绕原点移动, 带阴影的点光源每帧都要重绘
+    for (std::size_t i{}; i < lights.size(); i++) {
+      auto theta = time + 0.1f * i;
+      lights[i].position =
+          glm::vec3(20.0f * std::cos(theta), 1.0f + i % 4,
+                    20.0f * std::sin(theta) - 0.1f * i);
+    }
+    clusters.setProjection(projection, 0.1f, 100.0f);
+    clusters.build(lights, view);
+    graph.setRenderScale(0.75f + 0.25f * std::sin(time));
+    graph.execute();
+    renderTargets.endFrame();
+    drawErrors += batcher.drawCount() != 4;
+    shadowErrors += cascades.renderedCascades() == 0 ||
+                    localShadows.renderedMaps() == 0;
+  };
+
+  // 光源和相机的运动以 2pi 秒为周期 (约 377 帧), 预热覆盖一整个周期,
+  // 各数组的容量达到最大值之后才开始统计
+  constexpr int warmup = 400, frames = 600;
+  for (int i{}; i < warmup; i++) {
+    frame(i);
+    arena.reset();
+  }
+  auto before = cg::allocationCount();
+  for (int i{}; i < frames; i++) {
+    frame(warmup + i);
+    arena.reset();
+  }
+  auto allocations = cg::allocationCount() - before;
+  std::cout << frames << " steady-state frames with " << jobs.workerCount()
+            << " workers, " << graph.executedPassCount()
+            << " render graph passes, " << clusters.lightCount()
+            << " clustered lights: " << allocations << " heap allocations"
+            << std::endl;
+
+  bench::Checks check;
+  check(allocations == 0, "no heap allocations after warm-up");
+  check(orderErrors == 0, "transparent objects sorted back to front");
+  check(drawErrors == 0, "instances merged into four batches");
+  check(shadowErrors == 0, "moving camera and lights redraw shadows");
+  return check.exitCode();
+}
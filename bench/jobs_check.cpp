@@ -0,0 +1,116 @@
+#include "bench.hpp"
+#include <ecs.hpp>
+#include <frame_arena.hpp>
+#include <jobs.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+namespace {
+struct Counter {
+  std::uint32_t value;
+};
+
+// [0, count) 的和, 用于核对并行求和的结果
+std::uint64_t sumTo(std::uint64_t count) { return count * (count - 1) / 2; }
+} // namespace
+
+/**
+ * @brief 作业系统的压力检查, 配合 LEARN_GL_SANITIZE=thread 或 address
+ * 运行: 依赖关系, 嵌套的 parallelFor, 多个外部线程同时提交, 以及 ECS
+ * 的 parallelEach. 结果不符时返回 1
+ */
+int main() {
+  // 固定四个工作线程, 与机器的核心数无关
+  cg::JobSystem jobs{4};
+  bench::Checks check;
+  constexpr int rounds = 200;
+
+  // 依赖: after 归零之前, 依赖它的作业不能开始
+  auto orderErrors = 0;
+  for (int round{}; round < rounds; round++) {
+    cg::JobCounter first, second;
+    std::atomic<int> firstDone{}, ordered{};
+    for (int i{}; i < 64; i++) {
+      jobs.run([&] { firstDone.fetch_add(1); }, &first);
+    }
+    for (int i{}; i < 64; i++) {
+      jobs.run([&] { ordered.fetch_add(firstDone.load() == 64); }, &second,
+               &first);
+    }
+    jobs.wait(second);
+    orderErrors += ordered.load() != 64;
+  }
+  check(orderErrors == 0, "dependent jobs start after their prerequisites");
+
+  // 嵌套: 每块内部再切块, 作业中等待子作业不会死锁
+  auto nestedErrors = 0;
+  for (int round{}; round < rounds; round++) {
+    cg::FrameArena arena;
+    cg::FrameArena::Scope scope{arena};
+    std::atomic<std::uint64_t> sum{};
+    jobs.parallelFor(0, 64, 1, [&](std::size_t begin, std::size_t end) {
+      for (auto outer = begin; outer < end; outer++) {
+        jobs.parallelFor(0, 1024, 16, [&](std::size_t b, std::size_t e) {
+          std::uint64_t local{};
+          for (auto i = b; i < e; i++) {
+            local += outer * 1024 + i;
+          }
+          sum.fetch_add(local);
+        });
+      }
+    });
+    nestedErrors += sum.load() != sumTo(64 * 1024);
+  }
+  check(nestedErrors == 0, "nested parallelFor covers every index once");
+
+  // 外部线程: 不是工作线程的提交都经过注入队列
+  std::atomic<int> externalErrors{};
+  {
+    std::vector<std::jthread> threads;
+    for (int t{}; t < 4; t++) {
+      threads.emplace_back([&] {
+        cg::FrameArena arena;
+        cg::FrameArena::Scope scope{arena};
+        for (int round{}; round < rounds; round++) {
+          std::atomic<std::uint64_t> sum{};
+          // 块数超过栈上的作业数, 多出的放在帧内存中
+          jobs.parallelFor(0, 10'000, 64, [&](std::size_t b, std::size_t e) {
+            std::uint64_t local{};
+            for (auto i = b; i < e; i++) {
+              local += i;
+            }
+            sum.fetch_add(local);
+          });
+          externalErrors += sum.load() != sumTo(10'000);
+          arena.reset();
+        }
+      });
+    }
+  }
+  check(externalErrors.load() == 0,
+        "concurrent parallelFor from outside threads");
+
+  // ECS: 实体数超过阈值时按 chunk 并行
+  cg::World world;
+  for (std::uint32_t i{}; i < 20'000; i++) {
+    world.create(Counter{i});
+  }
+  {
+    cg::FrameArena arena;
+    cg::FrameArena::Scope scope{arena};
+    for (int round{}; round < 20; round++) {
+      world.parallelEach<Counter>([](Counter &counter) { counter.value++; });
+      arena.reset();
+    }
+  }
+  std::uint64_t total{};
+  world.each<Counter>([&](const Counter &counter) { total += counter.value; });
+  check(total == sumTo(20'000) + 20ull * 20'000,
+        "parallelEach updates every entity each round");
+
+  return check.exitCode();
+}
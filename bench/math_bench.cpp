@@ -0,0 +1,187 @@
+#include <batch_math.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+/**
+ * @brief 批量数学基准: 每个内核与逐个调用 glm 的写法对比,
+ * 输出每个元素的耗时, 加速比以及两者结果的最大差值
+ */
+namespace {
+constexpr int runs = 20;
+
+template <typename Fn> double nanosecondsPerItem(std::size_t count, Fn &&fn) {
+  fn(); // 预热
+  auto start = std::chrono::steady_clock::now();
+  for (int run{}; run < runs; run++) {
+    fn();
+  }
+  auto elapsed = std::chrono::duration<double, std::nano>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  return elapsed / runs / static_cast<double>(count);
+}
+
+float maxDifference(const float *a, const float *b, std::size_t floats) {
+  float difference{};
+  for (std::size_t i{}; i < floats; i++) {
+    difference = std::max(difference, std::abs(a[i] - b[i]));
+  }
+  return difference;
+}
+
+template <typename T>
+float maxDifference(const std::vector<T> &a, const std::vector<T> &b) {
+  return maxDifference(reinterpret_cast<const float *>(a.data()),
+                       reinterpret_cast<const float *>(b.data()),
+                       a.size() * sizeof(T) / sizeof(float));
+}
+
+void report(const char *name, double reference, double batch,
+            float difference) {
+  std::cout << std::left << std::setw(22) << name << std::right << std::fixed
+            << std::setprecision(2) << std::setw(8) << reference
+            << " ns (glm) " << std::setw(8) << batch << " ns (batch) "
+            << std::setw(6) << reference / batch << "x  max diff "
+            << std::scientific << std::setprecision(1) << difference
+            << std::endl;
+}
+} // namespace
+
+int main() {
+  constexpr std::size_t count = 100'000;
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+
+  std::vector<glm::vec3> translations(count), scales(count);
+  std::vector<glm::quat> rotations(count);
+  for (std::size_t i{}; i < count; i++) {
+    translations[i] = {position(gen), position(gen), position(gen)};
+    scales[i] = glm::vec3(0.5f) + 0.4f * glm::vec3(unit(gen), unit(gen),
+                                                   unit(gen));
+    rotations[i] = glm::normalize(
+        glm::quat(unit(gen), unit(gen), unit(gen), unit(gen)));
+  }
+  auto projection =
+      glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 100.0f);
+  auto view = glm::lookAt(glm::vec3(.0f, .0f, 3.0f), glm::vec3(.0f),
+                          glm::vec3(.0f, 1.0f, .0f));
+  auto viewProjection = projection * view;
+
+  // 平移 * 旋转 * 缩放
+  std::vector<glm::mat4> models(count), reference(count);
+  auto glmCompose = nanosecondsPerItem(count, [&] {
+    for (std::size_t i{}; i < count; i++) {
+      reference[i] = glm::scale(glm::translate(glm::mat4(1.0f),
+                                               translations[i]) *
+                                    glm::mat4_cast(rotations[i]),
+                                scales[i]);
+    }
+  });
+  auto batchCompose = nanosecondsPerItem(count, [&] {
+    cg::composeTransforms(translations, rotations, scales, models);
+  });
+  report("compose (quat)", glmCompose, batchCompose,
+         maxDifference(reference, models));
+
+  // viewProjection * model
+  std::vector<glm::mat4> products(count);
+  auto glmMultiply = nanosecondsPerItem(count, [&] {
+    for (std::size_t i{}; i < count; i++) {
+      reference[i] = viewProjection * models[i];
+    }
+  });
+  auto batchMultiply = nanosecondsPerItem(count, [&] {
+    cg::multiplyMatrices(viewProjection, models, products);
+  });
+  report("mat4 x mat4", glmMultiply, batchMultiply,
+         maxDifference(reference, products));
+
+  // parent * local
+  auto glmPairwise = nanosecondsPerItem(count, [&] {
+    for (std::size_t i{}; i < count; i++) {
+      reference[i] = products[i] * models[i];
+    }
+  });
+  std::vector<glm::mat4> pairwise(count);
+  auto batchPairwise = nanosecondsPerItem(count, [&] {
+    cg::multiplyMatrices(products, models, pairwise);
+  });
+  report("mat4 x mat4 (pairs)", glmPairwise, batchPairwise,
+         maxDifference(reference, pairwise));
+
+  // 顶点变换 (蒙皮的内层循环)
+  std::vector<glm::vec4> points(count), transformed(count),
+      referencePoints(count);
+  for (auto &point : points) {
+    point = {position(gen), position(gen), position(gen), 1.0f};
+  }
+  auto glmVectors = nanosecondsPerItem(count, [&] {
+    for (std::size_t i{}; i < count; i++) {
+      referencePoints[i] = viewProjection * points[i];
+    }
+  });
+  auto batchVectors = nanosecondsPerItem(count, [&] {
+    cg::transformVectors(viewProjection, points, transformed);
+  });
+  report("mat4 x vec4", glmVectors, batchVectors,
+         maxDifference(referencePoints, transformed));
+
+  // 包围盒变换
+  std::vector<cg::Aabb> local(count), boxes(count), referenceBoxes(count);
+  for (auto &box : local) {
+    glm::vec3 half{std::abs(unit(gen)), std::abs(unit(gen)),
+                   std::abs(unit(gen))};
+    box = {-half, half};
+  }
+  auto glmBounds = nanosecondsPerItem(count, [&] {
+    for (std::size_t i{}; i < count; i++) {
+      referenceBoxes[i] = local[i].transformed(models[i]);
+    }
+  });
+  auto batchBounds = nanosecondsPerItem(
+      count, [&] { cg::transformBounds(models, local, boxes); });
+  report("aabb transform", glmBounds, batchBounds,
+         maxDifference(referenceBoxes, boxes));
+
+  // 包围球与平面
+  cg::BoundsSoA bounds;
+  for (const auto &box : boxes) {
+    bounds.push(box);
+  }
+  auto plane = glm::vec4(glm::normalize(glm::vec3(0.3f, 1.0f, -0.2f)), 5.0f);
+  std::vector<std::uint8_t> outside(count), referenceOutside(count);
+  auto glmSpheres = nanosecondsPerItem(count, [&] {
+    for (std::size_t i{}; i < count; i++) {
+      glm::vec3 center{bounds.centerX[i], bounds.centerY[i],
+                       bounds.centerZ[i]};
+      referenceOutside[i] =
+          glm::dot(glm::vec3(plane), center) + plane.w < -bounds.radius[i];
+    }
+  });
+  auto batchSpheres = nanosecondsPerItem(
+      count, [&] { cg::spheresOutsidePlane(plane, bounds, outside); });
+  report("sphere vs plane", glmSpheres, batchSpheres,
+         std::ranges::equal(outside, referenceOutside) ? 0.0f : 1.0f);
+
+  // 法线矩阵
+  std::vector<glm::mat3> normals(count), referenceNormals(count);
+  auto glmNormals = nanosecondsPerItem(count, [&] {
+    for (std::size_t i{}; i < count; i++) {
+      referenceNormals[i] = glm::transpose(glm::inverse(glm::mat3(models[i])));
+    }
+  });
+  auto batchNormals = nanosecondsPerItem(
+      count, [&] { cg::normalMatrices(models, normals); });
+  report("normal matrix", glmNormals, batchNormals,
+         maxDifference(referenceNormals, normals));
+}
@@ -0,0 +1,88 @@
+#include "bench.hpp"
+#include <culling.hpp>
+#include <occlusion.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/**
+ * @brief 遮挡剔除检查: 把一面已知的墙光栅化到 CPU 深度缓冲, 检查墙后
+ * 被完全挡住的包围盒被剔除, 墙前, 部分露出以及穿过近平面的包围盒保留,
+ * 结果不符时返回 1. 之后输出 Hi-Z 构建和逐个包围盒测试的耗时
+ */
+int main() {
+  cg::OcclusionCuller occlusion;
+  auto projection = glm::perspective(
+      glm::radians(45.0f),
+      static_cast<float>(occlusion.width()) / occlusion.height(), 0.1f,
+      100.0f);
+  auto view = glm::lookAt(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f),
+                          glm::vec3(0.0f, 1.0f, 0.0f));
+  auto viewProjection = projection * view;
+
+  // 与 main.cpp 相同的单位立方体遮挡体, 压扁成 x, y 在 [-2, 2] 的墙
+  std::vector<glm::vec3> vertices;
+  for (int corner{}; corner < 8; corner++) {
+    vertices.push_back({corner & 1 ? .5f : -.5f, corner & 2 ? .5f : -.5f,
+                        corner & 4 ? .5f : -.5f});
+  }
+  const std::vector<std::uint32_t> indices{
+      0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5, 0, 4, 5, 0, 5, 1,
+      2, 3, 7, 2, 7, 6, 0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3};
+  auto wall = glm::scale(glm::mat4(1.0f), glm::vec3(4.0f, 4.0f, 0.2f));
+  auto buildHiZ = [&] {
+    occlusion.clear();
+    occlusion.rasterize(viewProjection * wall, vertices, indices);
+    occlusion.buildHierarchy();
+  };
+  buildHiZ();
+
+  struct Case {
+    const char *name;
+    glm::vec3 center, half;
+    bool visible;
+  };
+  // 距相机 8 时墙覆盖 |x| < 3.2, 第三个包围盒跨过墙的边缘
+  const Case cases[]{
+      {"behind the wall", {0.0f, 0.0f, -3.0f}, glm::vec3(0.5f), false},
+      {"in front of the wall", {0.0f, 0.0f, 2.0f}, glm::vec3(0.5f), true},
+      {"partially covered", {3.2f, 0.0f, -3.0f}, glm::vec3(0.5f), true},
+      {"crossing the near plane", {0.0f, 0.0f, 5.0f}, glm::vec3(1.0f), true},
+  };
+  bench::Checks check;
+  for (const auto &test : cases) {
+    auto visible = occlusion.isVisible(
+        {test.center - test.half, test.center + test.half}, viewProjection);
+    check(visible == test.visible, (std::string(test.name) + ": " +
+                                    (visible ? "visible" : "occluded"))
+                                       .c_str());
+  }
+
+  // 墙前后随机分布的包围盒, 约一半在墙后
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> lateral(-6.0f, 6.0f);
+  std::uniform_real_distribution<float> depth(-20.0f, 4.0f);
+  std::vector<cg::Aabb> boxes;
+  for (int i{}; i < 100'000; i++) {
+    glm::vec3 center{lateral(gen), lateral(gen), depth(gen)};
+    boxes.push_back({center - glm::vec3(0.25f), center + glm::vec3(0.25f)});
+  }
+  auto build = bench::microseconds(100, buildHiZ);
+  std::size_t visibleCount{};
+  auto test = bench::microseconds(20, [&] {
+    visibleCount = 0;
+    for (const auto &box : boxes) {
+      visibleCount += occlusion.isVisible(box, viewProjection);
+    }
+  });
+  std::cout << occlusion.width() << "x" << occlusion.height()
+            << " Hi-Z build: " << build << " us, " << boxes.size()
+            << " box tests: " << test * 1000.0 / boxes.size()
+            << " ns per box (" << visibleCount << " visible)" << std::endl;
+  return check.exitCode();
+}
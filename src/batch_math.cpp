@@ -0,0 +1,453 @@
+#include <batch_math.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace cg {
+namespace {
+const float *data(const glm::mat4 &m) {
+  return reinterpret_cast<const float *>(&m);
+}
+float *data(glm::mat4 &m) { return reinterpret_cast<float *>(&m); }
+
+#if defined(__SSE2__) || defined(_M_X64)
+/**
+ * @brief 4 个矩阵前三列的 SoA 形式: column[c][k] 为第 c 列第 k 个分量
+ */
+struct Columns4 {
+  __m128 column[3][3];
+};
+
+Columns4 loadColumns(const glm::mat4 *models) {
+  Columns4 result;
+  for (int c{}; c < 3; c++) {
+    auto m0 = _mm_loadu_ps(data(models[0]) + 4 * c);
+    auto m1 = _mm_loadu_ps(data(models[1]) + 4 * c);
+    auto m2 = _mm_loadu_ps(data(models[2]) + 4 * c);
+    auto m3 = _mm_loadu_ps(data(models[3]) + 4 * c);
+    // 转置后 m0..m2 依次为 4 个矩阵该列的 x, y, z (m3 为 w, 不用)
+    _MM_TRANSPOSE4_PS(m0, m1, m2, m3);
+    result.column[c][0] = m0;
+    result.column[c][1] = m1;
+    result.column[c][2] = m2;
+  }
+  return result;
+}
+
+// 4 组向量的叉积, 每个分量一个寄存器
+void cross(const __m128 *a, const __m128 *b, __m128 *out) {
+  out[0] = _mm_sub_ps(_mm_mul_ps(a[1], b[2]), _mm_mul_ps(a[2], b[1]));
+  out[1] = _mm_sub_ps(_mm_mul_ps(a[2], b[0]), _mm_mul_ps(a[0], b[2]));
+  out[2] = _mm_sub_ps(_mm_mul_ps(a[0], b[1]), _mm_mul_ps(a[1], b[0]));
+}
+
+// 一个矩阵的 4 列
+struct Matrix128 {
+  __m128 column[4];
+};
+
+Matrix128 loadMatrix(const float *m) {
+  return {{_mm_loadu_ps(m), _mm_loadu_ps(m + 4), _mm_loadu_ps(m + 8),
+           _mm_loadu_ps(m + 12)}};
+}
+
+Matrix128 absolute(const Matrix128 &m) {
+  const auto sign = _mm_set1_ps(-0.0f);
+  return {{_mm_andnot_ps(sign, m.column[0]), _mm_andnot_ps(sign, m.column[1]),
+           _mm_andnot_ps(sign, m.column[2]), _mm_andnot_ps(sign, m.column[3])}};
+}
+
+// m * v
+__m128 transform(const Matrix128 &m, __m128 v) {
+  auto r = _mm_mul_ps(m.column[0], _mm_shuffle_ps(v, v, 0x00));
+  r = _mm_add_ps(r, _mm_mul_ps(m.column[1], _mm_shuffle_ps(v, v, 0x55)));
+  r = _mm_add_ps(r, _mm_mul_ps(m.column[2], _mm_shuffle_ps(v, v, 0xaa)));
+  return _mm_add_ps(r, _mm_mul_ps(m.column[3], _mm_shuffle_ps(v, v, 0xff)));
+}
+
+#if !defined(__AVX2__)
+// out = a * b, 结果的每一列是 a 对 b 的对应列的变换; AVX2 下由 256 位版本代替
+void multiply(const Matrix128 &a, const float *b, float *out) {
+  for (int c{}; c < 4; c++) {
+    _mm_storeu_ps(out + 4 * c, transform(a, _mm_loadu_ps(b + 4 * c)));
+  }
+}
+#endif
+
+// 单位四元数 (x, y, z, w) 转为旋转矩阵, 各列再乘以缩放, 结果按列依次写入
+void rotationScale(__m128 x, __m128 y, __m128 z, __m128 w, __m128 sx,
+                   __m128 sy, __m128 sz, __m128 *out) {
+  auto one = _mm_set1_ps(1.0f);
+  auto x2 = _mm_add_ps(x, x), y2 = _mm_add_ps(y, y), z2 = _mm_add_ps(z, z);
+  auto xx = _mm_mul_ps(x, x2), yy = _mm_mul_ps(y, y2), zz = _mm_mul_ps(z, z2);
+  auto xy = _mm_mul_ps(x, y2), xz = _mm_mul_ps(x, z2), yz = _mm_mul_ps(y, z2);
+  auto wx = _mm_mul_ps(w, x2), wy = _mm_mul_ps(w, y2), wz = _mm_mul_ps(w, z2);
+  out[0] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx);
+  out[1] = _mm_mul_ps(_mm_add_ps(xy, wz), sx);
+  out[2] = _mm_mul_ps(_mm_sub_ps(xz, wy), sx);
+  out[3] = _mm_mul_ps(_mm_sub_ps(xy, wz), sy);
+  out[4] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy);
+  out[5] = _mm_mul_ps(_mm_add_ps(yz, wx), sy);
+  out[6] = _mm_mul_ps(_mm_add_ps(xz, wy), sz);
+  out[7] = _mm_mul_ps(_mm_sub_ps(yz, wx), sz);
+  out[8] = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz);
+}
+#endif
+
+#if defined(__AVX2__)
+// 8 组向量的叉积, 每个分量一个寄存器
+void cross(const __m256 *a, const __m256 *b, __m256 *out) {
+  out[0] = _mm256_fmsub_ps(a[1], b[2], _mm256_mul_ps(a[2], b[1]));
+  out[1] = _mm256_fmsub_ps(a[2], b[0], _mm256_mul_ps(a[0], b[2]));
+  out[2] = _mm256_fmsub_ps(a[0], b[1], _mm256_mul_ps(a[1], b[0]));
+}
+
+// 两个 128 位通道各放一个矩阵 (可以是同一个) 的 4 列
+struct Matrix256 {
+  __m256 column[4];
+};
+
+Matrix256 broadcastMatrix(const float *m) {
+  Matrix256 result;
+  for (int c{}; c < 4; c++) {
+    result.column[c] =
+        _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(m + 4 * c));
+  }
+  return result;
+}
+
+// 每个通道各做一次 m * v
+__m256 transform(const Matrix256 &m, __m256 v) {
+  auto r = _mm256_mul_ps(m.column[0], _mm256_shuffle_ps(v, v, 0x00));
+  r = _mm256_fmadd_ps(m.column[1], _mm256_shuffle_ps(v, v, 0x55), r);
+  r = _mm256_fmadd_ps(m.column[2], _mm256_shuffle_ps(v, v, 0xaa), r);
+  return _mm256_fmadd_ps(m.column[3], _mm256_shuffle_ps(v, v, 0xff), r);
+}
+
+// out = a * b, a 在两个通道中相同, 一次算出结果的两列
+void multiply(const Matrix256 &a, const float *b, float *out) {
+  _mm256_storeu_ps(out, transform(a, _mm256_loadu_ps(b)));
+  _mm256_storeu_ps(out + 8, transform(a, _mm256_loadu_ps(b + 8)));
+}
+
+void rotationScale(__m256 x, __m256 y, __m256 z, __m256 w, __m256 sx,
+                   __m256 sy, __m256 sz, __m256 *out) {
+  auto one = _mm256_set1_ps(1.0f);
+  auto x2 = _mm256_add_ps(x, x), y2 = _mm256_add_ps(y, y),
+       z2 = _mm256_add_ps(z, z);
+  auto xx = _mm256_mul_ps(x, x2), yy = _mm256_mul_ps(y, y2),
+       zz = _mm256_mul_ps(z, z2);
+  auto xy = _mm256_mul_ps(x, y2), xz = _mm256_mul_ps(x, z2),
+       yz = _mm256_mul_ps(y, z2);
+  auto wx = _mm256_mul_ps(w, x2), wy = _mm256_mul_ps(w, y2),
+       wz = _mm256_mul_ps(w, z2);
+  out[0] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(yy, zz)), sx);
+  out[1] = _mm256_mul_ps(_mm256_add_ps(xy, wz), sx);
+  out[2] = _mm256_mul_ps(_mm256_sub_ps(xz, wy), sx);
+  out[3] = _mm256_mul_ps(_mm256_sub_ps(xy, wz), sy);
+  out[4] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, zz)), sy);
+  out[5] = _mm256_mul_ps(_mm256_add_ps(yz, wx), sy);
+  out[6] = _mm256_mul_ps(_mm256_add_ps(xz, wy), sz);
+  out[7] = _mm256_mul_ps(_mm256_sub_ps(yz, wx), sz);
+  out[8] = _mm256_mul_ps(_mm256_sub_ps(one, _mm256_add_ps(xx, yy)), sz);
+}
+#endif
+
+glm::mat4 composeTransform(const glm::vec3 &t, const glm::quat &r,
+                           const glm::vec3 &s) {
+  auto rotation = glm::mat3_cast(r);
+  return {glm::vec4(rotation[0] * s.x, 0.0f),
+          glm::vec4(rotation[1] * s.y, 0.0f),
+          glm::vec4(rotation[2] * s.z, 0.0f), glm::vec4(t, 1.0f)};
+}
+
+// SoA 的结果 (lanes 个元素, 每个元素 9 个分量) 写回按列存放的矩阵
+template <std::size_t lanes>
+void scatterColumns(const float (&soa)[9][lanes], std::size_t first,
+                    std::span<glm::mat3> out) {
+  for (std::size_t lane{}; lane < lanes; lane++) {
+    auto *m = reinterpret_cast<float *>(&out[first + lane]);
+    for (int e{}; e < 9; e++) {
+      m[e] = soa[e][lane];
+    }
+  }
+}
+
+template <std::size_t lanes>
+void scatterTransforms(const float (&soa)[9][lanes],
+                       std::span<const glm::vec3> translations,
+                       std::size_t first, std::span<glm::mat4> out) {
+  for (std::size_t lane{}; lane < lanes; lane++) {
+    auto *m = data(out[first + lane]);
+    const auto &t = translations[first + lane];
+    for (int c{}; c < 3; c++) {
+      m[4 * c] = soa[3 * c][lane];
+      m[4 * c + 1] = soa[3 * c + 1][lane];
+      m[4 * c + 2] = soa[3 * c + 2][lane];
+      m[4 * c + 3] = 0.0f;
+    }
+    m[12] = t.x;
+    m[13] = t.y;
+    m[14] = t.z;
+    m[15] = 1.0f;
+  }
+}
+} // namespace
+
+void normalMatrices(std::span<const glm::mat4> models,
+                    std::span<glm::mat3> normals) {
+  std::size_t i{};
+  auto count = models.size();
+#if defined(__AVX2__)
+  alignas(32) float wide[9][8];
+  for (; i + 8 <= count; i += 8) {
+    auto low = loadColumns(&models[i]), high = loadColumns(&models[i + 4]);
+    __m256 column[3][3];
+    for (int c{}; c < 3; c++) {
+      for (int k{}; k < 3; k++) {
+        column[c][k] = _mm256_insertf128_ps(
+            _mm256_castps128_ps256(low.column[c][k]), high.column[c][k], 1);
+      }
+    }
+    // 结果的三列依次为 b x c, c x a, a x b
+    __m256 result[9];
+    cross(column[1], column[2], result);
+    cross(column[2], column[0], result + 3);
+    cross(column[0], column[1], result + 6);
+    auto det = _mm256_fmadd_ps(
+        column[0][0], result[0],
+        _mm256_fmadd_ps(column[0][1], result[1],
+                        _mm256_mul_ps(column[0][2], result[2])));
+    auto inverseDet = _mm256_div_ps(_mm256_set1_ps(1.0f), det);
+    for (int e{}; e < 9; e++) {
+      _mm256_store_ps(wide[e], _mm256_mul_ps(result[e], inverseDet));
+    }
+    scatterColumns(wide, i, normals);
+  }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+  alignas(16) float narrow[9][4];
+  for (; i + 4 <= count; i += 4) {
+    auto columns = loadColumns(&models[i]);
+    const auto *column = columns.column;
+    __m128 result[9];
+    cross(column[1], column[2], result);
+    cross(column[2], column[0], result + 3);
+    cross(column[0], column[1], result + 6);
+    auto det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(column[0][0], result[0]),
+                                     _mm_mul_ps(column[0][1], result[1])),
+                          _mm_mul_ps(column[0][2], result[2]));
+    auto inverseDet = _mm_div_ps(_mm_set1_ps(1.0f), det);
+    for (int e{}; e < 9; e++) {
+      _mm_store_ps(narrow[e], _mm_mul_ps(result[e], inverseDet));
+    }
+    scatterColumns(narrow, i, normals);
+  }
+#endif
+  for (; i < count; i++) {
+    normals[i] = normalMatrix(models[i]);
+  }
+}
+
+void multiplyMatrices(const glm::mat4 &lhs, std::span<const glm::mat4> rhs,
+                      std::span<glm::mat4> out) {
+  std::size_t i{};
+  auto count = rhs.size();
+#if defined(__AVX2__)
+  auto a = broadcastMatrix(data(lhs));
+  for (; i < count; i++) {
+    multiply(a, data(rhs[i]), data(out[i]));
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  auto a = loadMatrix(data(lhs));
+  for (; i < count; i++) {
+    multiply(a, data(rhs[i]), data(out[i]));
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = lhs * rhs[i];
+  }
+}
+
+void multiplyMatrices(std::span<const glm::mat4> lhs,
+                      std::span<const glm::mat4> rhs,
+                      std::span<glm::mat4> out) {
+  std::size_t i{};
+  auto count = rhs.size();
+#if defined(__AVX2__)
+  for (; i < count; i++) {
+    multiply(broadcastMatrix(data(lhs[i])), data(rhs[i]), data(out[i]));
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  for (; i < count; i++) {
+    multiply(loadMatrix(data(lhs[i])), data(rhs[i]), data(out[i]));
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = lhs[i] * rhs[i];
+  }
+}
+
+void transformVectors(const glm::mat4 &matrix,
+                      std::span<const glm::vec4> vectors,
+                      std::span<glm::vec4> out) {
+  std::size_t i{};
+  auto count = vectors.size();
+  const auto *in = reinterpret_cast<const float *>(vectors.data());
+  auto *result = reinterpret_cast<float *>(out.data());
+#if defined(__AVX2__)
+  auto wide = broadcastMatrix(data(matrix));
+  for (; i + 2 <= count; i += 2) {
+    _mm256_storeu_ps(result + 4 * i,
+                     transform(wide, _mm256_loadu_ps(in + 4 * i)));
+  }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+  auto narrow = loadMatrix(data(matrix));
+  for (; i < count; i++) {
+    _mm_storeu_ps(result + 4 * i, transform(narrow, _mm_loadu_ps(in + 4 * i)));
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = matrix * vectors[i];
+  }
+}
+
+void transformBounds(std::span<const glm::mat4> transforms,
+                     std::span<const Aabb> local, std::span<Aabb> out) {
+  // 中心按点变换 (w = 1), 半长按 |M| 变换 (w = 0, 不受平移影响).
+  // 每个对象的矩阵不同, 两个一组拼成 256 位反而更慢, AVX2 下也逐个处理
+  std::size_t i{};
+  auto count = transforms.size();
+#if defined(__SSE2__) || defined(_M_X64)
+  alignas(16) float narrowMin[4], narrowMax[4];
+  for (; i < count; i++) {
+    auto m = loadMatrix(data(transforms[i]));
+    auto c = local[i].center(), e = local[i].extents();
+    auto center = transform(m, _mm_setr_ps(c.x, c.y, c.z, 1.0f));
+    auto extent = transform(absolute(m), _mm_setr_ps(e.x, e.y, e.z, 0.0f));
+    _mm_store_ps(narrowMin, _mm_sub_ps(center, extent));
+    _mm_store_ps(narrowMax, _mm_add_ps(center, extent));
+    out[i] = {{narrowMin[0], narrowMin[1], narrowMin[2]},
+              {narrowMax[0], narrowMax[1], narrowMax[2]}};
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = local[i].transformed(transforms[i]);
+  }
+}
+
+void spheresOutsidePlane(const glm::vec4 &plane, const BoundsSoA &bounds,
+                         std::span<std::uint8_t> outside) {
+  std::size_t i{};
+  auto count = bounds.size();
+#if defined(__AVX2__)
+  {
+    auto px = _mm256_set1_ps(plane.x), py = _mm256_set1_ps(plane.y),
+         pz = _mm256_set1_ps(plane.z), pw = _mm256_set1_ps(plane.w);
+    for (; i + 8 <= count; i += 8) {
+      auto dist = _mm256_fmadd_ps(
+          px, _mm256_loadu_ps(bounds.centerX.data() + i),
+          _mm256_fmadd_ps(py, _mm256_loadu_ps(bounds.centerY.data() + i),
+                          _mm256_fmadd_ps(
+                              pz, _mm256_loadu_ps(bounds.centerZ.data() + i),
+                              pw)));
+      auto rad = _mm256_loadu_ps(bounds.radius.data() + i);
+      auto mask = _mm256_movemask_ps(
+          _mm256_cmp_ps(_mm256_add_ps(dist, rad), _mm256_setzero_ps(),
+                        _CMP_LT_OQ));
+      for (int k{}; k < 8; k++) {
+        outside[i + k] = (mask >> k) & 1;
+      }
+    }
+  }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+  {
+    auto px = _mm_set1_ps(plane.x), py = _mm_set1_ps(plane.y),
+         pz = _mm_set1_ps(plane.z), pw = _mm_set1_ps(plane.w);
+    for (; i + 4 <= count; i += 4) {
+      auto dist = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(px, _mm_loadu_ps(bounds.centerX.data() + i)),
+                     _mm_mul_ps(py, _mm_loadu_ps(bounds.centerY.data() + i))),
+          _mm_add_ps(_mm_mul_ps(pz, _mm_loadu_ps(bounds.centerZ.data() + i)),
+                     pw));
+      auto rad = _mm_loadu_ps(bounds.radius.data() + i);
+      auto mask = _mm_movemask_ps(
+          _mm_cmplt_ps(_mm_add_ps(dist, rad), _mm_setzero_ps()));
+      for (int k{}; k < 4; k++) {
+        outside[i + k] = (mask >> k) & 1;
+      }
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    auto dist = plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] +
+                plane.z * bounds.centerZ[i] + plane.w;
+    outside[i] = dist + bounds.radius[i] < 0.0f;
+  }
+}
+
+void composeTransforms(std::span<const glm::vec3> translations,
+                       std::span<const glm::quat> rotations,
+                       std::span<const glm::vec3> scales,
+                       std::span<glm::mat4> out) {
+  std::size_t i{};
+  auto count = rotations.size();
+  // 先把四元数和缩放转成 SoA, 旋转矩阵的 9 个分量并行计算
+#if defined(__AVX2__)
+  alignas(32) float wideIn[7][8], wideOut[9][8];
+  for (; i + 8 <= count; i += 8) {
+    for (std::size_t lane{}; lane < 8; lane++) {
+      const auto &r = rotations[i + lane];
+      const auto &s = scales[i + lane];
+      wideIn[0][lane] = r.x;
+      wideIn[1][lane] = r.y;
+      wideIn[2][lane] = r.z;
+      wideIn[3][lane] = r.w;
+      wideIn[4][lane] = s.x;
+      wideIn[5][lane] = s.y;
+      wideIn[6][lane] = s.z;
+    }
+    __m256 result[9];
+    rotationScale(_mm256_load_ps(wideIn[0]), _mm256_load_ps(wideIn[1]),
+                  _mm256_load_ps(wideIn[2]), _mm256_load_ps(wideIn[3]),
+                  _mm256_load_ps(wideIn[4]), _mm256_load_ps(wideIn[5]),
+                  _mm256_load_ps(wideIn[6]), result);
+    for (int e{}; e < 9; e++) {
+      _mm256_store_ps(wideOut[e], result[e]);
+    }
+    scatterTransforms(wideOut, translations, i, out);
+  }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+  alignas(16) float narrowIn[7][4], narrowOut[9][4];
+  for (; i + 4 <= count; i += 4) {
+    for (std::size_t lane{}; lane < 4; lane++) {
+      const auto &r = rotations[i + lane];
+      const auto &s = scales[i + lane];
+      narrowIn[0][lane] = r.x;
+      narrowIn[1][lane] = r.y;
+      narrowIn[2][lane] = r.z;
+      narrowIn[3][lane] = r.w;
+      narrowIn[4][lane] = s.x;
+      narrowIn[5][lane] = s.y;
+      narrowIn[6][lane] = s.z;
+    }
+    __m128 result[9];
+    rotationScale(_mm_load_ps(narrowIn[0]), _mm_load_ps(narrowIn[1]),
+                  _mm_load_ps(narrowIn[2]), _mm_load_ps(narrowIn[3]),
+                  _mm_load_ps(narrowIn[4]), _mm_load_ps(narrowIn[5]),
+                  _mm_load_ps(narrowIn[6]), result);
+    for (int e{}; e < 9; e++) {
+      _mm_store_ps(narrowOut[e], result[e]);
+    }
+    scatterTransforms(narrowOut, translations, i, out);
+  }
+#endif
+  for (; i < count; i++) {
+    out[i] = composeTransform(translations[i], rotations[i], scales[i]);
+  }
+}
+} // namespace cg
@@ -0,0 +1,143 @@
+#include <bloom.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace cg {
+namespace {
+// 只采样 resource 本帧渲染的区域
+void setRegion(const Shader &shader, const RenderGraph &graph,
+               RenderGraph::Resource resource, UniformName scale,
+               UniformName max) {
+  auto [width, height] = graph.extent(resource);
+  const auto &desc = graph.desc(resource);
+  auto size = glm::vec2(desc.width, desc.height);
+  auto extent = glm::vec2(width, height);
+  shader.setVec2(scale, extent / size);
+  shader.setVec2(max, (extent - 0.5f) / size);
+}
+} // namespace
+
+Bloom::Bloom(Shader &downsampleShader, Shader &upsampleShader, GLuint quadVAO,
+             const BloomSettings &settings)
+    : m_downsampleShader(downsampleShader), m_upsampleShader(upsampleShader),
+      m_quadVAO(quadVAO), m_settings(settings) {}
+
+RenderGraph::Resource Bloom::addPasses(RenderGraph &graph,
+                                       RenderGraph::Resource hdr) {
+  const auto base = graph.desc(hdr);
+  std::vector<RenderGraph::Resource> down;
+  auto width = base.width / 2, height = base.height / 2;
+  while (static_cast<int>(down.size()) < m_settings.maxLevels &&
+         std::min(width, height) >= m_settings.minSize) {
+    auto level = static_cast<int>(down.size());
+    auto source = level == 0 ? hdr : down.back();
+    auto name = "bloom down " + std::to_string(level);
+    auto target =
+        graph.createTexture(name, {width, height, base.format}, true);
+    graph
+        .addPass(name,
+                 [this, source, level](const RenderGraph &g) {
+                   downsample(g, source, level == 0);
+                 })
+        .read(source)
+        .write(target);
+    down.push_back(target);
+    width /= 2;
+    height /= 2;
+  }
+  m_levels = static_cast<int>(down.size());
+  if (down.empty()) {
+    // 目标太小, 没有泛光
+    return hdr;
+  }
+  auto result = down.back();
+  for (auto level = m_levels - 2; level >= 0; level--) {
+    auto baseLevel = down[level];
+    auto name = "bloom up " + std::to_string(level);
+    auto desc = graph.desc(baseLevel);
+    auto target = graph.createTexture(name, desc, true);
+    graph
+        .addPass(name,
+                 [this, baseLevel, result](const RenderGraph &g) {
+                   upsample(g, baseLevel, result);
+                 })
+        .read(baseLevel)
+        .read(result)
+        .write(target);
+    result = target;
+  }
+  return result;
+}
+
+void Bloom::bind(const RenderGraph &graph, RenderGraph::Resource bloom,
+                 const Shader &compositeShader, GLint unit) const {
+  compositeShader.setInt("bloomTexture", unit);
+  setRegion(compositeShader, graph, bloom, "bloomUvScale", "bloomUvMax");
+  // 每一级都叠加了一份, 按级数归一化
+  compositeShader.setFloat("bloomIntensity",
+                           m_levels > 0 ? m_settings.strength / m_levels
+                                        : 0.0f);
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_2D, graph.texture(bloom));
+  glActiveTexture(GL_TEXTURE0);
+}
+
+void Bloom::downsample(const RenderGraph &graph, RenderGraph::Resource source,
+                       bool prefilter) const {
+  const auto &desc = graph.desc(source);
+  m_downsampleShader.use();
+  m_downsampleShader.setInt("texture1", 0);
+  setRegion(m_downsampleShader, graph, source, "uvScale", "uvMax");
+  m_downsampleShader.setVec2("texel",
+                             1.0f / glm::vec2(desc.width, desc.height));
+  m_downsampleShader.setBool("prefilter", prefilter);
+  m_downsampleShader.setFloat("threshold", m_settings.threshold);
+  m_downsampleShader.setFloat("knee", m_settings.knee);
+
+  glDisable(GL_BLEND);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_STENCIL_TEST);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, graph.texture(source));
+  glBindVertexArray(m_quadVAO);
+  glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+void Bloom::upsample(const RenderGraph &graph, RenderGraph::Resource base,
+                     RenderGraph::Resource coarse) const {
+  const auto &desc = graph.desc(coarse);
+  m_upsampleShader.use();
+  m_upsampleShader.setInt("baseTexture", 0);
+  m_upsampleShader.setInt("texture1", 1);
+  setRegion(m_upsampleShader, graph, base, "baseUvScale", "baseUvMax");
+  setRegion(m_upsampleShader, graph, coarse, "uvScale", "uvMax");
+  m_upsampleShader.setVec2("texel", m_settings.upsampleRadius /
+                                        glm::vec2(desc.width, desc.height));
+
+  glDisable(GL_BLEND);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_STENCIL_TEST);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, graph.texture(base));
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, graph.texture(coarse));
+  glActiveTexture(GL_TEXTURE0);
+  glBindVertexArray(m_quadVAO);
+  glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+float Bloom::samplesPerPixel() const {
+  // 第 l 级的像素数为场景的 1/4^(l+1): 下采样 13 次, 上采样 9 + 1 次
+  auto samples = 0.0f, pixels = 1.0f;
+  for (int level{}; level < m_levels; level++) {
+    pixels /= 4.0f;
+    samples += 13.0f * pixels;
+    if (level < m_levels - 1) {
+      samples += 10.0f * pixels;
+    }
+  }
+  return samples;
+}
+} // namespace cg
@@ -0,0 +1,211 @@
+#include <bvh.hpp>
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <stdexcept>
+
+namespace cg {
+namespace {
+constexpr int binCount = 12;
+
+float surfaceArea(const Aabb &box) {
+  auto d = glm::max(box.max - box.min, glm::vec3(0.0f));
+  return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+Aabb merge(const Aabb &a, const Aabb &b) {
+  return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+} // namespace
+
+bool intersects(const Ray &ray, const Aabb &box, float *distance) {
+  float tmin = 0.0f, tmax = ray.maxDistance;
+  for (int axis{}; axis < 3; axis++) {
+    auto inv = 1.0f / ray.direction[axis];
+    auto t0 = (box.min[axis] - ray.origin[axis]) * inv;
+    auto t1 = (box.max[axis] - ray.origin[axis]) * inv;
+    if (inv < 0.0f) {
+      std::swap(t0, t1);
+    }
+    tmin = std::max(tmin, t0);
+    tmax = std::min(tmax, t1);
+    if (tmax < tmin) {
+      return false;
+    }
+  }
+  if (distance) {
+    *distance = tmin;
+  }
+  return true;
+}
+
+bool intersects(const Sphere &sphere, const Aabb &box) {
+  auto closest = glm::clamp(sphere.center, box.min, box.max);
+  auto d = closest - sphere.center;
+  return glm::dot(d, d) <= sphere.radius * sphere.radius;
+}
+
+void Bvh::build(std::span<const Aabb> boxes) {
+  auto count = static_cast<std::uint32_t>(boxes.size());
+  m_boxes.assign(boxes.begin(), boxes.end());
+  m_centroids.resize(count);
+  for (std::uint32_t i{}; i < count; i++) {
+    m_centroids[i] = m_boxes[i].center();
+  }
+  m_objects.resize(count);
+  std::iota(m_objects.begin(), m_objects.end(), 0u);
+  m_nodes.clear();
+  m_leafOf.assign(count, invalid);
+  m_depth = 0;
+  if (count == 0) {
+    return;
+  }
+  // 二叉树最多 2n - 1 个节点, 预留后 subdivide 中的下标始终有效
+  m_nodes.reserve(2 * static_cast<std::size_t>(count));
+  m_nodes.push_back({{}, 0, count, invalid});
+  subdivide(0, 0);
+  if (m_depth + 1 > stackSize) {
+    throw std::runtime_error("bvh is deeper than the traversal stack");
+  }
+}
+
+Aabb Bvh::leafBounds(const Node &node) const {
+  Aabb box;
+  for (auto i = node.start; i < node.start + node.count; i++) {
+    box = merge(box, m_boxes[m_objects[i]]);
+  }
+  return box;
+}
+
+void Bvh::subdivide(std::uint32_t index, int depth) {
+  m_depth = std::max(m_depth, depth);
+  auto &node = m_nodes[index];
+  node.box = leafBounds(node);
+  auto first = node.start, count = node.count;
+  auto makeLeaf = [&] {
+    for (auto i = first; i < first + count; i++) {
+      m_leafOf[m_objects[i]] = index;
+    }
+  };
+  if (count <= maxLeafSize) {
+    makeLeaf();
+    return;
+  }
+
+  Aabb centroidBounds;
+  for (auto i = first; i < first + count; i++) {
+    centroidBounds.expand(m_centroids[m_objects[i]]);
+  }
+  auto extent = centroidBounds.max - centroidBounds.min;
+  int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2)
+                                 : (extent.y > extent.z ? 1 : 2);
+  auto begin = m_objects.begin() + first, end = begin + count;
+  auto mid = begin + count / 2;
+
+  if (extent[axis] <= 0.0f || depth >= maxSahDepth) {
+    // 质心重合或树过深: 按中位数划分
+    std::nth_element(begin, mid, end, [&](auto a, auto b) {
+      return m_centroids[a][axis] < m_centroids[b][axis];
+    });
+  } else {
+    struct Bin {
+      Aabb box;
+      std::uint32_t count{};
+    };
+    std::array<Bin, binCount> bins{};
+    auto scale = binCount / extent[axis];
+    auto binOf = [&](std::uint32_t object) {
+      auto b = static_cast<int>(
+          (m_centroids[object][axis] - centroidBounds.min[axis]) * scale);
+      return std::clamp(b, 0, binCount - 1);
+    };
+    for (auto it = begin; it != end; ++it) {
+      auto &bin = bins[binOf(*it)];
+      bin.box = merge(bin.box, m_boxes[*it]);
+      bin.count++;
+    }
+    // 从右向左累积, 再从左向右扫描求每个分割面的 SAH 代价
+    std::array<float, binCount - 1> rightCost{};
+    Aabb rightBox;
+    std::uint32_t rightCount{};
+    for (int b = binCount - 1; b > 0; b--) {
+      rightBox = merge(rightBox, bins[b].box);
+      rightCount += bins[b].count;
+      rightCost[b - 1] = rightCount * surfaceArea(rightBox);
+    }
+    Aabb leftBox;
+    std::uint32_t leftCount{};
+    float bestCost = std::numeric_limits<float>::max();
+    int bestSplit = -1;
+    for (int b{}; b < binCount - 1; b++) {
+      leftBox = merge(leftBox, bins[b].box);
+      leftCount += bins[b].count;
+      if (leftCount == 0 || leftCount == count) {
+        continue;
+      }
+      auto cost = leftCount * surfaceArea(leftBox) + rightCost[b];
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestSplit = b;
+      }
+    }
+    auto leafCost = count * surfaceArea(node.box);
+    if (bestSplit < 0) {
+      std::nth_element(begin, mid, end, [&](auto a, auto b) {
+        return m_centroids[a][axis] < m_centroids[b][axis];
+      });
+    } else if (bestCost >= leafCost && count <= 4 * maxLeafSize) {
+      makeLeaf();
+      return;
+    } else {
+      mid = std::partition(begin, end, [&](auto object) {
+        return binOf(object) <= bestSplit;
+      });
+    }
+  }
+
+  auto leftCount = static_cast<std::uint32_t>(mid - begin);
+  auto left = static_cast<std::uint32_t>(m_nodes.size());
+  m_nodes.push_back({{}, first, leftCount, index});
+  m_nodes.push_back({{}, first + leftCount, count - leftCount, index});
+  m_nodes[index].start = left;
+  m_nodes[index].count = 0;
+  subdivide(left, depth + 1);
+  subdivide(left + 1, depth + 1);
+}
+
+void Bvh::update(std::uint32_t object, const Aabb &box) {
+  m_boxes[object] = box;
+  m_centroids[object] = box.center();
+  auto index = m_leafOf[object];
+  m_nodes[index].box = leafBounds(m_nodes[index]);
+  for (index = m_nodes[index].parent; index != invalid;
+       index = m_nodes[index].parent) {
+    auto &node = m_nodes[index];
+    auto refitted =
+        merge(m_nodes[node.start].box, m_nodes[node.start + 1].box);
+    if (refitted.min == node.box.min && refitted.max == node.box.max) {
+      break;
+    }
+    node.box = refitted;
+  }
+}
+
+std::uint32_t Bvh::raycast(const Ray &ray, float *distance) const {
+  auto nearest = ray;
+  auto hit = invalid;
+  query(nearest, [&](std::uint32_t object) {
+    float t{};
+    if (intersects(nearest, m_boxes[object], &t) && t < nearest.maxDistance) {
+      // 缩短射线, 之后更远的节点在遍历时直接被剪掉
+      nearest.maxDistance = t;
+      hit = object;
+    }
+  });
+  if (distance && hit != invalid) {
+    *distance = nearest.maxDistance;
+  }
+  return hit;
+}
+} // namespace cg
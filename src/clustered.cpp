@@ -0,0 +1,358 @@
+#include <clustered.hpp>
+#include <culling.hpp>
+#include <jobs.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace cg {
+namespace {
+constexpr int tilesPerSlice = LightClusters::tilesX * LightClusters::tilesY;
+// 每个作业处理的光源数
+constexpr std::size_t lightGrain = 64;
+static_assert(tilesPerSlice % 8 == 0, "每层的簇数应为 8 的倍数");
+
+// 视空间中的待测光源, 聚光用圆锥 (Wronski) 进一步剔除
+struct ViewLight {
+  glm::vec3 position;
+  float radius;
+  bool spot;
+  glm::vec3 direction;
+  float cosAngle, sinAngle;
+};
+
+template <typename Slice>
+bool clusterHit(const Slice &s, int t, const ViewLight &l) {
+  auto dx = std::max(s.minX[t] - l.position.x, 0.0f) +
+            std::max(l.position.x - s.maxX[t], 0.0f);
+  auto dy = std::max(s.minY[t] - l.position.y, 0.0f) +
+            std::max(l.position.y - s.maxY[t], 0.0f);
+  auto dz = std::max(s.minZ[t] - l.position.z, 0.0f) +
+            std::max(l.position.z - s.maxZ[t], 0.0f);
+  if (dx * dx + dy * dy + dz * dz > l.radius * l.radius) {
+    return false;
+  }
+  if (!l.spot) {
+    return true;
+  }
+  glm::vec3 v{s.centerX[t] - l.position.x, s.centerY[t] - l.position.y,
+              s.centerZ[t] - l.position.z};
+  auto v1 = glm::dot(v, l.direction);
+  auto closest = l.cosAngle * std::sqrt(std::max(glm::dot(v, v) - v1 * v1,
+                                                 0.0f)) -
+                 v1 * l.sinAngle;
+  auto r = s.radius[t];
+  return !(closest > r || v1 > r + l.radius || v1 < -r);
+}
+
+// 测试一层内的所有簇, 命中的 (簇, 光源) 追加到 clusters/lights
+template <typename Slice>
+void testSlice(const Slice &s, std::uint32_t base, const ViewLight &l,
+               std::uint32_t light, std::vector<std::uint32_t> &clusters,
+               std::vector<std::uint32_t> &lights) {
+  auto emit = [&](unsigned mask, int t) {
+    for (; mask; mask &= mask - 1) {
+      clusters.push_back(base + t + std::countr_zero(mask));
+      lights.push_back(light);
+    }
+  };
+  int t{};
+#if defined(__AVX2__)
+  {
+    auto px = _mm256_set1_ps(l.position.x), py = _mm256_set1_ps(l.position.y),
+         pz = _mm256_set1_ps(l.position.z);
+    auto dirX = _mm256_set1_ps(l.direction.x),
+         dirY = _mm256_set1_ps(l.direction.y),
+         dirZ = _mm256_set1_ps(l.direction.z);
+    auto r2 = _mm256_set1_ps(l.radius * l.radius);
+    auto range = _mm256_set1_ps(l.radius);
+    auto cosA = _mm256_set1_ps(l.cosAngle), sinA = _mm256_set1_ps(l.sinAngle);
+    auto zero = _mm256_setzero_ps();
+    auto gap = [&](const float *lo, const float *hi, __m256 p) {
+      return _mm256_add_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_loadu_ps(lo), p),
+                                         zero),
+                           _mm256_max_ps(_mm256_sub_ps(p, _mm256_loadu_ps(hi)),
+                                         zero));
+    };
+    for (; t + 8 <= tilesPerSlice; t += 8) {
+      auto dx = gap(s.minX.data() + t, s.maxX.data() + t, px);
+      auto dy = gap(s.minY.data() + t, s.maxY.data() + t, py);
+      auto dz = gap(s.minZ.data() + t, s.maxZ.data() + t, pz);
+      auto d2 = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)),
+          _mm256_mul_ps(dz, dz));
+      auto hit = _mm256_cmp_ps(d2, r2, _CMP_LE_OQ);
+      if (l.spot && _mm256_movemask_ps(hit)) {
+        auto vx = _mm256_sub_ps(_mm256_loadu_ps(s.centerX.data() + t), px);
+        auto vy = _mm256_sub_ps(_mm256_loadu_ps(s.centerY.data() + t), py);
+        auto vz = _mm256_sub_ps(_mm256_loadu_ps(s.centerZ.data() + t), pz);
+        auto v2 = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)),
+            _mm256_mul_ps(vz, vz));
+        auto v1 = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(vx, dirX), _mm256_mul_ps(vy, dirY)),
+            _mm256_mul_ps(vz, dirZ));
+        auto perp = _mm256_sqrt_ps(
+            _mm256_max_ps(_mm256_sub_ps(v2, _mm256_mul_ps(v1, v1)), zero));
+        auto closest =
+            _mm256_sub_ps(_mm256_mul_ps(cosA, perp), _mm256_mul_ps(v1, sinA));
+        auto r = _mm256_loadu_ps(s.radius.data() + t);
+        auto cull = _mm256_or_ps(
+            _mm256_cmp_ps(closest, r, _CMP_GT_OQ),
+            _mm256_or_ps(
+                _mm256_cmp_ps(v1, _mm256_add_ps(r, range), _CMP_GT_OQ),
+                _mm256_cmp_ps(v1, _mm256_sub_ps(zero, r), _CMP_LT_OQ)));
+        hit = _mm256_andnot_ps(cull, hit);
+      }
+      emit(static_cast<unsigned>(_mm256_movemask_ps(hit)), t);
+    }
+  }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+  {
+    auto px = _mm_set1_ps(l.position.x), py = _mm_set1_ps(l.position.y),
+         pz = _mm_set1_ps(l.position.z);
+    auto dirX = _mm_set1_ps(l.direction.x), dirY = _mm_set1_ps(l.direction.y),
+         dirZ = _mm_set1_ps(l.direction.z);
+    auto r2 = _mm_set1_ps(l.radius * l.radius);
+    auto range = _mm_set1_ps(l.radius);
+    auto cosA = _mm_set1_ps(l.cosAngle), sinA = _mm_set1_ps(l.sinAngle);
+    auto zero = _mm_setzero_ps();
+    auto gap = [&](const float *lo, const float *hi, __m128 p) {
+      return _mm_add_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(lo), p), zero),
+                        _mm_max_ps(_mm_sub_ps(p, _mm_loadu_ps(hi)), zero));
+    };
+    for (; t + 4 <= tilesPerSlice; t += 4) {
+      auto dx = gap(s.minX.data() + t, s.maxX.data() + t, px);
+      auto dy = gap(s.minY.data() + t, s.maxY.data() + t, py);
+      auto dz = gap(s.minZ.data() + t, s.maxZ.data() + t, pz);
+      auto d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                           _mm_mul_ps(dz, dz));
+      auto hit = _mm_cmple_ps(d2, r2);
+      if (l.spot && _mm_movemask_ps(hit)) {
+        auto vx = _mm_sub_ps(_mm_loadu_ps(s.centerX.data() + t), px);
+        auto vy = _mm_sub_ps(_mm_loadu_ps(s.centerY.data() + t), py);
+        auto vz = _mm_sub_ps(_mm_loadu_ps(s.centerZ.data() + t), pz);
+        auto v2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)),
+                             _mm_mul_ps(vz, vz));
+        auto v1 = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(vx, dirX), _mm_mul_ps(vy, dirY)),
+            _mm_mul_ps(vz, dirZ));
+        auto perp =
+            _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(v2, _mm_mul_ps(v1, v1)), zero));
+        auto closest = _mm_sub_ps(_mm_mul_ps(cosA, perp), _mm_mul_ps(v1, sinA));
+        auto r = _mm_loadu_ps(s.radius.data() + t);
+        auto cull = _mm_or_ps(
+            _mm_cmpgt_ps(closest, r),
+            _mm_or_ps(_mm_cmpgt_ps(v1, _mm_add_ps(r, range)),
+                      _mm_cmplt_ps(v1, _mm_sub_ps(zero, r))));
+        hit = _mm_andnot_ps(cull, hit);
+      }
+      emit(static_cast<unsigned>(_mm_movemask_ps(hit)), t);
+    }
+  }
+#endif
+  for (; t < tilesPerSlice; t++) {
+    if (clusterHit(s, t, l)) {
+      emit(1u, t);
+    }
+  }
+}
+} // namespace
+
+float lightRange(const ClusterLight &light) {
+  auto color = glm::max(glm::max(light.ambient, light.diffuse), light.specular);
+  auto brightest = std::max({color.x, color.y, color.z});
+  // 解 quadratic * d^2 + linear * d + constant = 256 * brightest
+  auto c = light.constant - 256.0f * brightest;
+  if (c >= 0.0f) {
+    return 0.0f;
+  }
+  if (light.quadratic <= 0.0f) {
+    return light.linear > 0.0f ? -c / light.linear : 1e30f;
+  }
+  return (-light.linear + std::sqrt(light.linear * light.linear -
+                                    4.0f * light.quadratic * c)) /
+         (2.0f * light.quadratic);
+}
+
+LightClusters::LightClusters() {
+  glGenBuffers(3, m_buffers);
+  glGenTextures(3, m_textures);
+  const GLenum formats[] = {GL_RGBA32F, GL_RG32UI, GL_R32UI};
+  for (int k{}; k < 3; k++) {
+    glBindBuffer(GL_TEXTURE_BUFFER, m_buffers[k]);
+    glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, m_textures[k]);
+    glTexBuffer(GL_TEXTURE_BUFFER, formats[k], m_buffers[k]);
+  }
+  glBindTexture(GL_TEXTURE_BUFFER, 0);
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  m_grid.assign(2 * clusterCount, 0);
+}
+
+LightClusters::~LightClusters() {
+  glDeleteTextures(3, m_textures);
+  glDeleteBuffers(3, m_buffers);
+}
+
+void LightClusters::setProjection(const glm::mat4 &projection, float zNear,
+                                  float zFar) {
+  if (projection == m_projection && zNear == m_near && zFar == m_far) {
+    return;
+  }
+  m_projection = projection;
+  m_near = zNear;
+  m_far = zFar;
+  m_sliceScale = slices / std::log(zFar / zNear);
+
+  // 每个块四个角的视线方向 (视空间, z = -1)
+  auto inverse = glm::inverse(projection);
+  auto ray = [&inverse](float ndcX, float ndcY) {
+    auto p = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    auto v = glm::vec3(p) / p.w;
+    return v / -v.z;
+  };
+  m_slices.assign(slices, {});
+  for (int z{}; z < slices; z++) {
+    auto &s = m_slices[z];
+    auto depthNear = zNear * std::pow(zFar / zNear, float(z) / slices);
+    auto depthFar = zNear * std::pow(zFar / zNear, float(z + 1) / slices);
+    for (auto *v : {&s.minX, &s.minY, &s.minZ, &s.maxX, &s.maxY, &s.maxZ,
+                    &s.centerX, &s.centerY, &s.centerZ, &s.radius}) {
+      v->resize(tilesPerSlice);
+    }
+    for (int y{}; y < tilesY; y++) {
+      for (int x{}; x < tilesX; x++) {
+        auto x0 = -1.0f + 2.0f * x / tilesX, x1 = -1.0f + 2.0f * (x + 1) / tilesX;
+        auto y0 = -1.0f + 2.0f * y / tilesY, y1 = -1.0f + 2.0f * (y + 1) / tilesY;
+        Aabb box;
+        for (auto corner : {ray(x0, y0), ray(x1, y0), ray(x0, y1), ray(x1, y1)}) {
+          box.expand(corner * depthNear);
+          box.expand(corner * depthFar);
+        }
+        auto t = y * tilesX + x;
+        auto c = box.center();
+        s.minX[t] = box.min.x, s.minY[t] = box.min.y, s.minZ[t] = box.min.z;
+        s.maxX[t] = box.max.x, s.maxY[t] = box.max.y, s.maxZ[t] = box.max.z;
+        s.centerX[t] = c.x, s.centerY[t] = c.y, s.centerZ[t] = c.z;
+        s.radius[t] = glm::length(box.extents());
+      }
+    }
+  }
+}
+
+int LightClusters::sliceOf(float viewDepth) const {
+  auto slice = static_cast<int>(std::log(viewDepth / m_near) * m_sliceScale);
+  return std::clamp(slice, 0, slices - 1);
+}
+
+void LightClusters::build(std::span<const ClusterLight> lights,
+                          const glm::mat4 &view) {
+  auto start = std::chrono::steady_clock::now();
+  m_lightCount = lights.size();
+  m_lightTexels.resize(m_lightCount * lightTexels);
+  m_blockHits.resize((m_lightCount + lightGrain - 1) / lightGrain);
+  auto rotation = glm::mat3(view);
+  auto assign = [&](std::size_t begin, std::size_t end) {
+    auto &hits = m_blockHits[begin / lightGrain];
+    hits.cluster.clear();
+    hits.light.clear();
+    for (auto i = static_cast<std::uint32_t>(begin); i < end; i++) {
+      const auto &light = lights[i];
+      auto *texel = m_lightTexels.data() + i * lightTexels;
+      texel[0] = glm::vec4(light.position, light.radius);
+      texel[1] = glm::vec4(light.ambient, light.constant);
+      texel[2] = glm::vec4(light.diffuse, light.linear);
+      texel[3] = glm::vec4(light.specular, light.quadratic);
+      texel[4] = glm::vec4(glm::normalize(light.direction), 0.0f);
+      texel[5] = glm::vec4(light.cutOff, light.outerCutOff,
+                           static_cast<float>(light.shadowSlot), 0.0f);
+
+      auto position = glm::vec3(view * glm::vec4(light.position, 1.0f));
+      auto depth = -position.z;
+      if (depth + light.radius < m_near || depth - light.radius > m_far) {
+        continue;
+      }
+      // 张角不小于 90 度的聚光按点光源处理
+      ViewLight l{position, light.radius, light.outerCutOff > 0.0f,
+                  glm::normalize(rotation * light.direction), light.outerCutOff,
+                  std::sqrt(std::max(
+                      1.0f - light.outerCutOff * light.outerCutOff, 0.0f))};
+      auto first = sliceOf(std::max(depth - light.radius, m_near));
+      auto last = sliceOf(std::min(depth + light.radius, m_far));
+      for (int z = first; z <= last; z++) {
+        testSlice(m_slices[z], static_cast<std::uint32_t>(z * tilesPerSlice),
+                  l, i, hits.cluster, hits.light);
+      }
+    }
+  };
+  JobSystem::shared().parallelFor(0, m_lightCount, lightGrain, assign);
+
+  // 按簇计数排序: 先统计数量并求前缀和, 再把计数清零重新填入
+  std::ranges::fill(m_grid, 0u);
+  std::size_t hitCount{};
+  for (const auto &hits : m_blockHits) {
+    for (auto cluster : hits.cluster) {
+      m_grid[2 * cluster + 1]++;
+    }
+    hitCount += hits.cluster.size();
+  }
+  std::uint32_t offset{};
+  for (int c{}; c < clusterCount; c++) {
+    m_grid[2 * c] = offset;
+    offset += m_grid[2 * c + 1];
+    m_grid[2 * c + 1] = 0;
+  }
+  m_indices.resize(hitCount);
+  for (const auto &hits : m_blockHits) {
+    for (std::size_t h{}; h < hits.cluster.size(); h++) {
+      auto cluster = hits.cluster[h];
+      m_indices[m_grid[2 * cluster] + m_grid[2 * cluster + 1]++] =
+          hits.light[h];
+    }
+  }
+
+  auto upload = [](GLuint buffer, const void *data, std::size_t bytes) {
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, std::max<std::size_t>(bytes, 16), nullptr,
+                 GL_STREAM_DRAW);
+    if (bytes) {
+      glBufferSubData(GL_TEXTURE_BUFFER, 0, bytes, data);
+    }
+  };
+  upload(m_buffers[0], m_lightTexels.data(),
+         m_lightTexels.size() * sizeof(glm::vec4));
+  upload(m_buffers[1], m_grid.data(), m_grid.size() * sizeof(std::uint32_t));
+  upload(m_buffers[2], m_indices.data(),
+         m_indices.size() * sizeof(std::uint32_t));
+  glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  m_buildMicroseconds = std::chrono::duration<double, std::micro>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+}
+
+LightClusters::Block LightClusters::block(const glm::vec2 &screenSize) const {
+  return {{tilesX, tilesY, slices},
+          0,
+          screenSize / glm::vec2(float(tilesX), float(tilesY)),
+          m_near,
+          m_sliceScale};
+}
+
+void LightClusters::bind(const cg::Shader &shader, int firstUnit) const {
+  const char *names[] = {"lightData", "clusterGrid", "lightIndices"};
+  for (int k{}; k < 3; k++) {
+    glActiveTexture(GL_TEXTURE0 + firstUnit + k);
+    glBindTexture(GL_TEXTURE_BUFFER, m_textures[k]);
+    shader.setInt(names[k], firstUnit + k);
+  }
+  glActiveTexture(GL_TEXTURE0);
+}
+} // namespace cg
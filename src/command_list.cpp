@@ -0,0 +1,148 @@
+#include <command_list.hpp>
+
+#include <glm/gtc/type_ptr.hpp>
+
+namespace cg {
+namespace {
+// 顺序读取命令参数, 参数没有对齐, 逐个 memcpy
+class Reader {
+public:
+  explicit Reader(const std::byte *data) : m_data(data) {}
+  template <typename T> T read() {
+    T value;
+    std::memcpy(&value, m_data, sizeof(T));
+    m_data += sizeof(T);
+    return value;
+  }
+  const std::byte *position() const { return m_data; }
+
+private:
+  const std::byte *m_data;
+};
+} // namespace
+
+void CommandList::execute() const {
+  execute(std::span(this, 1));
+}
+
+void CommandList::execute(std::span<const CommandList> lists) {
+  State state;
+  for (const auto &list : lists) {
+    list.execute(state);
+  }
+  // 其余代码默认活动纹理单元为 0, 没有切换过时保持原样
+  if (state.unit != 0 && state.unit != ~GLuint{}) {
+    glActiveTexture(GL_TEXTURE0);
+  }
+}
+
+void CommandList::execute(State &state) const {
+  Reader in{m_bytes.data()};
+  const auto *end = m_bytes.data() + m_bytes.size();
+  while (in.position() < end) {
+    switch (in.read<Op>()) {
+    case Op::UseProgram: {
+      auto program = in.read<GLuint>();
+      if (program != state.program) {
+        glUseProgram(program);
+        state.program = program;
+      }
+      break;
+    }
+    case Op::BindVertexArray: {
+      auto vao = in.read<GLuint>();
+      if (vao != state.vao) {
+        glBindVertexArray(vao);
+        state.vao = vao;
+      }
+      break;
+    }
+    case Op::BindTexture: {
+      auto target = in.read<GLenum>();
+      auto unit = in.read<GLuint>();
+      auto texture = in.read<GLuint>();
+      if (unit != state.unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        state.unit = unit;
+      }
+      glBindTexture(target, texture);
+      break;
+    }
+    case Op::BindBufferRange: {
+      auto target = in.read<GLenum>();
+      auto index = in.read<GLuint>();
+      auto buffer = in.read<GLuint>();
+      auto offset = in.read<GLintptr>();
+      auto size = in.read<GLsizeiptr>();
+      glBindBufferRange(target, index, buffer, offset, size);
+      break;
+    }
+    case Op::Uniform1i: {
+      auto location = in.read<GLint>();
+      glUniform1i(location, in.read<GLint>());
+      break;
+    }
+    case Op::Uniform1f: {
+      auto location = in.read<GLint>();
+      glUniform1f(location, in.read<float>());
+      break;
+    }
+    case Op::Uniform3f: {
+      auto location = in.read<GLint>();
+      auto value = in.read<glm::vec3>();
+      glUniform3fv(location, 1, glm::value_ptr(value));
+      break;
+    }
+    case Op::Uniform4f: {
+      auto location = in.read<GLint>();
+      auto value = in.read<glm::vec4>();
+      glUniform4fv(location, 1, glm::value_ptr(value));
+      break;
+    }
+    case Op::UniformMatrix3f: {
+      auto location = in.read<GLint>();
+      auto value = in.read<glm::mat3>();
+      glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value));
+      break;
+    }
+    case Op::UniformMatrix4f: {
+      auto location = in.read<GLint>();
+      auto value = in.read<glm::mat4>();
+      glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+      break;
+    }
+    case Op::DrawArrays: {
+      auto mode = in.read<GLenum>();
+      auto first = in.read<GLint>();
+      glDrawArrays(mode, first, in.read<GLsizei>());
+      break;
+    }
+    case Op::DrawArraysInstanced: {
+      auto mode = in.read<GLenum>();
+      auto first = in.read<GLint>();
+      auto count = in.read<GLsizei>();
+      glDrawArraysInstanced(mode, first, count, in.read<GLsizei>());
+      break;
+    }
+    case Op::DrawElements: {
+      auto mode = in.read<GLenum>();
+      auto count = in.read<GLsizei>();
+      auto type = in.read<GLenum>();
+      auto offset = in.read<std::size_t>();
+      glDrawElements(mode, count, type, reinterpret_cast<void *>(offset));
+      break;
+    }
+    case Op::DrawElementsInstanced: {
+      auto mode = in.read<GLenum>();
+      auto count = in.read<GLsizei>();
+      auto type = in.read<GLenum>();
+      auto offset = in.read<std::size_t>();
+      glDrawElementsInstanced(mode, count, type,
+                              reinterpret_cast<void *>(offset),
+                              in.read<GLsizei>());
+      break;
+    }
+    }
+  }
+}
+} // namespace cg
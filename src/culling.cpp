@@ -0,0 +1,195 @@
+#include <culling.hpp>
+#include <jobs.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace cg {
+Aabb Aabb::transformed(const glm::mat4 &transform) const {
+  auto c = glm::vec3(transform * glm::vec4(center(), 1.0f));
+  auto e = extents();
+  glm::vec3 r{};
+  for (int row{}; row < 3; row++) {
+    r[row] = std::abs(transform[0][row]) * e.x +
+             std::abs(transform[1][row]) * e.y +
+             std::abs(transform[2][row]) * e.z;
+  }
+  return {c - r, c + r};
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4 &m) {
+  auto row = [&m](int i) {
+    return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+  };
+  Frustum frustum{{row(3) + row(0), row(3) - row(0), row(3) + row(1),
+                   row(3) - row(1), row(3) + row(2), row(3) - row(2)}};
+  for (auto &plane : frustum.planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  return frustum;
+}
+
+bool Frustum::intersects(const Sphere &sphere) const {
+  return std::ranges::all_of(planes, [&sphere](const glm::vec4 &p) {
+    return glm::dot(glm::vec3(p), sphere.center) + p.w >= -sphere.radius;
+  });
+}
+
+bool Frustum::intersects(const Aabb &box) const {
+  auto c = box.center(), e = box.extents();
+  return std::ranges::all_of(planes, [&](const glm::vec4 &p) {
+    auto r = glm::dot(glm::abs(glm::vec3(p)), e);
+    return glm::dot(glm::vec3(p), c) + p.w >= -r;
+  });
+}
+
+void BoundsSoA::push(const Aabb &box, float sphereRadius) {
+  auto c = box.center(), e = box.extents();
+  centerX.push_back(c.x);
+  centerY.push_back(c.y);
+  centerZ.push_back(c.z);
+  extentX.push_back(e.x);
+  extentY.push_back(e.y);
+  extentZ.push_back(e.z);
+  radius.push_back(sphereRadius < 0.0f ? glm::length(e) : sphereRadius);
+}
+
+void BoundsSoA::set(std::size_t index, const Aabb &box, float sphereRadius) {
+  auto c = box.center(), e = box.extents();
+  centerX[index] = c.x;
+  centerY[index] = c.y;
+  centerZ[index] = c.z;
+  extentX[index] = e.x;
+  extentY[index] = e.y;
+  extentZ[index] = e.z;
+  radius[index] = sphereRadius < 0.0f ? glm::length(e) : sphereRadius;
+}
+
+void BoundsSoA::clear() {
+  for (auto *v : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ,
+                  &radius}) {
+    v->clear();
+  }
+}
+
+namespace {
+// 每个作业至少测试这么多对象, 更少时调度开销大于测试本身
+constexpr std::size_t minimumGrain = 4096;
+
+std::size_t cullRange(const Frustum &frustum, const BoundsSoA &b,
+                      std::uint8_t *visible, std::size_t begin,
+                      std::size_t end) {
+  std::size_t culled{};
+  std::size_t i = begin;
+#if defined(__AVX2__)
+  for (; i + 8 <= end; i += 8) {
+    auto cx = _mm256_loadu_ps(b.centerX.data() + i);
+    auto cy = _mm256_loadu_ps(b.centerY.data() + i);
+    auto cz = _mm256_loadu_ps(b.centerZ.data() + i);
+    auto ex = _mm256_loadu_ps(b.extentX.data() + i);
+    auto ey = _mm256_loadu_ps(b.extentY.data() + i);
+    auto ez = _mm256_loadu_ps(b.extentZ.data() + i);
+    auto rad = _mm256_loadu_ps(b.radius.data() + i);
+    auto outside = _mm256_setzero_ps();
+    for (const auto &p : frustum.planes) {
+      auto dist = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.x), cx),
+                        _mm256_mul_ps(_mm256_set1_ps(p.y), cy)),
+          _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.z), cz),
+                        _mm256_set1_ps(p.w)));
+      auto r = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::abs(p.x)), ex),
+                        _mm256_mul_ps(_mm256_set1_ps(std::abs(p.y)), ey)),
+          _mm256_mul_ps(_mm256_set1_ps(std::abs(p.z)), ez));
+      r = _mm256_min_ps(r, rad);
+      outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(dist, r),
+                                                    _mm256_setzero_ps(),
+                                                    _CMP_LT_OQ));
+    }
+    auto mask = _mm256_movemask_ps(outside);
+    for (int k{}; k < 8; k++) {
+      visible[i + k] = !((mask >> k) & 1);
+    }
+    culled += std::popcount(static_cast<unsigned>(mask));
+  }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+  for (; i + 4 <= end; i += 4) {
+    auto cx = _mm_loadu_ps(b.centerX.data() + i);
+    auto cy = _mm_loadu_ps(b.centerY.data() + i);
+    auto cz = _mm_loadu_ps(b.centerZ.data() + i);
+    auto ex = _mm_loadu_ps(b.extentX.data() + i);
+    auto ey = _mm_loadu_ps(b.extentY.data() + i);
+    auto ez = _mm_loadu_ps(b.extentZ.data() + i);
+    auto rad = _mm_loadu_ps(b.radius.data() + i);
+    auto outside = _mm_setzero_ps();
+    for (const auto &p : frustum.planes) {
+      auto dist = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x), cx),
+                     _mm_mul_ps(_mm_set1_ps(p.y), cy)),
+          _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.z), cz), _mm_set1_ps(p.w)));
+      auto r = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::abs(p.x)), ex),
+                     _mm_mul_ps(_mm_set1_ps(std::abs(p.y)), ey)),
+          _mm_mul_ps(_mm_set1_ps(std::abs(p.z)), ez));
+      r = _mm_min_ps(r, rad);
+      outside = _mm_or_ps(outside,
+                          _mm_cmplt_ps(_mm_add_ps(dist, r), _mm_setzero_ps()));
+    }
+    auto mask = _mm_movemask_ps(outside);
+    for (int k{}; k < 4; k++) {
+      visible[i + k] = !((mask >> k) & 1);
+    }
+    culled += std::popcount(static_cast<unsigned>(mask));
+  }
+#endif
+  for (; i < end; i++) {
+    bool inside = true;
+    for (const auto &p : frustum.planes) {
+      auto dist = p.x * b.centerX[i] + p.y * b.centerY[i] +
+                  p.z * b.centerZ[i] + p.w;
+      auto r = std::abs(p.x) * b.extentX[i] + std::abs(p.y) * b.extentY[i] +
+               std::abs(p.z) * b.extentZ[i];
+      if (dist + std::min(r, b.radius[i]) < 0.0f) {
+        inside = false;
+        break;
+      }
+    }
+    visible[i] = inside;
+    culled += !inside;
+  }
+  return culled;
+}
+} // namespace
+
+CullStats cullBounds(const Frustum &frustum, const BoundsSoA &bounds,
+                     std::vector<std::uint8_t> &visible) {
+  auto start = std::chrono::steady_clock::now();
+  auto count = bounds.size();
+  visible.resize(count);
+  CullStats stats{count};
+
+  // 每个线程约四块, 留出窃取的余地; 块按 8 对齐, 都走满宽度的 SIMD 路径
+  auto &jobs = JobSystem::shared();
+  auto blocks = 4 * (std::size_t{jobs.workerCount()} + 1);
+  auto grain = (std::max(minimumGrain, (count + blocks - 1) / blocks) + 7) &
+               ~std::size_t{7};
+  std::atomic<std::size_t> culled{};
+  jobs.parallelFor(0, count, grain, [&](std::size_t begin, std::size_t end) {
+    culled.fetch_add(cullRange(frustum, bounds, visible.data(), begin, end),
+                     std::memory_order_relaxed);
+  });
+  stats.culled = culled.load();
+  stats.microseconds = std::chrono::duration<double, std::micro>(
+                           std::chrono::steady_clock::now() - start)
+                           .count();
+  return stats;
+}
+} // namespace cg
@@ -0,0 +1,116 @@
+#include <deferred.hpp>
+
+#include <cmath>
+#include <glm/gtc/constants.hpp>
+#include <vector>
+
+namespace cg {
+namespace {
+constexpr int sphereSegments = 16, sphereRings = 8;
+} // namespace
+
+DeferredRenderer::DeferredRenderer() {
+  // 单位球, 放大到外切以免低面数的球比真实影响范围小
+  auto scale = 1.0f / std::cos(glm::pi<float>() / sphereSegments) /
+               std::cos(glm::pi<float>() / (2 * sphereRings));
+  std::vector<glm::vec3> vertices;
+  for (int ring{}; ring <= sphereRings; ring++) {
+    auto phi = glm::pi<float>() * ring / sphereRings;
+    for (int segment{}; segment <= sphereSegments; segment++) {
+      auto theta = 2.0f * glm::pi<float>() * segment / sphereSegments;
+      vertices.push_back(scale * glm::vec3(std::sin(phi) * std::cos(theta),
+                                           std::cos(phi),
+                                           std::sin(phi) * std::sin(theta)));
+    }
+  }
+  // 从外侧看为逆时针
+  std::vector<GLuint> indices;
+  for (int ring{}; ring < sphereRings; ring++) {
+    for (int segment{}; segment < sphereSegments; segment++) {
+      GLuint a = ring * (sphereSegments + 1) + segment;
+      GLuint b = a + sphereSegments + 1;
+      indices.insert(indices.end(), {a, a + 1, b, b, a + 1, b + 1});
+    }
+  }
+  m_sphereIndexCount = static_cast<GLsizei>(indices.size());
+  glGenVertexArrays(1, &m_sphereVAO);
+  glGenBuffers(1, &m_sphereVBO);
+  glGenBuffers(1, &m_sphereEBO);
+  glBindVertexArray(m_sphereVAO);
+  glBindBuffer(GL_ARRAY_BUFFER, m_sphereVBO);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3),
+               vertices.data(), GL_STATIC_DRAW);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3),
+                        (void *)0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_sphereEBO);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
+               indices.data(), GL_STATIC_DRAW);
+  glBindVertexArray(0);
+}
+
+DeferredRenderer::~DeferredRenderer() {
+  glDeleteVertexArrays(1, &m_sphereVAO);
+  glDeleteBuffers(1, &m_sphereVBO);
+  glDeleteBuffers(1, &m_sphereEBO);
+}
+
+void DeferredRenderer::beginGeometry() {
+  // gAlbedoSpec 的 a 通道存的是镜面强度, 不能参与混合
+  glDisable(GL_BLEND);
+  const float zero[] = {0.0f, 0.0f, 0.0f, 0.0f};
+  for (GLint i{}; i < 3; i++) {
+    glClearBufferfv(GL_COLOR, i, zero);
+  }
+}
+
+void DeferredRenderer::bindGBuffer(cg::Shader &shader) {
+  shader.use();
+  shader.setInt("gPosition", 0);
+  shader.setInt("gNormal", 1);
+  shader.setInt("gAlbedoSpec", 2);
+}
+
+void DeferredRenderer::light(const std::array<GLuint, 3> &gBuffer,
+                             cg::Shader &ambientShader, GLuint quadVAO,
+                             cg::Shader &volumeShader, GLuint lightData,
+                             GLsizei lightCount) {
+  for (int i{}; i < 3; i++) {
+    glActiveTexture(GL_TEXTURE0 + i);
+    glBindTexture(GL_TEXTURE_2D, gBuffer[i]);
+  }
+  glActiveTexture(GL_TEXTURE3);
+  glBindTexture(GL_TEXTURE_BUFFER, lightData);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_ONE, GL_ONE);
+  glDepthMask(GL_FALSE);
+
+  // 定向光与手电筒覆盖整个屏幕
+  bindGBuffer(ambientShader);
+  glDisable(GL_DEPTH_TEST);
+  glBindVertexArray(quadVAO);
+  glDrawArrays(GL_TRIANGLES, 0, 6);
+
+  // 只画光源球的背面, 背面在场景表面之后 (GEQUAL) 的像素才可能被照亮;
+  // 相机在球内时同样成立. 深度钳制避免远处的球被远平面裁掉
+  bindGBuffer(volumeShader);
+  volumeShader.setInt("lightData", 3);
+  glEnable(GL_DEPTH_TEST);
+  glDepthFunc(GL_GEQUAL);
+  glEnable(GL_CULL_FACE);
+  glCullFace(GL_FRONT);
+  glEnable(GL_DEPTH_CLAMP);
+  glBindVertexArray(m_sphereVAO);
+  glDrawElementsInstanced(GL_TRIANGLES, m_sphereIndexCount, GL_UNSIGNED_INT, 0,
+                          lightCount);
+
+  glDisable(GL_DEPTH_CLAMP);
+  glCullFace(GL_BACK);
+  glDisable(GL_CULL_FACE);
+  glDepthFunc(GL_LESS);
+  glDepthMask(GL_TRUE);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glBindVertexArray(0);
+  glActiveTexture(GL_TEXTURE0);
+}
+} // namespace cg
@@ -0,0 +1,48 @@
+#include <dynamic_resolution.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace cg {
+ResolutionController::ResolutionController(const ResolutionSettings &settings)
+    : m_settings(settings), m_scale(settings.maxScale) {}
+
+float ResolutionController::update(float gpuMilliseconds) {
+  if (gpuMilliseconds <= 0.0f) {
+    return m_scale;
+  }
+  m_smoothed = m_smoothed == 0.0f
+                   ? gpuMilliseconds
+                   : m_smoothed + (gpuMilliseconds - m_smoothed) *
+                                      m_settings.smoothing;
+  if (m_cooldown > 0) {
+    m_cooldown--;
+    return m_scale;
+  }
+  const auto target = m_settings.targetMilliseconds;
+  auto over = m_smoothed > target;
+  auto under = m_smoothed < target * m_settings.raiseThreshold;
+  if (!over && !under) {
+    return m_scale;
+  }
+  auto aim = target * (1.0f + m_settings.raiseThreshold) * 0.5f;
+  auto desired = m_scale * std::sqrt(aim / m_smoothed);
+  desired = std::clamp(desired, m_scale - m_settings.maxStep,
+                       m_scale + m_settings.maxStep);
+  desired = std::clamp(desired, m_settings.minScale, m_settings.maxScale);
+  // 已经到达边界时不再重置平滑
+  if (std::abs(desired - m_scale) < 1e-3f) {
+    return m_scale;
+  }
+  m_scale = desired;
+  m_smoothed = 0.0f;
+  m_cooldown = m_settings.cooldownFrames;
+  return m_scale;
+}
+
+void ResolutionController::reset() {
+  m_scale = m_settings.maxScale;
+  m_smoothed = 0.0f;
+  m_cooldown = 0;
+}
+} // namespace cg
@@ -0,0 +1,160 @@
+#include <ecs.hpp>
+
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+
+namespace cg {
+namespace {
+struct ComponentInfo {
+  std::size_t size, alignment;
+};
+std::mutex registryMutex;
+std::vector<ComponentInfo> registry;
+
+ComponentInfo componentInfo(std::uint32_t id) {
+  std::lock_guard lock{registryMutex};
+  return registry[id];
+}
+} // namespace
+
+std::uint32_t World::registerComponent(std::size_t size,
+                                       std::size_t alignment) {
+  std::lock_guard lock{registryMutex};
+  if (registry.size() == maxComponents) {
+    throw std::runtime_error("too many component types");
+  }
+  registry.push_back({size, alignment});
+  return static_cast<std::uint32_t>(registry.size() - 1);
+}
+
+std::uint32_t World::archetypeFor(const Mask &mask) {
+  for (std::size_t i{}; i < m_archetypes.size(); i++) {
+    if (m_archetypes[i]->mask == mask) {
+      return static_cast<std::uint32_t>(i);
+    }
+  }
+  auto archetype = std::make_unique<Archetype>();
+  archetype->mask = mask;
+  std::size_t rowBytes = sizeof(Entity);
+  for (std::uint32_t id{}; id < maxComponents; id++) {
+    if (mask.test(id)) {
+      auto info = componentInfo(id);
+      archetype->sizes[id] = info.size;
+      rowBytes += info.size;
+    }
+  }
+  // 按行大小估计容量, 再扣掉对齐的填充直到放得下
+  for (auto capacity = chunkBytes / rowBytes; capacity > 0; capacity--) {
+    auto offset = capacity * sizeof(Entity);
+    for (std::uint32_t id{}; id < maxComponents; id++) {
+      if (mask.test(id)) {
+        auto alignment = componentInfo(id).alignment;
+        offset = (offset + alignment - 1) / alignment * alignment;
+        archetype->offsets[id] = offset;
+        offset += capacity * archetype->sizes[id];
+      }
+    }
+    if (offset <= chunkBytes) {
+      archetype->capacity = capacity;
+      break;
+    }
+  }
+  if (archetype->capacity == 0) {
+    throw std::runtime_error("components do not fit in a chunk");
+  }
+  m_archetypes.push_back(std::move(archetype));
+  return static_cast<std::uint32_t>(m_archetypes.size() - 1);
+}
+
+std::uint32_t World::pushRow(std::uint32_t index, Entity entity) {
+  auto &archetype = *m_archetypes[index];
+  if (archetype.size == archetype.chunks.size() * archetype.capacity) {
+    archetype.chunks.push_back({std::make_unique<ChunkData>()});
+  }
+  auto row = static_cast<std::uint32_t>(archetype.size++);
+  auto &chunk = archetype.chunks[row / archetype.capacity];
+  reinterpret_cast<Entity *>(chunk.data->bytes)[chunk.count++] = entity;
+  m_locations[entity] = {index, row};
+  return row;
+}
+
+void World::removeRow(std::uint32_t index, std::uint32_t row) {
+  auto &archetype = *m_archetypes[index];
+  auto last = static_cast<std::uint32_t>(archetype.size - 1);
+  auto &to = archetype.chunks[row / archetype.capacity];
+  auto &from = archetype.chunks[last / archetype.capacity];
+  if (row != last) {
+    auto toRow = row % archetype.capacity;
+    auto fromRow = last % archetype.capacity;
+    auto moved = entities(from)[fromRow];
+    reinterpret_cast<Entity *>(to.data->bytes)[toRow] = moved;
+    for (std::uint32_t id{}; id < maxComponents; id++) {
+      if (archetype.mask.test(id)) {
+        auto size = archetype.sizes[id];
+        std::memcpy(to.data->bytes + archetype.offsets[id] + toRow * size,
+                    from.data->bytes + archetype.offsets[id] + fromRow * size,
+                    size);
+      }
+    }
+    m_locations[moved].row = row;
+  }
+  archetype.size--;
+  // 空出的 chunk 直接释放
+  if (--from.count == 0) {
+    archetype.chunks.pop_back();
+  }
+}
+
+std::byte *World::component(Entity entity, std::uint32_t id) {
+  const auto &location = m_locations[entity];
+  auto &archetype = *m_archetypes[location.archetype];
+  auto &chunk = archetype.chunks[location.row / archetype.capacity];
+  return chunk.data->bytes + archetype.offsets[id] +
+         location.row % archetype.capacity * archetype.sizes[id];
+}
+
+Entity World::allocate(const Mask &mask) {
+  Entity entity;
+  if (m_free.empty()) {
+    entity = static_cast<Entity>(m_locations.size());
+    m_locations.emplace_back();
+  } else {
+    entity = m_free.back();
+    m_free.pop_back();
+  }
+  pushRow(archetypeFor(mask), entity);
+  m_alive++;
+  return entity;
+}
+
+void World::destroy(Entity entity) {
+  if (!alive(entity)) {
+    return;
+  }
+  auto location = m_locations[entity];
+  removeRow(location.archetype, location.row);
+  m_locations[entity] = {};
+  m_free.push_back(entity);
+  m_alive--;
+}
+
+void World::migrate(Entity entity, const Mask &mask) {
+  auto from = m_locations[entity];
+  auto shared = m_archetypes[from.archetype]->mask & mask;
+  auto to = archetypeFor(mask);
+  pushRow(to, entity);
+  for (std::uint32_t id{}; id < maxComponents; id++) {
+    if (shared.test(id)) {
+      // 新行已经写入 m_locations, 旧行需要手动定位
+      const auto &source = *m_archetypes[from.archetype];
+      const auto &chunk = source.chunks[from.row / source.capacity];
+      std::memcpy(component(entity, id),
+                  chunk.data->bytes + source.offsets[id] +
+                      from.row % source.capacity * source.sizes[id],
+                  source.sizes[id]);
+    }
+  }
+  removeRow(from.archetype, from.row);
+}
+} // namespace cg
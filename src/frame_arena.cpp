@@ -0,0 +1,143 @@
+#include <frame_arena.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<std::uint64_t> allocations{0};
+thread_local cg::FrameArena *currentArena{};
+
+void *countedAllocate(std::size_t size, std::size_t alignment) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  size = std::max<std::size_t>(size, 1);
+  void *p;
+  if (alignment <= alignof(std::max_align_t)) {
+    p = std::malloc(size);
+  } else {
+#if defined(_WIN32)
+    p = _aligned_malloc(size, alignment);
+#else
+    // aligned_alloc 要求大小是对齐的整数倍
+    p = std::aligned_alloc(alignment, (size + alignment - 1) & ~(alignment - 1));
+#endif
+  }
+  if (!p) {
+    throw std::bad_alloc{};
+  }
+  return p;
+}
+
+void countedFree(void *p, std::size_t alignment) noexcept {
+#if defined(_WIN32)
+  if (alignment > alignof(std::max_align_t)) {
+    _aligned_free(p);
+    return;
+  }
+#endif
+  (void)alignment;
+  std::free(p);
+}
+} // namespace
+
+// 替换全局的 operator new/delete, 在分配前计数
+void *operator new(std::size_t size) {
+  return countedAllocate(size, alignof(std::max_align_t));
+}
+void *operator new[](std::size_t size) {
+  return countedAllocate(size, alignof(std::max_align_t));
+}
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  return countedAllocate(size, static_cast<std::size_t>(alignment));
+}
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return countedAllocate(size, static_cast<std::size_t>(alignment));
+}
+void operator delete(void *p) noexcept {
+  countedFree(p, alignof(std::max_align_t));
+}
+void operator delete[](void *p) noexcept {
+  countedFree(p, alignof(std::max_align_t));
+}
+void operator delete(void *p, std::size_t) noexcept {
+  countedFree(p, alignof(std::max_align_t));
+}
+void operator delete[](void *p, std::size_t) noexcept {
+  countedFree(p, alignof(std::max_align_t));
+}
+void operator delete(void *p, std::align_val_t alignment) noexcept {
+  countedFree(p, static_cast<std::size_t>(alignment));
+}
+void operator delete[](void *p, std::align_val_t alignment) noexcept {
+  countedFree(p, static_cast<std::size_t>(alignment));
+}
+void operator delete(void *p, std::size_t, std::align_val_t alignment) noexcept {
+  countedFree(p, static_cast<std::size_t>(alignment));
+}
+void operator delete[](void *p, std::size_t,
+                       std::align_val_t alignment) noexcept {
+  countedFree(p, static_cast<std::size_t>(alignment));
+}
+
+namespace cg {
+std::uint64_t allocationCount() {
+  return allocations.load(std::memory_order_relaxed);
+}
+
+namespace {
+constexpr std::size_t blockAlignment = 64;
+} // namespace
+
+FrameArena::FrameArena(std::size_t bytes) { addBlock(bytes); }
+
+FrameArena::~FrameArena() {
+  for (const auto &block : m_blocks) {
+    ::operator delete(block.data, std::align_val_t{blockAlignment});
+  }
+}
+
+void FrameArena::addBlock(std::size_t bytes) {
+  auto *data = static_cast<std::byte *>(
+      ::operator new(bytes, std::align_val_t{blockAlignment}));
+  m_blocks.push_back({data, bytes});
+  m_offset = 0;
+}
+
+void *FrameArena::allocate(std::size_t bytes, std::size_t alignment) {
+  const auto &block = m_blocks.back();
+  auto base = reinterpret_cast<std::uintptr_t>(block.data);
+  auto offset =
+      ((base + m_offset + alignment - 1) & ~(alignment - 1)) - base;
+  if (offset + bytes > block.size) {
+    // 新块至少翻倍, 溢出只在用量增长的前几帧出现
+    addBlock(std::max(bytes + alignment, 2 * block.size));
+    return allocate(bytes, alignment);
+  }
+  m_offset = offset + bytes;
+  m_used += bytes;
+  return m_blocks.back().data + offset;
+}
+
+void FrameArena::reset() {
+  if (m_blocks.size() > 1) {
+    std::size_t total{};
+    for (const auto &block : m_blocks) {
+      total += block.size;
+      ::operator delete(block.data, std::align_val_t{blockAlignment});
+    }
+    m_blocks.clear();
+    addBlock(total);
+  }
+  m_offset = 0;
+  m_used = 0;
+}
+
+FrameArena *FrameArena::current() { return currentArena; }
+
+FrameArena::Scope::Scope(FrameArena &arena) : m_previous(currentArena) {
+  currentArena = &arena;
+}
+
+FrameArena::Scope::~Scope() { currentArena = m_previous; }
+} // namespace cg
@@ -0,0 +1,50 @@
+#include <gpu_query.hpp>
+
+namespace cg {
+QueryRing::QueryRing(GLenum target, std::size_t latency)
+    : m_target(target), m_queries(latency), m_pending(latency, false) {
+  glGenQueries(static_cast<GLsizei>(latency), m_queries.data());
+}
+
+QueryRing::~QueryRing() {
+  glDeleteQueries(static_cast<GLsizei>(m_queries.size()), m_queries.data());
+}
+
+void QueryRing::begin() {
+  // 即将复用的查询若还没读过, 先取走它的结果
+  result();
+  if (m_pending[m_next]) {
+    GLuint64 value{};
+    glGetQueryObjectui64v(m_queries[m_next], GL_QUERY_RESULT, &value);
+    m_last = value;
+    m_pending[m_next] = false;
+  }
+  glBeginQuery(m_target, m_queries[m_next]);
+}
+
+void QueryRing::end() {
+  glEndQuery(m_target);
+  m_pending[m_next] = true;
+  m_next = (m_next + 1) % m_queries.size();
+}
+
+std::uint64_t QueryRing::result() {
+  // 从最早提交的查询开始, 按提交顺序取回所有已完成的结果
+  for (std::size_t i{}; i < m_queries.size(); i++) {
+    auto slot = (m_next + i) % m_queries.size();
+    if (!m_pending[slot]) {
+      continue;
+    }
+    GLint available{};
+    glGetQueryObjectiv(m_queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+      break;
+    }
+    GLuint64 value{};
+    glGetQueryObjectui64v(m_queries[slot], GL_QUERY_RESULT, &value);
+    m_last = value;
+    m_pending[slot] = false;
+  }
+  return m_last;
+}
+} // namespace cg
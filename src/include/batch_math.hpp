@@ -0,0 +1,58 @@
+#pragma once
+#include <culling.hpp>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <span>
+
+namespace cg {
+/**
+ * @brief 法线矩阵 transpose(inverse(mat3(model)))
+ *
+ * 三阶矩阵的逆转置即伴随矩阵除以行列式, 列为各列两两的叉积.
+ */
+inline glm::mat3 normalMatrix(const glm::mat4 &model) {
+  glm::vec3 a{model[0]}, b{model[1]}, c{model[2]};
+  auto bc = glm::cross(b, c);
+  auto inverseDet = 1.0f / glm::dot(a, bc);
+  return {bc * inverseDet, glm::cross(c, a) * inverseDet,
+          glm::cross(a, b) * inverseDet};
+}
+
+/*
+ * 批量数学运算: 有 AVX2 时走 256 位路径, 否则 SSE, 余下的元素走标量路径.
+ * 直接读写 glm 的类型 (glm::mat4 为按列连续存放的 16 个 float),
+ * 输出的长度不短于输入; 输入与输出不能重叠.
+ */
+
+// 批量计算法线矩阵, 每次处理 8 (AVX2) 或 4 (SSE) 个矩阵
+void normalMatrices(std::span<const glm::mat4> models,
+                    std::span<glm::mat3> normals);
+
+// out[i] = lhs * rhs[i], 如 viewProjection * model
+void multiplyMatrices(const glm::mat4 &lhs, std::span<const glm::mat4> rhs,
+                      std::span<glm::mat4> out);
+// out[i] = lhs[i] * rhs[i], 如 parentWorld * local
+void multiplyMatrices(std::span<const glm::mat4> lhs,
+                      std::span<const glm::mat4> rhs, std::span<glm::mat4> out);
+
+// out[i] = matrix * vectors[i], 用于顶点变换和蒙皮
+void transformVectors(const glm::mat4 &matrix,
+                      std::span<const glm::vec4> vectors,
+                      std::span<glm::vec4> out);
+
+// out[i] = local[i].transformed(transforms[i])
+void transformBounds(std::span<const glm::mat4> transforms,
+                     std::span<const Aabb> local, std::span<Aabb> out);
+
+// outside[i] 为 1 表示第 i 个包围球完全位于平面 (xyz 为单位法线) 的背面
+void spheresOutsidePlane(const glm::vec4 &plane, const BoundsSoA &bounds,
+                         std::span<std::uint8_t> outside);
+
+// out[i] = translate(t[i]) * mat4_cast(r[i]) * scale(s[i]), 四元数须为单位长度
+void composeTransforms(std::span<const glm::vec3> translations,
+                       std::span<const glm::quat> rotations,
+                       std::span<const glm::vec3> scales,
+                       std::span<glm::mat4> out);
+} // namespace cg
@@ -0,0 +1,59 @@
+#pragma once
+#include <glad/glad.h>
+#include <render_graph.hpp>
+#include <shader.hpp>
+
+namespace cg {
+struct BloomSettings {
+  // 亮度超过 threshold 的部分产生泛光, knee 为软过渡的宽度
+  float threshold{1.0f}, knee{0.5f};
+  // 合成时叠加的强度 (按级数归一化之前)
+  float strength{0.6f};
+  // 最多的级数, 最小一级不小于 minSize 像素
+  int maxLevels{6};
+  int minSize{8};
+  // 上采样 3x3 tent 滤波的半径, 以较小一级的像素为单位
+  float upsampleRadius{1.0f};
+};
+
+/**
+ * @brief 逐级下采样/上采样的泛光 (Jimenez, Next Generation Post
+ * Processing in Call of Duty: Advanced Warfare)
+ *
+ * 第一次下采样从 HDR 场景取半分辨率并做亮度阈值, 之后每级减半, 都用
+ * 13 个双线性采样覆盖 6x6 像素; 第一级按 Karis 平均压制单个极亮像素的
+ * 闪烁. 再从最小一级开始用 3x3 tent 放大并叠加上一级的下采样结果.
+ * 泛光的半径随级数成倍增长, 而每个像素的采样数是固定的: 所有级加起来
+ * 不到半分辨率的 4/3 倍, 开销与半径基本无关.
+ * 各级是渲染图中依次减半的纹理 (GL 4.0 下无法只把纹理的某一级作为附件
+ * 交给渲染图管理), 显存与一条 mip 链相同.
+ */
+class Bloom {
+public:
+  Bloom(Shader &downsampleShader, Shader &upsampleShader, GLuint quadVAO,
+        const BloomSettings &settings = {});
+
+  // 声明各级的阶段, 返回半分辨率的泛光结果; 目标随动态分辨率缩放
+  RenderGraph::Resource addPasses(RenderGraph &graph,
+                                  RenderGraph::Resource hdr);
+  // 把结果绑定到 unit 并设置合成着色器 (quad.fs) 的泛光 uniform
+  void bind(const RenderGraph &graph, RenderGraph::Resource bloom,
+            const Shader &compositeShader, GLint unit) const;
+
+  // 最近一次 addPasses 的级数与每个场景像素的采样数
+  int levelCount() const { return m_levels; }
+  float samplesPerPixel() const;
+  const BloomSettings &settings() const { return m_settings; }
+
+private:
+  void downsample(const RenderGraph &graph, RenderGraph::Resource source,
+                  bool prefilter) const;
+  void upsample(const RenderGraph &graph, RenderGraph::Resource base,
+                RenderGraph::Resource coarse) const;
+
+  Shader &m_downsampleShader, &m_upsampleShader;
+  GLuint m_quadVAO;
+  BloomSettings m_settings;
+  int m_levels{};
+};
+} // namespace cg
@@ -0,0 +1,102 @@
+#pragma once
+#include <culling.hpp>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+namespace cg {
+struct Ray {
+  glm::vec3 origin{};
+  glm::vec3 direction{0.0f, 0.0f, -1.0f};
+  float maxDistance{std::numeric_limits<float>::max()};
+};
+
+// 射线与包围盒相交, 命中时 distance 为进入距离
+bool intersects(const Ray &ray, const Aabb &box, float *distance = nullptr);
+bool intersects(const Sphere &sphere, const Aabb &box);
+inline bool intersects(const Frustum &frustum, const Aabb &box) {
+  return frustum.intersects(box);
+}
+
+/**
+ * @brief 场景级包围体层次结构
+ *
+ * 静态内容用分箱 SAH 构建; 移动的对象通过 update 更新叶子并向上 refit,
+ * 不需要重建. 视锥, 球和射线查询共用 query 接口, 对象 id 即 build 时
+ * boxes 的下标.
+ */
+class Bvh {
+public:
+  static constexpr std::uint32_t invalid = ~std::uint32_t{};
+
+  void build(std::span<const Aabb> boxes);
+  // 对象移动后更新其包围盒, 沿父节点向上 refit 直到包围盒不再变化
+  void update(std::uint32_t object, const Aabb &box);
+
+  // 对与 shape 相交的每个对象调用 fn(object)
+  template <typename Shape, typename Fn>
+  void query(const Shape &shape, Fn &&fn) const;
+  // 最近的被射线击中的对象, 没有命中时返回 invalid
+  std::uint32_t raycast(const Ray &ray, float *distance = nullptr) const;
+
+  std::size_t size() const { return m_boxes.size(); }
+  // 最深叶子的深度, 根为 0
+  int depth() const { return m_depth; }
+  const Aabb &bounds(std::uint32_t object) const { return m_boxes[object]; }
+
+private:
+  // count 为 0 表示内部节点, start 为左孩子下标 (右孩子紧随其后);
+  // 否则为叶子, start 为 m_objects 中的起始位置
+  struct Node {
+    Aabb box;
+    std::uint32_t start;
+    std::uint32_t count;
+    std::uint32_t parent;
+  };
+  static constexpr std::uint32_t maxLeafSize = 4;
+  // 超过该深度改用中位数划分, 每层对象数至少减半, 32 位的对象数
+  // 再过 30 层一定成为叶子; 遍历栈最多存放 深度 + 1 个节点
+  static constexpr int maxSahDepth = 40;
+  static constexpr int stackSize = maxSahDepth + 32;
+
+  void subdivide(std::uint32_t node, int depth);
+  Aabb leafBounds(const Node &node) const;
+
+  std::vector<Node> m_nodes;
+  std::vector<Aabb> m_boxes;
+  std::vector<glm::vec3> m_centroids;
+  std::vector<std::uint32_t> m_objects;
+  std::vector<std::uint32_t> m_leafOf;
+  int m_depth{};
+};
+
+template <typename Shape, typename Fn>
+void Bvh::query(const Shape &shape, Fn &&fn) const {
+  if (m_nodes.empty()) {
+    return;
+  }
+  // build 保证 m_depth < stackSize, 遍历时不必检查栈的边界
+  std::uint32_t stack[stackSize];
+  int top{};
+  stack[top++] = 0;
+  while (top > 0) {
+    const auto &node = m_nodes[stack[--top]];
+    if (!intersects(shape, node.box)) {
+      continue;
+    }
+    if (node.count > 0) {
+      for (auto i = node.start; i < node.start + node.count; i++) {
+        if (intersects(shape, m_boxes[m_objects[i]])) {
+          fn(m_objects[i]);
+        }
+      }
+    } else {
+      stack[top++] = node.start;
+      stack[top++] = node.start + 1;
+    }
+  }
+}
+} // namespace cg
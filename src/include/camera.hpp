@@ -2,6 +2,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+
+#include <culling.hpp>
 namespace cg {
 class Camera {
 private:
@@ -23,6 +25,10 @@ public:
   glm::mat4 lookAt() {
     return glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
   }
+  // 当前视角下的视锥体, 用于剔除
+  Frustum frustum(const glm::mat4 &projection) {
+    return Frustum::fromMatrix(projection * lookAt());
+  }
   glm::vec3 cameraPos{};
   glm::vec3 cameraFront;
   glm::vec3 cameraUp{};
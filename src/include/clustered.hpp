@@ -0,0 +1,99 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <shader.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace cg {
+/**
+ * @brief 参与分簇的动态光源, 字段与 multi_lights.frag 中的点光源一致
+ * outerCutOff 小于 -1 时为点光源, 否则为聚光 (cutOff/outerCutOff 为余弦)
+ */
+struct ClusterLight {
+  glm::vec3 position{};
+  float radius{}; // 影响范围, 见 lightRange
+  glm::vec3 ambient{};
+  glm::vec3 diffuse{};
+  glm::vec3 specular{};
+  float constant{1.0f}, linear{.09f}, quadratic{.032f};
+  glm::vec3 direction{0.0f, 0.0f, -1.0f};
+  float cutOff{-2.0f}, outerCutOff{-2.0f};
+  int shadowSlot{-1}; // LocalShadowMaps 中的立方体阴影序号, -1 为无阴影
+};
+
+// 衰减后亮度降到 1/256 的距离, 作为分簇时的光源半径
+float lightRange(const ClusterLight &light);
+
+/**
+ * @brief 分簇前向渲染的光源网格 (froxel)
+ *
+ * 屏幕分成 tilesX * tilesY 个块, 视深按指数划分为 slices 层.
+ * 每帧在 CPU 上把光源变换到视空间, 对其覆盖的深度层内的簇做
+ * 球-包围盒以及圆锥-包围球测试 (SSE/AVX2), 再按簇做计数排序.
+ * GL 4.0 没有 SSBO, 结果上传到三个缓冲纹理:
+ *   lightData    RGBA32F, 每个光源 lightTexels 个纹素 (世界空间),
+ *                最后一个纹素的 z 为阴影序号
+ *   clusterGrid  RG32UI,  每个簇 (起始下标, 光源数)
+ *   lightIndices R32UI,   按簇连续存放的光源下标
+ */
+class LightClusters {
+public:
+  static constexpr int tilesX = 16, tilesY = 9, slices = 24;
+  static constexpr int clusterCount = tilesX * tilesY * slices;
+  static constexpr int lightTexels = 6;
+
+  LightClusters();
+  ~LightClusters();
+  LightClusters(const LightClusters &) = delete;
+  LightClusters &operator=(const LightClusters &) = delete;
+
+  // 投影改变时重建各簇的视空间包围体
+  void setProjection(const glm::mat4 &projection, float zNear, float zFar);
+  void build(std::span<const ClusterLight> lights, const glm::mat4 &view);
+  // 着色器中 std140 的 Clusters 块, 屏幕分块按 screenSize 划分
+  struct Block {
+    glm::ivec3 dims;
+    int padding;
+    glm::vec2 tileSize;
+    float near;
+    float sliceScale;
+  };
+  Block block(const glm::vec2 &screenSize) const;
+  // 三个缓冲纹理依次绑定到 firstUnit 起的纹理单元
+  void bind(const cg::Shader &shader, int firstUnit) const;
+
+  std::size_t lightCount() const { return m_lightCount; }
+  std::size_t indexCount() const { return m_indices.size(); }
+  double buildMicroseconds() const { return m_buildMicroseconds; }
+  // 光源数据缓冲纹理, 延迟渲染的光源体积直接按实例号读取
+  GLuint lightDataTexture() const { return m_textures[0]; }
+
+private:
+  // 每层 tilesX * tilesY 个簇按 SoA 存放
+  struct Slice {
+    std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+    std::vector<float> centerX, centerY, centerZ, radius;
+  };
+  int sliceOf(float viewDepth) const;
+
+  glm::mat4 m_projection{0.0f};
+  float m_near{}, m_far{}, m_sliceScale{};
+  std::vector<Slice> m_slices;
+
+  std::size_t m_lightCount{};
+  std::vector<glm::vec4> m_lightTexels;
+  // 光源按块并行分配到簇, 每块一组 (簇, 光源) 命中, 按块顺序合并
+  struct Hits {
+    std::vector<std::uint32_t> cluster, light;
+  };
+  std::vector<Hits> m_blockHits;
+  std::vector<std::uint32_t> m_grid; // 每个簇两个 uint
+  std::vector<std::uint32_t> m_indices;
+  double m_buildMicroseconds{};
+
+  GLuint m_buffers[3]{}, m_textures[3]{};
+};
+} // namespace cg
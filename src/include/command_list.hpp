@@ -0,0 +1,136 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <vector>
+
+namespace cg {
+/**
+ * @brief CPU 端的绘制命令列表
+ *
+ * 录制只往字节数组里追加紧凑的命令 (1 字节操作码 + 参数), 不调用 GL,
+ * 因此可以在任意线程进行, 多个线程各录一个列表. execute 必须在 GL 线程
+ * 调用, 按顺序解释执行, 并跳过与当前状态相同的程序, VAO 和纹理单元
+ * 切换; 执行完后活动纹理单元恢复为 0.
+ *
+ * uniform 以 location 表示, 需要事先在 GL 线程用 glGetUniformLocation
+ * 查好; location 为 -1 的命令在录制时直接丢弃.
+ */
+class CommandList {
+public:
+  enum class Op : std::uint8_t {
+    UseProgram,
+    BindVertexArray,
+    BindTexture,
+    BindBufferRange,
+    Uniform1i,
+    Uniform1f,
+    Uniform3f,
+    Uniform4f,
+    UniformMatrix3f,
+    UniformMatrix4f,
+    DrawArrays,
+    DrawArraysInstanced,
+    DrawElements,
+    DrawElementsInstanced,
+  };
+
+  void useProgram(GLuint program) { write(Op::UseProgram, program); }
+  void bindVertexArray(GLuint vao) { write(Op::BindVertexArray, vao); }
+  // 绑定到纹理单元 unit
+  void bindTexture(GLenum target, GLuint unit, GLuint texture) {
+    write(Op::BindTexture, target, unit, texture);
+  }
+  // 如把 uniform 块的一段绑定到 GL_UNIFORM_BUFFER 的 index 号绑定点
+  void bindBufferRange(GLenum target, GLuint index, GLuint buffer,
+                       GLintptr offset, GLsizeiptr size) {
+    write(Op::BindBufferRange, target, index, buffer, offset, size);
+  }
+
+  void setInt(GLint location, GLint value) {
+    if (location >= 0) {
+      write(Op::Uniform1i, location, value);
+    }
+  }
+  void setFloat(GLint location, float value) {
+    if (location >= 0) {
+      write(Op::Uniform1f, location, value);
+    }
+  }
+  void setVec3(GLint location, const glm::vec3 &value) {
+    if (location >= 0) {
+      write(Op::Uniform3f, location, value);
+    }
+  }
+  void setVec4(GLint location, const glm::vec4 &value) {
+    if (location >= 0) {
+      write(Op::Uniform4f, location, value);
+    }
+  }
+  void setMat3(GLint location, const glm::mat3 &value) {
+    if (location >= 0) {
+      write(Op::UniformMatrix3f, location, value);
+    }
+  }
+  void setMat4(GLint location, const glm::mat4 &value) {
+    if (location >= 0) {
+      write(Op::UniformMatrix4f, location, value);
+    }
+  }
+
+  void drawArrays(GLenum mode, GLint first, GLsizei count) {
+    write(Op::DrawArrays, mode, first, count);
+  }
+  void drawArraysInstanced(GLenum mode, GLint first, GLsizei count,
+                           GLsizei instances) {
+    write(Op::DrawArraysInstanced, mode, first, count, instances);
+  }
+  // offset 为索引缓冲中的字节偏移
+  void drawElements(GLenum mode, GLsizei count, GLenum type,
+                    std::size_t offset = 0) {
+    write(Op::DrawElements, mode, count, type, offset);
+  }
+  void drawElementsInstanced(GLenum mode, GLsizei count, GLenum type,
+                             std::size_t offset, GLsizei instances) {
+    write(Op::DrawElementsInstanced, mode, count, type, offset, instances);
+  }
+
+  // 在 GL 线程上依次执行所有命令
+  void execute() const;
+  // 按顺序执行多个列表, 状态跟踪跨列表保持
+  static void execute(std::span<const CommandList> lists);
+
+  void clear() {
+    m_bytes.clear();
+    m_commands = 0;
+  }
+  bool empty() const { return m_commands == 0; }
+  std::size_t commandCount() const { return m_commands; }
+  std::size_t byteSize() const { return m_bytes.size(); }
+
+private:
+  struct State {
+    GLuint program{~GLuint{}};
+    GLuint vao{~GLuint{}};
+    GLuint unit{~GLuint{}};
+  };
+  void execute(State &state) const;
+
+  template <typename... Args> void write(Op op, const Args &...args) {
+    auto offset = m_bytes.size();
+    m_bytes.resize(offset + sizeof(Op) + (sizeof(Args) + ... + 0));
+    auto *out = m_bytes.data() + offset;
+    std::memcpy(out, &op, sizeof(Op));
+    out += sizeof(Op);
+    ((std::memcpy(out, &args, sizeof(Args)), out += sizeof(Args)), ...);
+    m_commands++;
+  }
+
+  std::vector<std::byte> m_bytes;
+  std::size_t m_commands{};
+};
+} // namespace cg
@@ -0,0 +1,80 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace cg {
+/**
+ * @brief 轴对齐包围盒
+ */
+struct Aabb {
+  glm::vec3 min{std::numeric_limits<float>::max()};
+  glm::vec3 max{std::numeric_limits<float>::lowest()};
+
+  void expand(const glm::vec3 &point) {
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+  }
+  glm::vec3 center() const { return (min + max) * 0.5f; }
+  glm::vec3 extents() const { return (max - min) * 0.5f; }
+  // 变换后的包围盒 (仍然轴对齐, 可能更松)
+  Aabb transformed(const glm::mat4 &transform) const;
+};
+
+/**
+ * @brief 包围球, 圆心取包围盒中心, 因此可以和 Aabb 共用一个中心
+ */
+struct Sphere {
+  glm::vec3 center{};
+  float radius{};
+};
+
+/**
+ * @brief 视锥体的六个平面 (xyz 为指向内侧的单位法线, w 为距离)
+ */
+struct Frustum {
+  std::array<glm::vec4, 6> planes;
+
+  // 从 projection * view 提取平面 (Gribb-Hartmann)
+  static Frustum fromMatrix(const glm::mat4 &viewProjection);
+  bool intersects(const Sphere &sphere) const;
+  bool intersects(const Aabb &box) const;
+};
+
+/**
+ * @brief SoA 布局的包围体, 便于用 SSE/AVX2 一次测试多个对象
+ */
+struct BoundsSoA {
+  std::vector<float> centerX, centerY, centerZ;
+  std::vector<float> extentX, extentY, extentZ;
+  std::vector<float> radius;
+
+  // radius 为以包围盒中心为圆心的包围球半径, 小于 0 时取半对角线
+  void push(const Aabb &box, float sphereRadius = -1.0f);
+  void set(std::size_t index, const Aabb &box, float sphereRadius = -1.0f);
+  void clear();
+  std::size_t size() const { return centerX.size(); }
+};
+
+struct CullStats {
+  std::size_t tested{};
+  std::size_t culled{};
+  double microseconds{};
+  // 每一万个对象的耗时 (微秒)
+  double perTenThousand() const {
+    return tested ? microseconds * 10000.0 / static_cast<double>(tested) : 0.0;
+  }
+};
+
+/**
+ * @brief 批量视锥剔除, visible[i] 为 1 表示第 i 个对象可见
+ *
+ * 包围盒或包围球任一完全位于某个平面外侧即剔除, 即对每个平面取两者
+ * 投影半径的较小值. 对象数很多时按线程切分.
+ */
+CullStats cullBounds(const Frustum &frustum, const BoundsSoA &bounds,
+                     std::vector<std::uint8_t> &visible);
+} // namespace cg
@@ -0,0 +1,43 @@
+#pragma once
+#include <glad/glad.h>
+#include <shader.hpp>
+
+#include <array>
+
+namespace cg {
+/**
+ * @brief 延迟着色: G-buffer 以及实例化的光源体积
+ *
+ * G-buffer 三个颜色目标 (由渲染图分配, 格式见 gBufferFormats):
+ *   0 gPosition   RGBA16F 世界空间位置, w 为 1 表示有几何体
+ *   1 gNormal     RGB16F  世界空间法线
+ *   2 gAlbedoSpec RGBA8   漫反射颜色, a 为镜面强度
+ * 深度模板与场景颜色共用, 之后的前向阶段 (草, 窗户) 可以直接做深度测试.
+ * 光照阶段先画一个全屏四边形计算定向光和手电筒, 再用一次实例化绘制
+ * 画出所有光源的包围球, 光源参数按 gl_InstanceID 从光源缓冲纹理读取.
+ */
+class DeferredRenderer {
+public:
+  static constexpr std::array<GLenum, 3> gBufferFormats{GL_RGBA16F, GL_RGB16F,
+                                                        GL_RGBA8};
+
+  DeferredRenderer();
+  ~DeferredRenderer();
+  DeferredRenderer(const DeferredRenderer &) = delete;
+  DeferredRenderer &operator=(const DeferredRenderer &) = delete;
+
+  // 在已绑定的 G-buffer 上清空颜色目标 (深度模板由场景阶段负责清空)
+  void beginGeometry();
+  // 光照结果以 (ONE, ONE) 叠加到当前绑定的帧缓冲,
+  // 两个着色器的其余 uniform 由调用者设置
+  void light(const std::array<GLuint, 3> &gBuffer, cg::Shader &ambientShader,
+             GLuint quadVAO, cg::Shader &volumeShader, GLuint lightData,
+             GLsizei lightCount);
+
+private:
+  void bindGBuffer(cg::Shader &shader);
+
+  GLuint m_sphereVAO{}, m_sphereVBO{}, m_sphereEBO{};
+  GLsizei m_sphereIndexCount{};
+};
+} // namespace cg
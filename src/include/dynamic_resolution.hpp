@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+
+namespace cg {
+struct ResolutionSettings {
+  // 希望 GPU 每帧花费的时间
+  float targetMilliseconds{16.0f};
+  float minScale{0.5f}, maxScale{1.0f};
+  // 帧时间低于目标的这个比例才提高分辨率, 避免在目标附近来回跳
+  float raiseThreshold{0.85f};
+  // 每次调整最多改变的比例
+  float maxStep{0.1f};
+  // 两次调整之间至少间隔的帧数, 让计时查询先反映出上一次调整的效果
+  std::uint32_t cooldownFrames{8};
+  // 帧时间的指数平滑系数
+  float smoothing{0.2f};
+};
+
+/**
+ * @brief 动态分辨率控制器: 根据 GPU 帧时间调整渲染比例
+ *
+ * 像素着色的开销近似与像素数 (比例的平方) 成正比, 所以按
+ * sqrt(目标时间 / 平滑后的帧时间) 缩放比例. 帧时间落在
+ * [raiseThreshold * target, target] 之内时不调整, 越界时瞄准区间中点,
+ * 每次调整限制在 maxStep 以内.
+ * 计时结果来自几帧之前, 调整后等待 cooldownFrames 帧并重新开始平滑.
+ */
+class ResolutionController {
+public:
+  explicit ResolutionController(const ResolutionSettings &settings = {});
+
+  // 输入最近一次完成的 GPU 帧时间 (毫秒, 没有结果时为 0), 返回新的比例
+  float update(float gpuMilliseconds);
+  // 回到最大比例并清空历史, 例如切换渲染路径之后
+  void reset();
+
+  float scale() const { return m_scale; }
+  float smoothedMilliseconds() const { return m_smoothed; }
+  const ResolutionSettings &settings() const { return m_settings; }
+
+private:
+  ResolutionSettings m_settings;
+  float m_scale;
+  float m_smoothed{};
+  std::uint32_t m_cooldown{};
+};
+} // namespace cg
@@ -0,0 +1,208 @@
+#pragma once
+#include <frame_arena.hpp>
+#include <jobs.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace cg {
+using Entity = std::uint32_t;
+
+/**
+ * @brief 基于 archetype 的实体组件系统
+ *
+ * 组件组合相同的实体属于同一个 archetype, 按固定大小的 chunk 存放;
+ * chunk 内先是实体数组, 然后每个组件一段连续数组 (SoA), 查询按 chunk
+ * 线性遍历. 行始终紧凑: 删除时用最后一行填补, 所以只有最后一个 chunk
+ * 可能不满.
+ *
+ * 组件须为可平凡复制的类型, 增删组件时整行复制到新的 archetype.
+ * 遍历期间不能创建/销毁实体或增删组件, 但可以修改组件的值.
+ */
+class World {
+public:
+  static constexpr std::size_t maxComponents = 64;
+  static constexpr std::size_t chunkBytes = 16 * 1024;
+  // 实体总数低于此值时 parallelEach 退化为单线程
+  static constexpr std::size_t parallelThreshold = 4096;
+  static constexpr Entity invalid = ~Entity{};
+  using Mask = std::bitset<maxComponents>;
+
+  // 每个组件类型首次使用时分配一个 id
+  template <typename T> static std::uint32_t componentId() {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "components must be trivially copyable");
+    static const auto id = registerComponent(sizeof(T), alignof(T));
+    return id;
+  }
+  template <typename... Cs> static Mask maskOf() {
+    Mask mask;
+    (mask.set(componentId<Cs>()), ...);
+    return mask;
+  }
+
+  World() = default;
+  World(const World &) = delete;
+  World &operator=(const World &) = delete;
+
+  template <typename... Cs> Entity create(const Cs &...components) {
+    auto entity = allocate(maskOf<Cs...>());
+    ((get<Cs>(entity) = components), ...);
+    return entity;
+  }
+  void destroy(Entity entity);
+  bool alive(Entity entity) const {
+    return entity < m_locations.size() &&
+           m_locations[entity].archetype != invalid;
+  }
+
+  template <typename T> bool has(Entity entity) const {
+    return alive(entity) && m_archetypes[m_locations[entity].archetype]
+                                ->mask.test(componentId<T>());
+  }
+  // 实体必须拥有该组件
+  template <typename T> T &get(Entity entity) {
+    return *reinterpret_cast<T *>(component(entity, componentId<T>()));
+  }
+  // 已有该组件时只覆盖其值
+  template <typename T> void add(Entity entity, const T &value) {
+    if (!has<T>(entity)) {
+      migrate(entity, m_archetypes[m_locations[entity].archetype]->mask |
+                          maskOf<T>());
+    }
+    get<T>(entity) = value;
+  }
+  template <typename T> void remove(Entity entity) {
+    if (has<T>(entity)) {
+      migrate(entity, m_archetypes[m_locations[entity].archetype]->mask &
+                          ~maskOf<T>());
+    }
+  }
+
+  /**
+   * @brief 按 chunk 遍历拥有 Cs... 的实体
+   * fn(count, entities, Cs *...), 各数组长度均为 count
+   */
+  template <typename... Cs, typename Fn> void eachChunk(Fn &&fn) {
+    auto mask = maskOf<Cs...>();
+    for (auto &archetype : m_archetypes) {
+      if ((archetype->mask & mask) != mask) {
+        continue;
+      }
+      for (auto &chunk : archetype->chunks) {
+        fn(chunk.count, entities(chunk),
+           column<Cs>(*archetype, chunk)...);
+      }
+    }
+  }
+  // fn(Cs &...) 或 fn(Entity, Cs &...)
+  template <typename... Cs, typename Fn> void each(Fn &&fn) {
+    eachChunk<Cs...>([&](std::size_t count, const Entity *ids, Cs *...cs) {
+      for (std::size_t i{}; i < count; i++) {
+        invoke(fn, ids[i], cs[i]...);
+      }
+    });
+  }
+  /**
+   * @brief 与 each 相同, 但每个匹配的 chunk 作为一个作业交给作业系统
+   * fn 会被并发调用, 只能修改传入的组件
+   */
+  template <typename... Cs, typename Fn> void parallelEach(Fn &&fn) {
+    auto mask = maskOf<Cs...>();
+    // 每帧调用, 匹配的 chunk 列表放在帧内存中
+    FrameVector<std::pair<Archetype *, Chunk *>> chunks;
+    std::size_t total{};
+    for (auto &archetype : m_archetypes) {
+      if ((archetype->mask & mask) == mask) {
+        for (auto &chunk : archetype->chunks) {
+          chunks.emplace_back(archetype.get(), &chunk);
+        }
+        total += archetype->size;
+      }
+    }
+    auto run = [&](std::size_t begin, std::size_t end) {
+      for (auto k = begin; k < end; k++) {
+        auto &[archetype, chunk] = chunks[k];
+        auto *ids = entities(*chunk);
+        auto columns = std::make_tuple(column<Cs>(*archetype, *chunk)...);
+        for (std::size_t i{}; i < chunk->count; i++) {
+          std::apply([&](Cs *...cs) { invoke(fn, ids[i], cs[i]...); },
+                     columns);
+        }
+      }
+    };
+    if (total < parallelThreshold) {
+      run(0, chunks.size());
+      return;
+    }
+    JobSystem::shared().parallelFor(0, chunks.size(), 1, run);
+  }
+
+  // 存活的实体数
+  std::size_t size() const { return m_alive; }
+  std::size_t archetypeCount() const { return m_archetypes.size(); }
+
+private:
+  struct alignas(64) ChunkData {
+    std::byte bytes[chunkBytes];
+  };
+  struct Chunk {
+    std::unique_ptr<ChunkData> data;
+    std::size_t count{};
+  };
+  struct Archetype {
+    Mask mask;
+    // 组件 id 到该组件数组在 chunk 内偏移的映射, 不含该组件时无意义
+    std::array<std::size_t, maxComponents> offsets{};
+    std::array<std::size_t, maxComponents> sizes{};
+    std::size_t capacity{};
+    std::size_t size{};
+    std::vector<Chunk> chunks;
+  };
+  struct Location {
+    std::uint32_t archetype{invalid};
+    std::uint32_t row{};
+  };
+
+  static std::uint32_t registerComponent(std::size_t size,
+                                         std::size_t alignment);
+
+  template <typename T> static T *column(Archetype &archetype, Chunk &chunk) {
+    return reinterpret_cast<T *>(chunk.data->bytes +
+                                 archetype.offsets[componentId<T>()]);
+  }
+  static const Entity *entities(const Chunk &chunk) {
+    return reinterpret_cast<const Entity *>(chunk.data->bytes);
+  }
+  template <typename Fn, typename... Cs>
+  static void invoke(Fn &fn, Entity entity, Cs &...components) {
+    if constexpr (std::is_invocable_v<Fn &, Entity, Cs &...>) {
+      fn(entity, components...);
+    } else {
+      fn(components...);
+    }
+  }
+
+  std::uint32_t archetypeFor(const Mask &mask);
+  // 在 archetype 末尾追加一行, 返回行号; 组件的值未初始化
+  std::uint32_t pushRow(std::uint32_t archetype, Entity entity);
+  // 用最后一行填补被删除的行
+  void removeRow(std::uint32_t archetype, std::uint32_t row);
+  std::byte *component(Entity entity, std::uint32_t id);
+  Entity allocate(const Mask &mask);
+  // 把实体搬到 mask 对应的 archetype, 共有的组件保持原值
+  void migrate(Entity entity, const Mask &mask);
+
+  std::vector<std::unique_ptr<Archetype>> m_archetypes;
+  std::vector<Location> m_locations;
+  std::vector<Entity> m_free;
+  std::size_t m_alive{};
+};
+} // namespace cg
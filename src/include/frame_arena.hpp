@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cg {
+/**
+ * @brief 进程内 operator new 的累计调用次数 (所有线程)
+ * 两帧之间的差值即为这一帧的堆分配次数
+ */
+std::uint64_t allocationCount();
+
+/**
+ * @brief 每帧重置的线性分配器
+ *
+ * 分配只移动指针, 释放是空操作, reset 时一次性回收本帧的全部内存.
+ * 一帧用量超过当前块时向系统申请新块, 下一次 reset 把所有块合并为
+ * 一个足够大的块, 因此稳定之后每帧都不再触发堆分配.
+ * 不是线程安全的: 每个线程使用自己的实例, 通过 Scope 设为当前线程的
+ * 帧内存, FrameAllocator 默认从中分配.
+ */
+class FrameArena {
+public:
+  explicit FrameArena(std::size_t bytes = 256 * 1024);
+  ~FrameArena();
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  // alignment 须为 2 的幂
+  void *allocate(std::size_t bytes, std::size_t alignment);
+  void reset();
+
+  // 本帧已分配的字节数, 以及不再申请新块时的容量
+  std::size_t used() const { return m_used; }
+  std::size_t capacity() const { return m_blocks.front().size; }
+
+  // 当前线程的帧内存, 没有时为空
+  static FrameArena *current();
+  // 在作用域内把 arena 设为当前线程的帧内存
+  class Scope {
+  public:
+    explicit Scope(FrameArena &arena);
+    ~Scope();
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    FrameArena *m_previous;
+  };
+
+private:
+  struct Block {
+    std::byte *data;
+    std::size_t size;
+  };
+  void addBlock(std::size_t bytes);
+
+  std::vector<Block> m_blocks;
+  std::size_t m_offset{};
+  std::size_t m_used{};
+};
+
+/**
+ * @brief 从帧内存分配的标准分配器
+ * 构造时取当前线程的 FrameArena, 没有时退回到 operator new;
+ * 容器必须在对应的 reset 之前销毁
+ */
+template <typename T> class FrameAllocator {
+public:
+  using value_type = T;
+
+  FrameAllocator() noexcept : m_arena(FrameArena::current()) {}
+  explicit FrameAllocator(FrameArena *arena) noexcept : m_arena(arena) {}
+  template <typename U>
+  FrameAllocator(const FrameAllocator<U> &other) noexcept
+      : m_arena(other.arena()) {}
+
+  T *allocate(std::size_t n) {
+    if (m_arena) {
+      return static_cast<T *>(m_arena->allocate(n * sizeof(T), alignof(T)));
+    }
+    return static_cast<T *>(::operator new(n * sizeof(T)));
+  }
+  void deallocate(T *p, std::size_t) noexcept {
+    if (!m_arena) {
+      ::operator delete(p);
+    }
+  }
+  FrameArena *arena() const noexcept { return m_arena; }
+
+  template <typename U>
+  bool operator==(const FrameAllocator<U> &other) const noexcept {
+    return m_arena == other.arena();
+  }
+
+private:
+  FrameArena *m_arena;
+};
+
+template <typename T> using FrameVector = std::vector<T, FrameAllocator<T>>;
+using FrameString =
+    std::basic_string<char, std::char_traits<char>, FrameAllocator<char>>;
+} // namespace cg
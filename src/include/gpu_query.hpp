@@ -0,0 +1,33 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace cg {
+/**
+ * @brief 环形排列的 GPU 查询对象, 读取几帧之前的结果而不阻塞管线
+ *
+ * 每帧 begin/end 一次, 使用 latency 个查询对象轮流记录.
+ * target 为 GL_SAMPLES_PASSED, GL_TIME_ELAPSED 等.
+ */
+class QueryRing {
+public:
+  explicit QueryRing(GLenum target, std::size_t latency = 3);
+  ~QueryRing();
+  QueryRing(const QueryRing &) = delete;
+  QueryRing &operator=(const QueryRing &) = delete;
+
+  void begin();
+  void end();
+  // 取回已经完成的查询, 返回最近一次可用的结果 (尚无结果时为 0)
+  std::uint64_t result();
+
+private:
+  GLenum m_target;
+  std::vector<GLuint> m_queries;
+  std::vector<bool> m_pending;
+  std::size_t m_next{};
+  std::uint64_t m_last{};
+};
+} // namespace cg
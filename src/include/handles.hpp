@@ -0,0 +1,126 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace cg {
+/**
+ * @brief 带类型的 32 位代际句柄: 低 20 位为槽位, 高 12 位为代数
+ * 不同 Tag 的句柄不能互相赋值; 值为 0 的句柄无效, 可以直接打包进排序键
+ */
+template <typename Tag> class Handle {
+public:
+  static constexpr std::uint32_t indexBits = 20;
+  static constexpr std::uint32_t indexMask = (1u << indexBits) - 1;
+  static constexpr std::uint32_t generationMask = (1u << (32 - indexBits)) - 1;
+
+  constexpr Handle() = default;
+  constexpr Handle(std::uint32_t index, std::uint32_t generation)
+      : m_value((generation << indexBits) | (index & indexMask)) {}
+  static constexpr Handle fromValue(std::uint32_t value) {
+    Handle handle;
+    handle.m_value = value;
+    return handle;
+  }
+
+  constexpr std::uint32_t index() const { return m_value & indexMask; }
+  constexpr std::uint32_t generation() const { return m_value >> indexBits; }
+  constexpr std::uint32_t value() const { return m_value; }
+  constexpr explicit operator bool() const { return m_value != 0; }
+  constexpr bool operator==(const Handle &) const = default;
+
+private:
+  std::uint32_t m_value{};
+};
+
+/**
+ * @brief 以代际句柄访问的紧凑对象池
+ *
+ * 对象连续存放, 删除时用最后一个填补; 槽位记录代数和对象位置, 查找为
+ * O(1). 删除后槽位代数加一进入空闲链表, 之后创建的对象复用槽位, 旧句柄
+ * 因代数不符而失效 (get 返回空). 代数只有 12 位, 同一槽位被复用 4095 次
+ * 之后旧句柄才可能重新匹配.
+ */
+template <typename T, typename Tag = T> class HandlePool {
+public:
+  using HandleType = Handle<Tag>;
+
+  template <typename... Args> HandleType emplace(Args &&...args) {
+    std::uint32_t slot;
+    if (!m_free.empty()) {
+      slot = m_free.back();
+      m_free.pop_back();
+    } else {
+      if (m_slots.size() > HandleType::indexMask) {
+        throw std::runtime_error("handle pool is full");
+      }
+      slot = static_cast<std::uint32_t>(m_slots.size());
+      m_slots.push_back({});
+    }
+    m_slots[slot].dense = static_cast<std::uint32_t>(m_items.size());
+    m_items.push_back(T{std::forward<Args>(args)...});
+    m_owners.push_back(slot);
+    return {slot, m_slots[slot].generation};
+  }
+
+  bool valid(HandleType handle) const {
+    return handle && handle.index() < m_slots.size() &&
+           m_slots[handle.index()].generation == handle.generation();
+  }
+  // 句柄已失效时返回空
+  T *get(HandleType handle) {
+    return valid(handle) ? &m_items[m_slots[handle.index()].dense] : nullptr;
+  }
+  const T *get(HandleType handle) const {
+    return valid(handle) ? &m_items[m_slots[handle.index()].dense] : nullptr;
+  }
+
+  // 句柄失效时返回 false
+  bool erase(HandleType handle) {
+    if (!valid(handle)) {
+      return false;
+    }
+    auto &slot = m_slots[handle.index()];
+    auto last = static_cast<std::uint32_t>(m_items.size() - 1);
+    if (slot.dense != last) {
+      m_items[slot.dense] = std::move(m_items[last]);
+      m_owners[slot.dense] = m_owners[last];
+      m_slots[m_owners[slot.dense]].dense = slot.dense;
+    }
+    m_items.pop_back();
+    m_owners.pop_back();
+    // 代数跳过 0, 保证句柄值不为 0
+    slot.generation = (slot.generation & HandleType::generationMask) ==
+                              HandleType::generationMask
+                          ? 1
+                          : slot.generation + 1;
+    m_free.push_back(handle.index());
+    return true;
+  }
+
+  std::size_t size() const { return m_items.size(); }
+  bool empty() const { return m_items.empty(); }
+  // 按存放顺序遍历, 删除会改变顺序
+  auto begin() { return m_items.begin(); }
+  auto end() { return m_items.end(); }
+  auto begin() const { return m_items.begin(); }
+  auto end() const { return m_items.end(); }
+  // 第 i 个对象的句柄
+  HandleType handleAt(std::size_t i) const {
+    auto slot = m_owners[i];
+    return {slot, m_slots[slot].generation};
+  }
+
+private:
+  struct Slot {
+    std::uint32_t generation{1};
+    std::uint32_t dense{};
+  };
+  std::vector<Slot> m_slots;
+  std::vector<std::uint32_t> m_free;
+  std::vector<T> m_items;
+  // m_items[i] 所在的槽位
+  std::vector<std::uint32_t> m_owners;
+};
+} // namespace cg
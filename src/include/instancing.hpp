@@ -0,0 +1,100 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <resources.hpp>
+#include <shader.hpp>
+#include <upload_ring.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace cg {
+/**
+ * @brief 实例化绘制所用的几何体: 一个 VAO 中的一段顶点或索引
+ */
+struct BatchMesh {
+  GLuint VAO;
+  GLint first;   // glDrawArrays 的起始顶点, 索引绘制时忽略
+  GLsizei count; // 顶点数或索引数
+  bool indexed{false};
+};
+
+/**
+ * @brief 材质: 着色器以及依次绑定到纹理单元 0, 1 的纹理 (空句柄表示不绑定)
+ * 纹理在绘制时经 ResourceManager 解析, 替换后的纹理下一帧即生效
+ */
+struct BatchMaterial {
+  cg::Shader *shader;
+  std::array<TextureHandle, 2> textures{};
+};
+
+/**
+ * @brief 按 (mesh, material) 合批的实例化绘制
+ *
+ * 每帧 append 所有实例, upload 时按材质和网格排序并把模型矩阵写入
+ * 实例缓冲, draw 对每组唯一的 (mesh, material) 只发出一次
+ * glDrawArraysInstanced / glDrawElementsInstanced.
+ * 模型矩阵占用顶点属性 location 3..6, 法线矩阵在 upload 时批量计算,
+ * 占用 location 7..9, 顶点着色器见 instanced.vert.
+ *
+ * 给定 ring 时实例数据从上传环的当前帧区域分配, 只在本帧有效, 适合每帧
+ * 重建的批次; 否则 (或环空间不足时) 写入自己的缓冲, 适合一次性上传.
+ */
+class InstanceBatcher {
+public:
+  static constexpr GLuint instanceLocation = 3;
+  static constexpr GLuint normalLocation = 7;
+
+  // 材质带纹理时必须给定 resources
+  explicit InstanceBatcher(UploadRing *ring = nullptr,
+                           const ResourceManager *resources = nullptr);
+  ~InstanceBatcher();
+  InstanceBatcher(const InstanceBatcher &) = delete;
+  InstanceBatcher &operator=(const InstanceBatcher &) = delete;
+
+  std::uint32_t addMesh(const BatchMesh &mesh);
+  std::uint32_t addMaterial(const BatchMaterial &material);
+
+  void append(std::uint32_t mesh, std::uint32_t material,
+              const glm::mat4 &transform);
+  void upload();
+  void draw() const;
+  // 只绘制使用该材质的批次, 用于把不同材质分到不同的渲染阶段
+  void draw(std::uint32_t material) const;
+  void clear();
+
+  std::size_t instanceCount() const { return m_instances.size(); }
+  std::size_t drawCount() const { return m_batches.size(); }
+
+private:
+  struct Instance {
+    std::uint64_t key;
+    std::uint32_t sequence;
+    glm::mat4 transform;
+  };
+  struct Batch {
+    std::uint32_t mesh;
+    std::uint32_t material;
+    GLsizei first;
+    GLsizei count;
+  };
+  void bindInstanceAttributes(GLsizei firstInstance) const;
+  void drawBatches(std::uint32_t material) const;
+
+  UploadRing *m_ring;
+  const ResourceManager *m_resources;
+  GLuint m_instanceVBO{};
+  std::size_t m_capacity{};
+  // 本次 upload 的数据所在的缓冲及起始偏移
+  GLuint m_sourceBuffer{};
+  std::size_t m_sourceOffset{};
+  std::vector<BatchMesh> m_meshes;
+  std::vector<BatchMaterial> m_materials;
+  std::vector<Instance> m_instances;
+  std::vector<glm::mat4> m_transforms;
+  // 与 m_transforms 一一对应, 在实例缓冲中紧接在模型矩阵之后
+  std::vector<glm::mat3> m_normals;
+  std::vector<Batch> m_batches;
+};
+} // namespace cg
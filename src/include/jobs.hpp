@@ -0,0 +1,127 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace cg {
+namespace detail {
+struct Job;
+}
+
+/**
+ * @brief 作业计数器: 每提交一个关联的作业加一, 作业完成后减一
+ * 归零时依赖它的作业才会进入队列
+ */
+class JobCounter {
+public:
+  JobCounter() = default;
+  // 等最后一个作业释放锁之后才能销毁
+  ~JobCounter() { std::lock_guard lock{m_mutex}; }
+  JobCounter(const JobCounter &) = delete;
+  JobCounter &operator=(const JobCounter &) = delete;
+
+  bool done() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+private:
+  friend class JobSystem;
+  std::atomic<std::uint32_t> m_pending{0};
+  std::mutex m_mutex;
+  // 等待本计数器归零的作业
+  std::vector<detail::Job *> m_waiting;
+};
+
+/**
+ * @brief 工作窃取的作业系统
+ *
+ * 每个工作线程有一个 Chase-Lev 双端队列: 自己从底部压入和弹出 (LIFO,
+ * 缓存友好), 空闲的线程从其他队列的顶部窃取. 非工作线程 (如 GL 线程)
+ * 提交的作业进入共享的注入队列. 工作线程数默认为核心数减一并各自
+ * 绑定到一个核心, 0 号核心留给 GL 线程 (见 pinCallingThread).
+ *
+ * wait 会在当前线程上执行作业直到计数器归零, 因此作业内部也可以
+ * 提交并等待子作业而不会死锁; 没有可执行的作业时与空闲的工作线程
+ * 一样先自旋再睡眠, 有新作业或计数器归零时唤醒.
+ */
+class JobSystem {
+public:
+  using Function = std::function<void()>;
+  using BlockFunction = void (*)(void *context, std::size_t begin,
+                                 std::size_t end);
+
+  // workers 为 0 时取 hardware_concurrency - 1
+  explicit JobSystem(unsigned workers = 0);
+  ~JobSystem();
+  JobSystem(const JobSystem &) = delete;
+  JobSystem &operator=(const JobSystem &) = delete;
+
+  // 进程共享的实例, 首次使用时创建
+  static JobSystem &shared();
+  // 把调用线程绑定到留给它的 0 号核心; 之后创建的线程会继承这个
+  // 亲和性, 所以应在其他线程启动之后调用
+  void pinCallingThread() const;
+
+  // done 不为空时在作业完成后减一; after 不为空时等它归零后才开始执行
+  void run(Function function, JobCounter *done = nullptr,
+           JobCounter *after = nullptr);
+  // 等待计数器归零, 期间当前线程也执行队列中的作业
+  void wait(JobCounter &counter);
+
+  /**
+   * @brief 把 [begin, end) 按 grain 切块并行执行 fn(blockBegin, blockEnd)
+   * 第一块在调用线程上执行, 返回时所有块都已完成.
+   * 作业对象放在调用者的栈上, 块数不多时不做堆分配
+   */
+  template <typename Fn>
+  void parallelFor(std::size_t begin, std::size_t end, std::size_t grain,
+                   Fn &&fn) {
+    grain = std::max<std::size_t>(grain, 1);
+    if (end <= begin + grain || m_workers.empty()) {
+      if (begin < end) {
+        fn(begin, end);
+      }
+      return;
+    }
+    using Body = std::remove_reference_t<Fn>;
+    forBlocks(
+        begin, end, grain,
+        [](void *context, std::size_t blockBegin, std::size_t blockEnd) {
+          (*static_cast<Body *>(context))(blockBegin, blockEnd);
+        },
+        const_cast<void *>(static_cast<const void *>(std::addressof(fn))));
+  }
+
+  unsigned workerCount() const {
+    return static_cast<unsigned>(m_workers.size());
+  }
+  // 当前线程在本系统中的工作线程编号, 不是工作线程时为 -1
+  int currentWorker() const;
+
+private:
+  class Deque;
+
+  void forBlocks(std::size_t begin, std::size_t end, std::size_t grain,
+                 BlockFunction function, void *context);
+  void submit(detail::Job *job);
+  detail::Job *next(int worker);
+  void execute(detail::Job *job);
+  void workerLoop(unsigned index);
+
+  std::vector<std::unique_ptr<Deque>> m_deques;
+  std::mutex m_injectMutex;
+  std::vector<detail::Job *> m_inject;
+  std::atomic<std::size_t> m_injectSize{0};
+  // 每次提交加一, 空闲的线程在其上等待
+  std::atomic<std::uint32_t> m_signal{0};
+  std::atomic<bool> m_stop{false};
+  // 工作线程绑定到 1..cores-1 号核心, 单核时不绑定
+  unsigned m_cores{};
+  std::vector<std::jthread> m_workers;
+};
+} // namespace cg
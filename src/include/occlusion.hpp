@@ -0,0 +1,46 @@
+#pragma once
+#include <culling.hpp>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace cg {
+/**
+ * @brief 纯 CPU 的遮挡剔除
+ *
+ * 把简化的遮挡体光栅化到低分辨率深度缓冲 (SSE 一次处理 4 个像素),
+ * 再逐级构建 min/max 深度金字塔. 提交前用对象包围盒的最近深度和覆盖区域
+ * 内遮挡体的最远深度比较, 被完全挡住的对象不再提交给 GPU.
+ * 深度为 NDC z 映射到 [0, 1], 1 为远平面.
+ */
+class OcclusionCuller {
+public:
+  explicit OcclusionCuller(int width = 256, int height = 128);
+
+  void clear();
+  // mvp = projection * view * model, 三角形由 indices 每三个一组给出
+  void rasterize(const glm::mat4 &mvp, std::span<const glm::vec3> vertices,
+                 std::span<const std::uint32_t> indices);
+  void buildHierarchy();
+  // 包围盒 (世界空间) 可能可见时返回 true
+  bool isVisible(const Aabb &box, const glm::mat4 &viewProjection) const;
+
+  int width() const { return m_width; }
+  int height() const { return m_height; }
+  float depthAt(int x, int y) const { return m_depth[y * m_stride + x]; }
+
+private:
+  struct Level {
+    int width, height;
+    std::vector<float> minDepth, maxDepth;
+  };
+  void rasterizeTriangle(glm::vec3 v0, glm::vec3 v1, glm::vec3 v2);
+
+  int m_width, m_height;
+  int m_stride; // 按 4 对齐, 行尾的 SIMD 写入不会越界
+  std::vector<float> m_depth;
+  std::vector<Level> m_levels;
+};
+} // namespace cg
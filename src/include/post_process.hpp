@@ -0,0 +1,110 @@
+#pragma once
+#include <glad/glad.h>
+#include <render_graph.hpp>
+#include <shader.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace cg {
+struct PostEffect {
+  enum class Type {
+    // 逐像素操作, 相邻的会合并到同一个阶段
+    invert,
+    grayscale,
+    // 邻域操作
+    blur,
+    edgeDetect,
+    sharpen,
+  };
+  Type type;
+  // 邻域操作的分辨率: 1 为全分辨率, 2 为一半, 4 为四分之一
+  int divisor{1};
+  // 高斯模糊的标准差和半径, 以该分辨率下的像素为单位
+  float sigma{2.0f};
+  int radius{4};
+
+  static PostEffect invert() { return {Type::invert}; }
+  static PostEffect grayscale() { return {Type::grayscale}; }
+  static PostEffect blur(float sigma, int radius, int divisor = 1) {
+    return {Type::blur, divisor, sigma, radius};
+  }
+  static PostEffect edgeDetect(int divisor = 1) {
+    return {Type::edgeDetect, divisor};
+  }
+  static PostEffect sharpen(int divisor = 1) {
+    return {Type::sharpen, divisor};
+  }
+  bool perPixel() const {
+    return type == Type::invert || type == Type::grayscale;
+  }
+};
+
+/**
+ * @brief 可分离高斯核的线性采样: 相邻两个像素的权重合并成一次双线性
+ * 采样, 采样点落在两者之间按权重插值的位置. 0 号为中心, 其余对称地
+ * 各取两次, 半径 r 的核每个方向只需要 1 + ceil(r / 2) 个采样点
+ */
+struct BlurTaps {
+  static constexpr int maxTaps = 8;
+  int count{};
+  std::array<float, maxTaps> offsets{}, weights{};
+};
+// 半径超过 2 * (maxTaps - 1) 时抛出 std::runtime_error
+BlurTaps linearGaussian(float sigma, int radius);
+
+/**
+ * @brief 可在运行时配置的后处理链
+ *
+ * setEffects 把效果列表编排成阶段: 相邻的逐像素操作合并成一个阶段,
+ * 链尾的逐像素操作直接在 present 中执行; 模糊拆成水平和垂直两个阶段;
+ * 邻域操作先把输入按 2x2 盒式滤波逐级缩小到它的分辨率. 中间目标由渲染
+ * 图分配, 前后相邻阶段之外的目标生命周期不重叠, 自然形成乒乓.
+ * 目标沿用输入的格式, 并随动态分辨率缩放.
+ */
+class PostStack {
+public:
+  // colorShader 为 quad.fs, present 使用同一个着色器
+  PostStack(Shader &colorShader, Shader &blurShader, Shader &kernelShader,
+            GLuint quadVAO);
+
+  // 参数无效时抛出 std::runtime_error, 之前的配置保持不变;
+  // 声明过的阶段引用旧的配置, 修改之后要重新声明渲染图
+  void setEffects(std::vector<PostEffect> effects);
+  const std::vector<PostEffect> &effects() const { return m_effects; }
+
+  // 在渲染图中声明后处理阶段, 返回交给 present 的结果
+  RenderGraph::Resource addPasses(RenderGraph &graph,
+                                  RenderGraph::Resource input) const;
+  // present 读取 addPasses 的结果时执行剩余的逐像素操作
+  void setPresentOps(const Shader &shader) const;
+
+  std::size_t passCount() const { return m_steps.size(); }
+  // 每个输出像素的纹理采样数 (含 present), 以及每个效果各用一个全分辨率
+  // 阶段直接计算时的采样数
+  float samplesPerPixel() const;
+  float naiveSamplesPerPixel() const;
+
+private:
+  struct Step {
+    enum class Kind { color, blurHorizontal, blurVertical, kernel };
+    Kind kind;
+    int divisor;
+    // 融合的逐像素操作, 每 4 位一个, 低位先执行
+    std::uint32_t opCodes{};
+    BlurTaps taps{};
+    std::array<float, 9> kernel{};
+  };
+  void draw(const RenderGraph &graph, const Step &step,
+            RenderGraph::Resource input) const;
+
+  Shader &m_colorShader, &m_blurShader, &m_kernelShader;
+  // 数组 uniform 的位置, 构造时查询一次
+  GLint m_offsetsLocation, m_weightsLocation, m_kernelLocation;
+  GLuint m_quadVAO;
+  std::vector<PostEffect> m_effects;
+  std::vector<Step> m_steps;
+  std::uint32_t m_presentOps{};
+};
+} // namespace cg
@@ -0,0 +1,131 @@
+#pragma once
+#include <glad/glad.h>
+#include <render_targets.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace cg {
+/**
+ * @brief 声明式的渲染图
+ *
+ * 每个阶段声明读取和写入的纹理, compile 从输出 (写默认帧缓冲或标记为
+ * sideEffect 的阶段) 反向追溯, 剔除结果没有被用到的阶段, 按声明顺序排列
+ * 其余阶段并检查每次读取之前都有写入. 临时纹理在 compile 时从
+ * RenderTargetPool 取得: 描述相同且生命周期 (第一次到最后一次使用的阶段)
+ * 不重叠的纹理共用同一个纹理对象, 因此增加阶段不会让显存线性增长.
+ * 重新 compile 时上一次的纹理先放回池中, 大小不变的目标会被原样取回.
+ *
+ * 写入即附加到该阶段的帧缓冲: 颜色纹理按声明顺序依次为
+ * GL_COLOR_ATTACHMENT0.., 深度格式附加到深度 (模板) 附件. 写入保留原有
+ * 内容; 纹理可能刚被别的资源用过, 第一次写入的阶段负责清空.
+ * execute 按顺序绑定各阶段的帧缓冲和视口后调用阶段函数, 不产生堆分配;
+ * 结构改变时 reset 之后重新声明并 compile.
+ *
+ * 标记为动态分辨率的纹理按完整大小分配, 每帧只渲染左下角
+ * renderScale 倍的区域 (extent), 改变比例不需要重新 compile;
+ * 读取它们的阶段负责按 extent 缩放纹理坐标.
+ */
+class RenderGraph {
+public:
+  using Resource = std::uint32_t;
+
+  using TextureDesc = RenderTargetDesc;
+  struct Extent {
+    GLsizei width, height;
+  };
+  using Execute = std::function<void(const RenderGraph &)>;
+
+  class PassBuilder {
+  public:
+    PassBuilder &read(Resource resource);
+    PassBuilder &write(Resource resource);
+    // 结果不被其他阶段读取也要执行, 例如更新持久的阴影贴图
+    PassBuilder &sideEffect();
+
+  private:
+    friend class RenderGraph;
+    PassBuilder(RenderGraph &graph, std::size_t pass)
+        : m_graph(graph), m_pass(pass) {}
+    RenderGraph &m_graph;
+    std::size_t m_pass;
+  };
+
+  // 池必须比渲染图活得更久
+  explicit RenderGraph(RenderTargetPool &targets) : m_targets(targets) {}
+  ~RenderGraph();
+  RenderGraph(const RenderGraph &) = delete;
+  RenderGraph &operator=(const RenderGraph &) = delete;
+
+  // dynamicResolution 为 true 时视口随 renderScale 缩放
+  Resource createTexture(std::string name, const TextureDesc &desc,
+                         bool dynamicResolution = false);
+  // 默认帧缓冲, 写入它的阶段总会执行
+  Resource backbuffer(GLsizei width, GLsizei height);
+  PassBuilder addPass(std::string name, Execute execute);
+
+  // 剔除, 排序并分配纹理, 出错时抛出 std::runtime_error
+  void compile();
+  void execute() const;
+  // 清空阶段和资源的声明, 纹理在下一次 compile 或析构时还给池
+  void reset();
+  // 动态分辨率纹理的渲染比例, 限制在 [1/16, 1]
+  void setRenderScale(float scale);
+  float renderScale() const { return m_renderScale; }
+
+  // 资源对应的纹理对象, 只在 compile 之后有效, 被剔除的资源为 0
+  GLuint texture(Resource resource) const;
+  const TextureDesc &desc(Resource resource) const;
+  // 本帧实际渲染的区域, 固定分辨率的纹理为完整大小
+  Extent extent(Resource resource) const;
+
+  std::size_t passCount() const { return m_passes.size(); }
+  std::size_t executedPassCount() const { return m_order.size(); }
+  // 使用的纹理数及其显存, 以及不共用纹理时所需的显存
+  std::size_t textureCount() const { return m_textures.size(); }
+  std::size_t textureBytes() const;
+  std::size_t requestedBytes() const;
+
+private:
+  struct ResourceNode {
+    std::string name;
+    TextureDesc desc;
+    bool backbuffer{};
+    bool dynamicResolution{};
+    // 分配到的 m_textures 下标, 没有时为 -1
+    std::ptrdiff_t physical{-1};
+  };
+  struct PassNode {
+    std::string name;
+    Execute execute;
+    std::vector<Resource> reads, writes;
+    bool sideEffect{};
+    GLuint framebuffer{};
+    bool bindsFramebuffer{};
+  };
+  struct PhysicalTexture {
+    GLuint id;
+    TextureDesc desc;
+    // 本次 compile 中最后使用它的阶段序号
+    std::ptrdiff_t busyUntil;
+  };
+  void validate(Resource resource) const;
+  void allocateTextures(const std::vector<std::size_t> &firstUse,
+                        const std::vector<std::size_t> &lastUse);
+  void createFramebuffers();
+  void releaseFramebuffers();
+  void releaseTextures();
+
+  std::vector<ResourceNode> m_resources;
+  std::vector<PassNode> m_passes;
+  // 按执行顺序排列的未被剔除的阶段
+  std::vector<std::size_t> m_order;
+  RenderTargetPool &m_targets;
+  std::vector<PhysicalTexture> m_textures;
+  bool m_compiled{};
+  float m_renderScale{1.0f};
+};
+} // namespace cg
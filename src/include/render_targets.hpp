@@ -0,0 +1,88 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cg {
+struct RenderTargetDesc {
+  GLsizei width, height;
+  // 内部格式, 例如 GL_RGBA16F, GL_DEPTH24_STENCIL8
+  GLenum format;
+  // 大于 1 时创建 GL_TEXTURE_2D_MULTISAMPLE
+  GLsizei samples{1};
+  bool operator==(const RenderTargetDesc &) const = default;
+};
+
+/**
+ * @brief 按 (格式, 大小, 采样数) 复用的渲染目标池
+ *
+ * acquire 优先取出同一描述的空闲纹理, 没有时才创建; release 把纹理放回
+ * 空闲列表而不删除. 空闲超过 maxIdleFrames 帧的纹理在 endFrame 中删除,
+ * 因此窗口改变大小后旧尺寸的目标还会保留一段时间, 大小改回来或切换渲染
+ * 路径时直接复用, 不再需要的才释放显存.
+ */
+class RenderTargetPool {
+public:
+  explicit RenderTargetPool(std::uint32_t maxIdleFrames = 120)
+      : m_maxIdleFrames(maxIdleFrames) {}
+  ~RenderTargetPool();
+  RenderTargetPool(const RenderTargetPool &) = delete;
+  RenderTargetPool &operator=(const RenderTargetPool &) = delete;
+
+  // 不支持的格式抛出 std::runtime_error
+  GLuint acquire(const RenderTargetDesc &desc);
+  void release(GLuint texture);
+  // 每帧调用一次, 删除空闲太久的纹理
+  void endFrame();
+  // 立即删除所有空闲纹理
+  void trim();
+
+  std::size_t liveCount() const { return m_live.size(); }
+  std::size_t idleCount() const { return m_idle.size(); }
+  // 池中全部纹理 (使用中和空闲) 的显存估算
+  std::size_t bytes() const;
+  std::size_t createdCount() const { return m_created; }
+
+  // 绑定和附加纹理时使用的目标, 单采样为 GL_TEXTURE_2D
+  static GLenum textureTarget(const RenderTargetDesc &desc);
+  static std::size_t bytesOf(const RenderTargetDesc &desc);
+  // 深度格式返回对应的帧缓冲附件, 颜色格式返回 GL_NONE
+  static GLenum depthAttachment(GLenum format);
+
+private:
+  struct Target {
+    GLuint id;
+    RenderTargetDesc desc;
+    // 放回空闲列表时的帧号
+    std::uint64_t releasedAt{};
+  };
+  std::vector<Target> m_live, m_idle;
+  std::uint64_t m_frame{};
+  std::uint32_t m_maxIdleFrames;
+  std::size_t m_created{};
+};
+
+/**
+ * @brief 窗口大小变化的去抖: 拖动窗口时每帧都会收到新的大小, 大小保持
+ * delay 秒不变之后才报告一次, 避免拖动过程中反复重建渲染目标.
+ * 宽或高为 0 (窗口最小化) 的请求被忽略, 重复的大小不重新计时
+ */
+class ResizeDebouncer {
+public:
+  ResizeDebouncer(GLsizei width, GLsizei height, double delay = 0.2)
+      : m_width(width), m_height(height), m_delay(delay) {}
+
+  void request(GLsizei width, GLsizei height, double time);
+  // 有稳定下来的新大小时写入 width, height 并返回 true
+  bool settle(double time, GLsizei &width, GLsizei &height);
+
+private:
+  GLsizei m_width, m_height;
+  GLsizei m_pendingWidth{}, m_pendingHeight{};
+  double m_requestedAt{};
+  double m_delay;
+  bool m_pending{};
+};
+} // namespace cg
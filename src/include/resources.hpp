@@ -0,0 +1,109 @@
+#pragma once
+#include <glad/glad.h>
+#include <handles.hpp>
+
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cg {
+using TextureHandle = Handle<struct TextureTag>;
+using BufferHandle = Handle<struct BufferTag>;
+using MeshHandle = Handle<struct MeshTag>;
+using MaterialHandle = Handle<struct MaterialTag>;
+using ProgramHandle = Handle<struct ProgramTag>;
+
+struct TextureResource {
+  GLuint id;
+  GLenum target{GL_TEXTURE_2D};
+  // 加载路径, 用于去重, 可以为空
+  std::string name;
+};
+struct BufferResource {
+  GLuint id;
+};
+struct ProgramResource {
+  GLuint id;
+};
+/**
+ * @brief 网格: 一个 VAO 中的一段顶点或索引, 以及 VAO 引用的缓冲
+ * 销毁网格时同时销毁这些缓冲
+ */
+struct MeshResource {
+  GLuint vao;
+  GLint first;   // glDrawArrays 的起始顶点, 索引绘制时忽略
+  GLsizei count; // 顶点数或索引数
+  bool indexed{false};
+  std::array<BufferHandle, 2> buffers{};
+};
+struct MaterialTexture {
+  TextureHandle texture;
+  // 着色器中的用途, 例如 texture_diffuse
+  std::string type;
+};
+// 材质只引用纹理和程序, 不拥有它们
+struct MaterialResource {
+  ProgramHandle program;
+  std::vector<MaterialTexture> textures;
+};
+
+/**
+ * @brief GL 资源的所有者: 纹理, 缓冲, 网格, 材质和着色器程序
+ *
+ * 资源通过带类型的代际句柄访问, 句柄在资源被替换 (热重载) 时保持不变,
+ * 被销毁后失效, 查询返回 0 或空指针而不是访问已删除的对象.
+ * 所有 GL 对象在 clear 或析构时删除, 必须在 GL 上下文销毁之前调用.
+ * 查询可以在工作线程进行, 增删和替换只能在 GL 线程且不能与查询并发.
+ */
+class ResourceManager {
+public:
+  ResourceManager() = default;
+  ~ResourceManager();
+  ResourceManager(const ResourceManager &) = delete;
+  ResourceManager &operator=(const ResourceManager &) = delete;
+
+  // 接管已创建的纹理对象, name 非空时可以用 findTexture 查找
+  TextureHandle addTexture(GLuint id, GLenum target = GL_TEXTURE_2D,
+                           std::string name = {});
+  // 找不到时返回空句柄
+  TextureHandle findTexture(const std::string &name) const;
+  // 句柄失效时返回 0
+  GLuint texture(TextureHandle handle) const;
+  // 换成新的纹理对象并删除旧的, 之前取得的句柄继续有效
+  bool replaceTexture(TextureHandle handle, GLuint id);
+  void destroy(TextureHandle handle);
+
+  BufferHandle addBuffer(GLuint id);
+  GLuint buffer(BufferHandle handle) const;
+  void destroy(BufferHandle handle);
+
+  ProgramHandle addProgram(GLuint id);
+  GLuint program(ProgramHandle handle) const;
+  bool replaceProgram(ProgramHandle handle, GLuint id);
+  void destroy(ProgramHandle handle);
+
+  MeshHandle addMesh(const MeshResource &mesh);
+  const MeshResource *mesh(MeshHandle handle) const;
+  void destroy(MeshHandle handle);
+
+  MaterialHandle addMaterial(MaterialResource material);
+  const MaterialResource *material(MaterialHandle handle) const;
+  MaterialResource *material(MaterialHandle handle);
+  void destroy(MaterialHandle handle);
+
+  // 删除全部 GL 对象, 之前的所有句柄失效
+  void clear();
+
+  std::size_t textureCount() const { return m_textures.size(); }
+  std::size_t meshCount() const { return m_meshes.size(); }
+
+private:
+  HandlePool<TextureResource, TextureTag> m_textures;
+  HandlePool<BufferResource, BufferTag> m_buffers;
+  HandlePool<ProgramResource, ProgramTag> m_programs;
+  HandlePool<MeshResource, MeshTag> m_meshes;
+  HandlePool<MaterialResource, MaterialTag> m_materials;
+  std::unordered_map<std::string, TextureHandle> m_textureNames;
+};
+} // namespace cg
@@ -6,13 +6,28 @@
 #include <string>
 
 namespace cg {
+/**
+ * @brief uniform 名: 字符串字面量直接传指针, 不再构造临时的 std::string
+ */
+class UniformName {
+public:
+  UniformName(const char *name) : m_name(name) {}
+  UniformName(const std::string &name) : m_name(name.c_str()) {}
+  const char *c_str() const { return m_name; }
+
+private:
+  const char *m_name;
+};
+
 class Shader {
 public:
   unsigned int ID;
-  Shader(const char *vertexPath, const char *fragmentPath);
+  // geometryPath 为空时不使用几何着色器
+  Shader(const char *vertexPath, const char *fragmentPath,
+         const char *geometryPath = nullptr);
   void use();
   template <typename... Args>
-  void setBool(const std::string &name, Args... args) const {
+  void setBool(UniformName name, Args... args) const {
     if constexpr (sizeof...(args) == 1) {
       glUniform1i(glGetUniformLocation(ID, name.c_str()), args...);
     } else if constexpr (sizeof...(args) == 2) {
@@ -27,36 +42,47 @@ public:
                     "setBool can only accept 1, 2, 3, 4 arguments");
     }
   }
-  void setVec3(const std::string &name, float x, float y, float z) const {
+  void setVec3(UniformName name, float x, float y, float z) const {
     glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
   }
-  void setVec3(const std::string &name, const glm::vec3 &value) const {
+  void setVec3(UniformName name, const glm::vec3 &value) const {
     glUniform3f(glGetUniformLocation(ID, name.c_str()), value.x, value.y,
                 value.z);
   }
 
-  void setVec3(const std::string &name, GLfloat *value) const {
+  void setVec3(UniformName name, GLfloat *value) const {
     glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, value);
   }
 
-  void setVec2(const std::string &name, float x, float y) const {
+  void setVec2(UniformName name, float x, float y) const {
     glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
   }
-  void setVec2(const std::string &name, const glm::vec2 &value) const {
+  void setVec2(UniformName name, const glm::vec2 &value) const {
     glUniform2f(glGetUniformLocation(ID, name.c_str()), value.x, value.y);
   }
- void setVec2(const std::string &name, GLfloat *value) const {
+ void setVec2(UniformName name, GLfloat *value) const {
     glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, value);
   }
 
 
 
-  void setMat4(const std::string &name, const glm::mat4 &value) const {
+  void setMat3(UniformName name, const glm::mat3 &value) const {
+    glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
+                       glm::value_ptr(value));
+  }
+  void setMat4(UniformName name, const glm::mat4 &value) const {
     glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE,
                        glm::value_ptr(value));
   }
+  // GL 4.0 不能在着色器中指定块的绑定点, 着色器中没有该块时忽略
+  void bindUniformBlock(UniformName name, GLuint binding) const {
+    auto index = glGetUniformBlockIndex(ID, name.c_str());
+    if (index != GL_INVALID_INDEX) {
+      glUniformBlockBinding(ID, index, binding);
+    }
+  }
   template <typename... Args>
-  void setInt(const std::string &name, Args... args) const {
+  void setInt(UniformName name, Args... args) const {
     if constexpr (sizeof...(args) == 1) {
       glUniform1i(glGetUniformLocation(ID, name.c_str()), args...);
     } else if constexpr (sizeof...(args) == 2) {
@@ -72,7 +98,7 @@ public:
     }
   }
   template <typename... Args>
-  void setFloat(const std::string &name, Args... args) const {
+  void setFloat(UniformName name, Args... args) const {
     if constexpr (sizeof...(args) == 1) {
       glUniform1f(glGetUniformLocation(ID, name.c_str()), args...);
     } else if constexpr (sizeof...(args) == 2) {
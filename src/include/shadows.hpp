@@ -0,0 +1,148 @@
+#pragma once
+#include <glad/glad.h>
+#include <culling.hpp>
+#include <glm/glm.hpp>
+#include <shader.hpp>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+
+namespace cg {
+/**
+ * @brief 定向光的级联阴影 (CSM)
+ *
+ * 视锥按 practical split (对数与均匀划分按 lambda 混合) 切成 cascadeCount 段,
+ * 每段取外接球, 球心在光源空间中对齐到纹素, 因此相机旋转和平移时
+ * 阴影边缘不会闪烁. 所有级联共用一张深度数组纹理 (sampler2DArrayShadow).
+ *
+ * 近处的级联每帧重绘. 从 firstCachedCascade 开始的远处级联只包含静态
+ * 投射体, 投影在外接球基础上再放大 cachePadding 倍; 只有当相机离开缓存的
+ * 区域, 光源方向改变或静态集合的版本号改变时才重绘, 且每帧最多重绘一个.
+ */
+class CascadedShadowMap {
+public:
+  static constexpr int cascadeCount = 4;
+  static constexpr int firstCachedCascade = 2;
+  static constexpr float cachePadding = 1.25f;
+
+  // drawCasters(lightViewProjection, staticOnly): 以给定矩阵绘制投射体
+  using DrawCasters = std::function<void(const glm::mat4 &, bool)>;
+
+  explicit CascadedShadowMap(int resolution = 2048,
+                             float shadowDistance = 50.0f,
+                             float lambda = 0.75f);
+  ~CascadedShadowMap();
+  CascadedShadowMap(const CascadedShadowMap &) = delete;
+  CascadedShadowMap &operator=(const CascadedShadowMap &) = delete;
+
+  // 重新计算各级联并重绘需要更新的级联, 返回后仍绑定着默认帧缓冲
+  void update(const glm::mat4 &view, float fovy, float aspect, float zNear,
+              const glm::vec3 &lightDirection, std::uint64_t staticVersion,
+              const DrawCasters &drawCasters);
+  // 着色器中 std140 的 Cascades 块, 每帧由上传环写入
+  struct Block {
+    glm::mat4 lightSpaceMatrices[cascadeCount];
+    glm::vec4 cascadeSplits; // 各级联远端的视深
+  };
+  Block block() const;
+  // 绑定阴影纹理并设置 shadowMap
+  void bind(const cg::Shader &shader, int unit) const;
+
+  // 本帧重绘的级联数
+  int renderedCascades() const { return m_rendered; }
+
+private:
+  struct Cascade {
+    glm::mat4 lightViewProjection{1.0f};
+    float splitFar{};
+    // 光源空间中的投影中心与半边长, 用于判断缓存是否仍然覆盖
+    glm::vec3 center{};
+    float halfSize{};
+    bool valid{false};
+    glm::vec3 lightDirection{};
+    std::uint64_t staticVersion{};
+  };
+  void render(int cascade, const DrawCasters &drawCasters);
+
+  int m_resolution;
+  float m_shadowDistance, m_lambda;
+  GLuint m_fbo{}, m_depth{};
+  std::array<Cascade, cascadeCount> m_cascades{};
+  int m_rendered{};
+};
+
+/**
+ * @brief 点光源与聚光的缓存阴影
+ *
+ * 点光源共用一张立方体数组深度纹理 (samplerCubeArrayShadow), 每个光源
+ * 占 6 层; 几何着色器实例化 6 次, 用 gl_Layer 在一遍绘制中写入全部面.
+ * 立方体阴影中存的是到光源的距离除以光源半径. 聚光使用普通的透视阴影图.
+ *
+ * 阴影只在光源本身改变, 或 invalidate 报告有投射体在其范围内移动时重绘;
+ * 光源和投射体都静止时 update 不产生任何 GL 调用.
+ */
+class LocalShadowMaps {
+public:
+  static constexpr int maxPointLights = 4;
+
+  struct Pass {
+    // 光源的影响范围, 用于挑选需要绘制的投射体
+    Sphere bounds;
+    bool cube;
+    // 点光源: 6 个面的 projection * view, 写入 layer 开始的 6 层;
+    // 聚光: 只使用 matrices[0]
+    std::array<glm::mat4, 6> matrices;
+    int layer;
+  };
+  using DrawCasters = std::function<void(const Pass &)>;
+
+  explicit LocalShadowMaps(int cubeResolution = 512,
+                           int spotResolution = 1024);
+  ~LocalShadowMaps();
+  LocalShadowMaps(const LocalShadowMaps &) = delete;
+  LocalShadowMaps &operator=(const LocalShadowMaps &) = delete;
+
+  // 位置或半径与缓存不同时才标记为需要重绘
+  void setPointLight(int index, const glm::vec3 &position, float radius);
+  // outerAngle 为外锥角的一半 (弧度)
+  void setSpotLight(const glm::vec3 &position, const glm::vec3 &direction,
+                    float outerAngle, float range);
+  // 投射体移动后以新旧包围盒各调用一次
+  void invalidate(const Aabb &box);
+  // 重绘所有失效的阴影, 返回后仍绑定着默认帧缓冲
+  void update(const DrawCasters &drawCasters);
+  // 着色器中 std140 的 LocalShadows 块
+  struct Block {
+    glm::mat4 spotLightSpace;
+  };
+  Block block() const { return {m_spot.lightViewProjection}; }
+  // 绑定 pointShadowMaps (unit) 与 spotShadowMap (unit + 1);
+  // 点光源的阴影序号见 ClusterLight::shadowSlot
+  void bind(const cg::Shader &shader, int unit) const;
+
+  // 本帧重绘的阴影图数
+  int renderedMaps() const { return m_rendered; }
+
+private:
+  struct PointShadow {
+    glm::vec3 position{};
+    float radius{};
+    bool dirty{false};
+  };
+  struct SpotShadow {
+    glm::vec3 position{};
+    glm::vec3 direction{};
+    float outerAngle{}, range{};
+    glm::mat4 lightViewProjection{1.0f};
+    bool dirty{false};
+  };
+
+  int m_cubeResolution, m_spotResolution;
+  GLuint m_fbo{}, m_pointDepth{}, m_spotDepth{};
+  std::array<PointShadow, maxPointLights> m_points{};
+  int m_pointCount{};
+  SpotShadow m_spot{};
+  int m_rendered{};
+};
+} // namespace cg
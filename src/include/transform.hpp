@@ -0,0 +1,48 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace cg {
+/**
+ * @brief 场景图的变换层次, SoA 存储
+ *
+ * 节点按深度优先先序排列: 父节点总在子节点之前, 且每个节点的子树是
+ * 连续区间 [node, subtreeEnd). 修改局部矩阵只标记该节点, update 用
+ * SIMD 扫描脏标记, 对每个脏节点的子树做一次线性的 world = parent * local,
+ * 没有改动的部分只付出扫描标记的代价.
+ */
+class TransformHierarchy {
+public:
+  static constexpr std::uint32_t invalid = ~std::uint32_t{};
+
+  // parent 必须是最近添加的节点或其祖先 (递归构建自然满足), 或为 invalid
+  std::uint32_t add(const glm::mat4 &local, std::uint32_t parent = invalid);
+  void setLocal(std::uint32_t node, const glm::mat4 &local);
+  // 重新计算所有脏子树的世界矩阵, 没有改动时立即返回
+  void update();
+  void clear();
+
+  const glm::mat4 &local(std::uint32_t node) const { return m_local[node]; }
+  const glm::mat4 &world(std::uint32_t node) const { return m_world[node]; }
+  std::span<const glm::mat4> worlds() const { return m_world; }
+  std::uint32_t parent(std::uint32_t node) const { return m_parent[node]; }
+  std::size_t size() const { return m_parent.size(); }
+  // 上一次 update 重新计算的节点数
+  std::size_t updatedCount() const { return m_updated; }
+
+private:
+  std::size_t nextDirty(std::size_t from, std::size_t end) const;
+
+  std::vector<std::uint32_t> m_parent;
+  std::vector<std::uint32_t> m_subtreeEnd;
+  std::vector<glm::mat4> m_local;
+  std::vector<glm::mat4> m_world;
+  std::vector<std::uint8_t> m_dirty;
+  // 脏标记所在的范围, 扫描只在其中进行
+  std::size_t m_dirtyBegin{}, m_dirtyEnd{};
+  std::size_t m_updated{};
+};
+} // namespace cg
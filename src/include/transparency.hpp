@@ -0,0 +1,38 @@
+#pragma once
+#include <glad/glad.h>
+#include <shader.hpp>
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace cg {
+/**
+ * @brief 加权混合的顺序无关透明 (weighted blended OIT)
+ *
+ * 累积目标 (RGBA16F) 以 (ONE, ONE) 叠加 premultiplied 颜色乘权重,
+ * revealage 目标 (R8) 以 (ZERO, ONE_MINUS_SRC_COLOR) 累乘 (1 - alpha).
+ * 两个目标由渲染图分配, 与场景共用深度缓冲做深度测试但不写深度, 最后由
+ * 全屏 composite 混合回场景颜色. 结果与提交顺序无关, 不需要在 CPU 上排序.
+ */
+class TransparencyPass {
+public:
+  static constexpr GLenum accumFormat = GL_RGBA16F;
+  static constexpr GLenum revealFormat = GL_R8;
+
+  // 在已绑定的 OIT 帧缓冲 (累积, revealage, 场景深度) 上清空两个目标,
+  // 并设置混合/深度状态
+  void beginAccumulate();
+  // 把累积结果合成到当前绑定的帧缓冲, 着色器见 oit_composite.fs
+  void composite(GLuint accum, GLuint reveal, cg::Shader &compositeShader,
+                 GLuint quadVAO);
+};
+
+/**
+ * @brief 按视深从远到近排序 (LSD 基数排序, 11 位一趟共三趟)
+ *
+ * viewDepth 为到相机的距离, order 输出下标. 用于与 OIT 对照的排序路径.
+ */
+void sortBackToFront(std::span<const float> viewDepth,
+                     std::vector<std::uint32_t> &order);
+} // namespace cg
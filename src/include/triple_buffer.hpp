@@ -0,0 +1,87 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace cg {
+/**
+ * @brief 单生产者单消费者的无锁三缓冲
+ *
+ * 三个槽位分别归生产者 (back), 消费者 (front) 和中间交换位所有. 生产者
+ * 写完 back 后 publish 把它与中间位交换; 消费者 acquire 把 front 与
+ * 中间位交换, 拿到最近一次发布的内容. 双方各自的槽位只有自己访问,
+ * 交换只是对中间位的一次 CAS, 不会互相阻塞.
+ *
+ * 槽位在多次发布之间复用, 其中的容器保留容量, 稳定后不再分配内存.
+ * waitConsumed/waitPublished 用于节流, close 唤醒所有等待并使其返回 false.
+ */
+template <typename T> class TripleBuffer {
+public:
+  TripleBuffer() = default;
+  TripleBuffer(const TripleBuffer &) = delete;
+  TripleBuffer &operator=(const TripleBuffer &) = delete;
+
+  // 生产者: 写入下一份数据的槽位
+  T &back() { return m_slots[m_back]; }
+  void publish() {
+    m_back = swapMiddle(m_back | freshBit) & indexMask;
+    m_middle.notify_all();
+  }
+  // 生产者: 等待上一次发布被取走, 避免领先消费者一帧以上
+  bool waitConsumed() const { return waitUntil(0); }
+
+  // 消费者: 有新发布时换到最新的一份并返回 true
+  bool acquire() {
+    if (!(m_middle.load(std::memory_order_relaxed) & freshBit)) {
+      return false;
+    }
+    m_front = swapMiddle(m_front) & indexMask;
+    m_middle.notify_all();
+    return true;
+  }
+  const T &front() const { return m_slots[m_front]; }
+  // 消费者: 等待下一次发布
+  bool waitPublished() const { return waitUntil(freshBit); }
+
+  void close() {
+    m_middle.fetch_or(closedBit, std::memory_order_release);
+    m_middle.notify_all();
+  }
+  bool closed() const {
+    return m_middle.load(std::memory_order_acquire) & closedBit;
+  }
+
+private:
+  static constexpr std::uint8_t indexMask = 3;
+  static constexpr std::uint8_t freshBit = 4;
+  static constexpr std::uint8_t closedBit = 8;
+
+  // 交换中间位并保留关闭标记, 返回原值
+  std::uint8_t swapMiddle(std::uint8_t value) {
+    auto middle = m_middle.load(std::memory_order_relaxed);
+    while (!m_middle.compare_exchange_weak(
+        middle, value | (middle & closedBit), std::memory_order_acq_rel,
+        std::memory_order_relaxed)) {
+    }
+    return middle;
+  }
+  // 等待 fresh 位变为 fresh, 关闭时返回 false
+  bool waitUntil(std::uint8_t fresh) const {
+    while (true) {
+      auto middle = m_middle.load(std::memory_order_acquire);
+      if (middle & closedBit) {
+        return false;
+      }
+      if ((middle & freshBit) == fresh) {
+        return true;
+      }
+      m_middle.wait(middle, std::memory_order_acquire);
+    }
+  }
+
+  std::array<T, 3> m_slots{};
+  std::uint8_t m_back{0};
+  std::uint8_t m_front{1};
+  std::atomic<std::uint8_t> m_middle{2};
+};
+} // namespace cg
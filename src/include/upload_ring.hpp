@@ -0,0 +1,63 @@
+#pragma once
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace cg {
+/**
+ * @brief 每帧数据的上传环: 一个缓冲分成 framesInFlight 个帧区域
+ *
+ * 每帧从当前区域线性分配, 写入后按偏移绑定 (实例属性, uniform 块等).
+ * endFrame 在区域末尾插入 glFenceSync, 下次轮到这个区域时 beginFrame
+ * 先等它的栅栏, 因此 CPU 写入的区域一定不再被 GPU 使用, 不依赖驱动的
+ * 隐式同步或孤立缓冲.
+ *
+ * 上下文支持 GL 4.4 (glBufferStorage) 时整个缓冲持久且一致地映射一次;
+ * 否则每次分配用 GL_MAP_UNSYNCHRONIZED_BIT 映射该段, commit 时解除映射.
+ * 两种方式都要求 allocate 之后, 下一次 allocate 或绘制之前调用 commit.
+ */
+class UploadRing {
+public:
+  static constexpr std::size_t framesInFlight = 3;
+
+  struct Allocation {
+    // 空间不足时为 nullptr
+    void *data{};
+    GLintptr offset{};
+    std::size_t size{};
+  };
+
+  explicit UploadRing(std::size_t frameBytes);
+  ~UploadRing();
+  UploadRing(const UploadRing &) = delete;
+  UploadRing &operator=(const UploadRing &) = delete;
+
+  void beginFrame();
+  void endFrame();
+
+  // 在当前帧区域中分配, offset 按 alignment (2 的幂) 对齐
+  Allocation allocate(std::size_t bytes, std::size_t alignment = 16);
+  void commit();
+
+  GLuint buffer() const { return m_buffer; }
+  bool persistent() const { return m_mapped != nullptr; }
+  std::size_t frameBytes() const { return m_frameBytes; }
+  // 当前帧已分配的字节数
+  std::size_t used() const { return m_head - m_frame * m_frameBytes; }
+  // beginFrame 因 GPU 仍在使用区域而阻塞的次数
+  std::uint64_t stalls() const { return m_stalls; }
+
+private:
+  GLuint m_buffer{};
+  std::size_t m_frameBytes;
+  // 持久映射的起始地址, 不支持持久映射时为空
+  std::byte *m_mapped{};
+  std::array<GLsync, framesInFlight> m_fences{};
+  std::size_t m_frame{};
+  std::size_t m_head{};
+  bool m_open{};
+  std::uint64_t m_stalls{};
+};
+} // namespace cg
@@ -0,0 +1,183 @@
+#include <instancing.hpp>
+
+#include <algorithm>
+#include <batch_math.hpp>
+#include <cstring>
+#include <stdexcept>
+
+namespace cg {
+InstanceBatcher::InstanceBatcher(UploadRing *ring,
+                                 const ResourceManager *resources)
+    : m_ring(ring), m_resources(resources) {
+  glGenBuffers(1, &m_instanceVBO);
+}
+
+InstanceBatcher::~InstanceBatcher() { glDeleteBuffers(1, &m_instanceVBO); }
+
+std::uint32_t InstanceBatcher::addMesh(const BatchMesh &mesh) {
+  // 在网格自己的 VAO 上启用实例属性, 之后每批只需重设偏移
+  glBindVertexArray(mesh.VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+  for (GLuint i{}; i < 4; i++) {
+    glEnableVertexAttribArray(instanceLocation + i);
+    glVertexAttribPointer(instanceLocation + i, 4, GL_FLOAT, GL_FALSE,
+                          sizeof(glm::mat4),
+                          (void *)(i * sizeof(glm::vec4)));
+    glVertexAttribDivisor(instanceLocation + i, 1);
+  }
+  for (GLuint i{}; i < 3; i++) {
+    glEnableVertexAttribArray(normalLocation + i);
+    glVertexAttribPointer(normalLocation + i, 3, GL_FLOAT, GL_FALSE,
+                          sizeof(glm::mat3),
+                          (void *)(i * sizeof(glm::vec3)));
+    glVertexAttribDivisor(normalLocation + i, 1);
+  }
+  glBindVertexArray(0);
+  m_meshes.push_back(mesh);
+  return static_cast<std::uint32_t>(m_meshes.size() - 1);
+}
+
+std::uint32_t InstanceBatcher::addMaterial(const BatchMaterial &material) {
+  if (!m_resources && std::ranges::any_of(material.textures, [](auto texture) {
+        return static_cast<bool>(texture);
+      })) {
+    throw std::runtime_error("textured material needs a resource manager");
+  }
+  m_materials.push_back(material);
+  return static_cast<std::uint32_t>(m_materials.size() - 1);
+}
+
+void InstanceBatcher::append(std::uint32_t mesh, std::uint32_t material,
+                             const glm::mat4 &transform) {
+  // 材质在高位: 排序后同一着色器/纹理的批次相邻
+  auto key = (static_cast<std::uint64_t>(material) << 32) | mesh;
+  m_instances.push_back(
+      {key, static_cast<std::uint32_t>(m_instances.size()), transform});
+}
+
+void InstanceBatcher::upload() {
+  m_batches.clear();
+  m_transforms.clear();
+  if (m_instances.empty()) {
+    return;
+  }
+  // 同一批次内保持 append 的顺序 (排序后的透明物体依赖它);
+  // 以追加序号作为次关键字, 不用 stable_sort 的临时缓冲
+  std::ranges::sort(m_instances, [](const Instance &a, const Instance &b) {
+    return a.key != b.key ? a.key < b.key : a.sequence < b.sequence;
+  });
+  for (std::size_t i{}; i < m_instances.size(); i++) {
+    const auto &instance = m_instances[i];
+    auto mesh = static_cast<std::uint32_t>(instance.key);
+    auto material = static_cast<std::uint32_t>(instance.key >> 32);
+    if (m_batches.empty() || m_batches.back().mesh != mesh ||
+        m_batches.back().material != material) {
+      m_batches.push_back({mesh, material, static_cast<GLsizei>(i), 0});
+    }
+    m_batches.back().count++;
+    m_transforms.push_back(instance.transform);
+  }
+
+  // 法线矩阵每个实例只算一次, 顶点着色器不再逐顶点求逆
+  m_normals.resize(m_transforms.size());
+  normalMatrices(m_transforms, m_normals);
+
+  auto transformBytes = m_transforms.size() * sizeof(glm::mat4);
+  auto bytes = transformBytes + m_normals.size() * sizeof(glm::mat3);
+  if (m_ring) {
+    if (auto allocation = m_ring->allocate(bytes); allocation.data) {
+      auto *out = static_cast<std::byte *>(allocation.data);
+      std::memcpy(out, m_transforms.data(), transformBytes);
+      std::memcpy(out + transformBytes, m_normals.data(),
+                  bytes - transformBytes);
+      m_ring->commit();
+      m_sourceBuffer = m_ring->buffer();
+      m_sourceOffset = static_cast<std::size_t>(allocation.offset);
+      return;
+    }
+  }
+  // 自己的缓冲: 先孤立旧存储, 避免等待上一帧仍在使用的缓冲
+  m_sourceBuffer = m_instanceVBO;
+  m_sourceOffset = 0;
+  glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+  if (bytes > m_capacity) {
+    m_capacity = std::max(bytes, m_capacity * 2);
+  }
+  glBufferData(GL_ARRAY_BUFFER, m_capacity, nullptr, GL_STREAM_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, transformBytes, m_transforms.data());
+  glBufferSubData(GL_ARRAY_BUFFER, transformBytes, bytes - transformBytes,
+                  m_normals.data());
+}
+
+void InstanceBatcher::bindInstanceAttributes(GLsizei firstInstance) const {
+  // GL 4.0 没有 baseInstance, 通过属性偏移选择本批次的实例数据
+  glBindBuffer(GL_ARRAY_BUFFER, m_sourceBuffer);
+  auto base = m_sourceOffset +
+              static_cast<std::size_t>(firstInstance) * sizeof(glm::mat4);
+  for (GLuint i{}; i < 4; i++) {
+    glVertexAttribPointer(instanceLocation + i, 4, GL_FLOAT, GL_FALSE,
+                          sizeof(glm::mat4),
+                          (void *)(base + i * sizeof(glm::vec4)));
+  }
+  auto normalBase = m_sourceOffset + m_transforms.size() * sizeof(glm::mat4) +
+                    static_cast<std::size_t>(firstInstance) * sizeof(glm::mat3);
+  for (GLuint i{}; i < 3; i++) {
+    glVertexAttribPointer(normalLocation + i, 3, GL_FLOAT, GL_FALSE,
+                          sizeof(glm::mat3),
+                          (void *)(normalBase + i * sizeof(glm::vec3)));
+  }
+}
+
+namespace {
+constexpr auto anyMaterial = ~std::uint32_t{};
+} // namespace
+
+void InstanceBatcher::draw() const { drawBatches(anyMaterial); }
+
+void InstanceBatcher::draw(std::uint32_t material) const {
+  drawBatches(material);
+}
+
+void InstanceBatcher::drawBatches(std::uint32_t only) const {
+  constexpr auto none = ~std::uint32_t{};
+  auto boundMesh = none, boundMaterial = none;
+  for (const auto &batch : m_batches) {
+    if (only != anyMaterial && batch.material != only) {
+      continue;
+    }
+    const auto &mesh = m_meshes[batch.mesh];
+    if (batch.material != boundMaterial) {
+      const auto &material = m_materials[batch.material];
+      material.shader->use();
+      for (std::size_t unit{}; unit < material.textures.size(); unit++) {
+        if (material.textures[unit]) {
+          glActiveTexture(GL_TEXTURE0 + unit);
+          glBindTexture(GL_TEXTURE_2D,
+                        m_resources->texture(material.textures[unit]));
+        }
+      }
+      boundMaterial = batch.material;
+    }
+    if (batch.mesh != boundMesh) {
+      glBindVertexArray(mesh.VAO);
+      boundMesh = batch.mesh;
+    }
+    bindInstanceAttributes(batch.first);
+    if (mesh.indexed) {
+      glDrawElementsInstanced(GL_TRIANGLES, mesh.count, GL_UNSIGNED_INT, 0,
+                              batch.count);
+    } else {
+      glDrawArraysInstanced(GL_TRIANGLES, mesh.first, mesh.count, batch.count);
+    }
+  }
+  glActiveTexture(GL_TEXTURE0);
+  glBindVertexArray(0);
+}
+
+void InstanceBatcher::clear() {
+  m_instances.clear();
+  m_batches.clear();
+  m_transforms.clear();
+  m_normals.clear();
+}
+} // namespace cg
@@ -0,0 +1,358 @@
+#include <jobs.hpp>
+
+#include <frame_arena.hpp>
+
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <span>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace cg {
+namespace detail {
+struct Job {
+  JobSystem::Function function;
+  JobCounter *done;
+  // parallelFor 的块: block 不为空时代替 function, 作业对象归调用者所有
+  JobSystem::BlockFunction block{};
+  void *context{};
+  std::size_t begin{}, end{};
+};
+} // namespace detail
+
+namespace {
+thread_local const JobSystem *currentSystem{};
+thread_local int currentIndex{-1};
+
+// 空闲时先自旋若干次再睡眠, 避免帧内短暂的空档也要走一次唤醒
+constexpr int spinCount = 64;
+
+// 绑定失败 (如受 cgroup 或容器的 CPU 限制) 时只输出原因, 线程照常运行
+void pinToCore(unsigned core) {
+#if defined(_WIN32)
+  if (core < 64 &&
+      !SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR{1} << core)) {
+    std::cerr << "Failed to pin thread to core " << core << ": error "
+              << GetLastError() << std::endl;
+  }
+#elif defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core, &set);
+  if (auto error = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+      error != 0) {
+    std::cerr << "Failed to pin thread to core " << core << ": "
+              << std::strerror(error) << std::endl;
+  }
+#else
+  (void)core;
+#endif
+}
+} // namespace
+
+/**
+ * @brief 固定容量的 Chase-Lev 双端队列
+ * push/pop 只能由所属线程调用, steal 可由任意线程调用
+ */
+class JobSystem::Deque {
+public:
+  static constexpr std::int64_t capacity = 4096;
+
+  // 队列满时返回 false
+  bool push(detail::Job *job) {
+    auto bottom = m_bottom.load(std::memory_order_relaxed);
+    auto top = m_top.load(std::memory_order_acquire);
+    if (bottom - top >= capacity) {
+      return false;
+    }
+    m_buffer[bottom & (capacity - 1)].store(job, std::memory_order_relaxed);
+    m_bottom.store(bottom + 1, std::memory_order_release);
+    return true;
+  }
+
+  detail::Job *pop() {
+    auto bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto top = m_top.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      m_bottom.store(bottom + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+    auto *job = m_buffer[bottom & (capacity - 1)].load(
+        std::memory_order_relaxed);
+    if (top == bottom) {
+      // 只剩最后一个, 与窃取者竞争
+      if (!m_top.compare_exchange_strong(top, top + 1,
+                                         std::memory_order_seq_cst,
+                                         std::memory_order_relaxed)) {
+        job = nullptr;
+      }
+      m_bottom.store(bottom + 1, std::memory_order_relaxed);
+    }
+    return job;
+  }
+
+  detail::Job *steal() {
+    auto top = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto bottom = m_bottom.load(std::memory_order_acquire);
+    if (top >= bottom) {
+      return nullptr;
+    }
+    auto *job = m_buffer[top & (capacity - 1)].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed)) {
+      return nullptr;
+    }
+    return job;
+  }
+
+private:
+  alignas(64) std::atomic<std::int64_t> m_top{0};
+  alignas(64) std::atomic<std::int64_t> m_bottom{0};
+  std::array<std::atomic<detail::Job *>, capacity> m_buffer{};
+};
+
+JobSystem::JobSystem(unsigned workers)
+    : m_cores{std::max(1u, std::thread::hardware_concurrency())} {
+  auto cores = m_cores;
+  if (workers == 0) {
+    workers = cores - 1;
+  }
+  for (unsigned i{}; i < workers; i++) {
+    m_deques.push_back(std::make_unique<Deque>());
+  }
+  for (unsigned i{}; i < workers; i++) {
+    m_workers.emplace_back([this, i, cores] {
+      // 0 号核心留给 GL 线程
+      if (cores > 1) {
+        pinToCore(1 + i % (cores - 1));
+      }
+      workerLoop(i);
+    });
+  }
+}
+
+JobSystem::~JobSystem() {
+  m_stop.store(true);
+  m_signal.fetch_add(1);
+  m_signal.notify_all();
+  m_workers.clear();
+  for (auto *job : m_inject) {
+    delete job;
+  }
+}
+
+JobSystem &JobSystem::shared() {
+  static JobSystem system;
+  return system;
+}
+
+void JobSystem::pinCallingThread() const {
+  if (m_cores > 1 && !m_workers.empty()) {
+    pinToCore(0);
+  }
+}
+
+int JobSystem::currentWorker() const {
+  return currentSystem == this ? currentIndex : -1;
+}
+
+void JobSystem::run(Function function, JobCounter *done, JobCounter *after) {
+  if (done) {
+    done->m_pending.fetch_add(1, std::memory_order_relaxed);
+  }
+  auto *job = new detail::Job{std::move(function), done};
+  if (after) {
+    // 与 execute 中的归零处理在同一把锁下检查, 不会漏掉唤醒
+    std::lock_guard lock{after->m_mutex};
+    if (!after->done()) {
+      after->m_waiting.push_back(job);
+      return;
+    }
+  }
+  submit(job);
+}
+
+void JobSystem::forBlocks(std::size_t begin, std::size_t end,
+                          std::size_t grain, BlockFunction function,
+                          void *context) {
+  // 调用者等所有块完成才返回, 作业对象可以放在栈上, 块数较多时放在
+  // 当前线程的帧内存中
+  constexpr std::size_t inlineJobs = 32;
+  std::array<detail::Job, inlineJobs> local;
+  FrameVector<detail::Job> overflow;
+  std::span<detail::Job> jobs{local};
+  auto blocks = (end - begin - 1) / grain;
+  if (blocks > inlineJobs) {
+    overflow.resize(blocks);
+    jobs = overflow;
+  }
+  JobCounter counter;
+  std::size_t k{};
+  for (auto block = begin + grain; block < end; block += grain, k++) {
+    auto &job = jobs[k];
+    job.done = &counter;
+    job.block = function;
+    job.context = context;
+    job.begin = block;
+    job.end = std::min(end, block + grain);
+    counter.m_pending.fetch_add(1, std::memory_order_relaxed);
+    submit(&job);
+  }
+  function(context, begin, begin + grain);
+  wait(counter);
+}
+
+void JobSystem::submit(detail::Job *job) {
+  if (m_workers.empty()) {
+    execute(job);
+    return;
+  }
+  auto worker = currentWorker();
+  if (worker < 0 || !m_deques[worker]->push(job)) {
+    std::lock_guard lock{m_injectMutex};
+    m_inject.push_back(job);
+    m_injectSize.fetch_add(1, std::memory_order_release);
+  }
+  m_signal.fetch_add(1, std::memory_order_release);
+  m_signal.notify_one();
+}
+
+detail::Job *JobSystem::next(int worker) {
+  if (worker >= 0) {
+    if (auto *job = m_deques[worker]->pop()) {
+      return job;
+    }
+  }
+  if (m_injectSize.load(std::memory_order_acquire) > 0) {
+    std::lock_guard lock{m_injectMutex};
+    if (!m_inject.empty()) {
+      auto *job = m_inject.back();
+      m_inject.pop_back();
+      m_injectSize.fetch_sub(1, std::memory_order_relaxed);
+      return job;
+    }
+  }
+  // 从下一个线程开始轮流窃取
+  auto count = m_deques.size();
+  auto start = static_cast<std::size_t>(worker + 1);
+  for (std::size_t k{}; k < count; k++) {
+    auto victim = (start + k) % count;
+    if (static_cast<int>(victim) == worker) {
+      continue;
+    }
+    if (auto *job = m_deques[victim]->steal()) {
+      return job;
+    }
+  }
+  return nullptr;
+}
+
+void JobSystem::execute(detail::Job *job) {
+  auto *done = job->done;
+  if (job->block) {
+    // 计数器减一之前调用者不会返回, 此后不能再访问 job
+    job->block(job->context, job->begin, job->end);
+  } else {
+    job->function();
+    delete job;
+  }
+  if (!done) {
+    return;
+  }
+  // 不是最后一个时无锁地减一
+  auto pending = done->m_pending.load(std::memory_order_relaxed);
+  while (pending > 1) {
+    if (done->m_pending.compare_exchange_weak(pending, pending - 1,
+                                              std::memory_order_acq_rel)) {
+      return;
+    }
+  }
+  // 可能是最后一个: 在锁内归零, 等待者析构计数器前会先拿到这把锁,
+  // 解锁之后这里不再访问计数器
+  std::vector<detail::Job *> ready;
+  bool finished{};
+  {
+    std::lock_guard lock{done->m_mutex};
+    if (done->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      ready.swap(done->m_waiting);
+      finished = true;
+    }
+  }
+  for (auto *waiting : ready) {
+    submit(waiting);
+  }
+  if (finished) {
+    // 唤醒可能在 wait 中睡眠的线程
+    m_signal.fetch_add(1, std::memory_order_release);
+    m_signal.notify_all();
+  }
+}
+
+void JobSystem::wait(JobCounter &counter) {
+  auto worker = currentWorker();
+  int idle{};
+  while (!counter.done()) {
+    // 自己的队列, 注入队列, 再从其他线程窃取
+    if (auto *job = next(worker)) {
+      execute(job);
+      idle = 0;
+      continue;
+    }
+    if (++idle < spinCount) {
+      std::this_thread::yield();
+      continue;
+    }
+    // 与 workerLoop 相同: 先记下信号再检查, 新的提交和计数器归零都会
+    // 改变信号值
+    auto signal = m_signal.load(std::memory_order_acquire);
+    if (counter.done()) {
+      return;
+    }
+    if (auto *job = next(worker)) {
+      execute(job);
+      idle = 0;
+      continue;
+    }
+    m_signal.wait(signal, std::memory_order_acquire);
+    idle = 0;
+  }
+}
+
+void JobSystem::workerLoop(unsigned index) {
+  currentSystem = this;
+  currentIndex = static_cast<int>(index);
+  int idle{};
+  while (!m_stop.load(std::memory_order_relaxed)) {
+    if (auto *job = next(currentIndex)) {
+      execute(job);
+      idle = 0;
+      continue;
+    }
+    if (++idle < spinCount) {
+      std::this_thread::yield();
+      continue;
+    }
+    // 先记下信号再检查一次, 期间的提交会改变信号值, wait 立即返回
+    auto signal = m_signal.load(std::memory_order_acquire);
+    if (auto *job = next(currentIndex)) {
+      execute(job);
+      idle = 0;
+      continue;
+    }
+    m_signal.wait(signal, std::memory_order_acquire);
+    idle = 0;
+  }
+}
+} // namespace cg
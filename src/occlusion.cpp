@@ -0,0 +1,231 @@
+#include <occlusion.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define CG_OCCLUSION_SSE 1
+#endif
+
+namespace cg {
+OcclusionCuller::OcclusionCuller(int width, int height)
+    : m_width(width), m_height(height), m_stride((width + 3) & ~3),
+      m_depth(static_cast<std::size_t>(m_stride) * height, 1.0f) {
+  // 金字塔: level 0 与深度缓冲同尺寸, 逐级减半直到 1x1
+  for (int w = width, h = height;;) {
+    m_levels.push_back({w, h, std::vector<float>(w * h, 1.0f),
+                        std::vector<float>(w * h, 1.0f)});
+    if (w == 1 && h == 1) {
+      break;
+    }
+    w = std::max(1, (w + 1) / 2);
+    h = std::max(1, (h + 1) / 2);
+  }
+}
+
+void OcclusionCuller::clear() { std::ranges::fill(m_depth, 1.0f); }
+
+void OcclusionCuller::rasterize(const glm::mat4 &mvp,
+                                std::span<const glm::vec3> vertices,
+                                std::span<const std::uint32_t> indices) {
+  auto toScreen = [&](const glm::vec4 &clip) {
+    auto ndc = glm::vec3(clip) / clip.w;
+    return glm::vec3((ndc.x * 0.5f + 0.5f) * m_width,
+                     (ndc.y * 0.5f + 0.5f) * m_height, ndc.z * 0.5f + 0.5f);
+  };
+  for (std::size_t i{}; i + 2 < indices.size(); i += 3) {
+    glm::vec4 clip[3];
+    bool nearClipped = false;
+    for (int k{}; k < 3; k++) {
+      clip[k] = mvp * glm::vec4(vertices[indices[i + k]], 1.0f);
+      nearClipped |= clip[k].z < -clip[k].w;
+    }
+    // 穿过近平面的三角形直接跳过: 少画遮挡体只会让结果更保守
+    if (nearClipped) {
+      continue;
+    }
+    rasterizeTriangle(toScreen(clip[0]), toScreen(clip[1]), toScreen(clip[2]));
+  }
+}
+
+void OcclusionCuller::rasterizeTriangle(glm::vec3 v0, glm::vec3 v1,
+                                        glm::vec3 v2) {
+  auto area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+  if (std::abs(area) < 1e-8f) {
+    return;
+  }
+  // 遮挡体不做背面剔除, 统一成逆时针方便边函数取正
+  if (area < 0.0f) {
+    std::swap(v1, v2);
+    area = -area;
+  }
+  auto minX = std::max(0, static_cast<int>(std::floor(
+                              std::min({v0.x, v1.x, v2.x}) - 0.5f)));
+  auto maxX = std::min(m_width - 1, static_cast<int>(std::ceil(
+                                        std::max({v0.x, v1.x, v2.x}) - 0.5f)));
+  auto minY = std::max(0, static_cast<int>(std::floor(
+                              std::min({v0.y, v1.y, v2.y}) - 0.5f)));
+  auto maxY = std::min(m_height - 1, static_cast<int>(std::ceil(
+                                         std::max({v0.y, v1.y, v2.y}) - 0.5f)));
+  if (minX > maxX || minY > maxY) {
+    return;
+  }
+
+  // 边函数 e_i(x, y) = a_i * x + b_i * y + c_i, 内部为非负
+  auto edge = [](const glm::vec3 &p, const glm::vec3 &q) {
+    return glm::vec3(p.y - q.y, q.x - p.x, p.x * q.y - p.y * q.x);
+  };
+  glm::vec3 e0 = edge(v1, v2), e1 = edge(v2, v0), e2 = edge(v0, v1);
+  // 屏幕空间中 NDC 深度是线性的: z = z0 + (z1 - z0) * b1 + (z2 - z0) * b2
+  auto dz1 = (v1.z - v0.z) / area, dz2 = (v2.z - v0.z) / area;
+  auto zA = e1.x * dz1 + e2.x * dz2;
+  auto zB = e1.y * dz1 + e2.y * dz2;
+  auto zC = v0.z + e1.z * dz1 + e2.z * dz2;
+
+  for (int y = minY; y <= maxY; y++) {
+    auto py = y + 0.5f;
+    auto *row = m_depth.data() + static_cast<std::size_t>(y) * m_stride;
+#ifdef CG_OCCLUSION_SSE
+    // 起点按 4 对齐, 配合 m_stride 保证整组读写都在本行内
+    int x = minX & ~3;
+    const auto lane = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const auto zero = _mm_setzero_ps();
+    const auto last = _mm_set1_ps(static_cast<float>(maxX) + 0.75f);
+    for (; x <= maxX; x += 4) {
+      auto px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lane);
+      auto w0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e0.x), px),
+                           _mm_set1_ps(e0.y * py + e0.z));
+      auto w1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e1.x), px),
+                           _mm_set1_ps(e1.y * py + e1.z));
+      auto w2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(e2.x), px),
+                           _mm_set1_ps(e2.y * py + e2.z));
+      auto inside = _mm_and_ps(
+          _mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)),
+          _mm_and_ps(_mm_cmpge_ps(w2, zero), _mm_cmplt_ps(px, last)));
+      if (_mm_movemask_ps(inside) == 0) {
+        continue;
+      }
+      auto z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zA), px),
+                          _mm_set1_ps(zB * py + zC));
+      auto old = _mm_loadu_ps(row + x);
+      auto nearest = _mm_min_ps(old, z);
+      // inside ? nearest : old
+      _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest),
+                                       _mm_andnot_ps(inside, old)));
+    }
+#else
+    for (int x = minX; x <= maxX; x++) {
+      auto px = x + 0.5f;
+      if (e0.x * px + e0.y * py + e0.z >= 0.0f &&
+          e1.x * px + e1.y * py + e1.z >= 0.0f &&
+          e2.x * px + e2.y * py + e2.z >= 0.0f) {
+        row[x] = std::min(row[x], zA * px + zB * py + zC);
+      }
+    }
+#endif
+  }
+}
+
+void OcclusionCuller::buildHierarchy() {
+  auto &base = m_levels.front();
+  for (int y{}; y < m_height; y++) {
+    std::copy_n(m_depth.data() + static_cast<std::size_t>(y) * m_stride,
+                m_width, base.maxDepth.data() + y * m_width);
+  }
+  base.minDepth = base.maxDepth;
+  for (std::size_t l = 1; l < m_levels.size(); l++) {
+    const auto &src = m_levels[l - 1];
+    auto &dst = m_levels[l];
+    for (int y{}; y < dst.height; y++) {
+      for (int x{}; x < dst.width; x++) {
+        auto x0 = 2 * x, y0 = 2 * y;
+        auto x1 = std::min(x0 + 1, src.width - 1);
+        auto y1 = std::min(y0 + 1, src.height - 1);
+        auto at = [&src](const std::vector<float> &v, int sx, int sy) {
+          return v[sy * src.width + sx];
+        };
+        dst.minDepth[y * dst.width + x] =
+            std::min({at(src.minDepth, x0, y0), at(src.minDepth, x1, y0),
+                      at(src.minDepth, x0, y1), at(src.minDepth, x1, y1)});
+        dst.maxDepth[y * dst.width + x] =
+            std::max({at(src.maxDepth, x0, y0), at(src.maxDepth, x1, y0),
+                      at(src.maxDepth, x0, y1), at(src.maxDepth, x1, y1)});
+      }
+    }
+  }
+}
+
+bool OcclusionCuller::isVisible(const Aabb &box,
+                                const glm::mat4 &viewProjection) const {
+  glm::vec2 lo{std::numeric_limits<float>::max()};
+  glm::vec2 hi{std::numeric_limits<float>::lowest()};
+  float nearest = 1.0f, farthest = 0.0f;
+  for (int corner{}; corner < 8; corner++) {
+    glm::vec3 p{corner & 1 ? box.max.x : box.min.x,
+                corner & 2 ? box.max.y : box.min.y,
+                corner & 4 ? box.max.z : box.min.z};
+    auto clip = viewProjection * glm::vec4(p, 1.0f);
+    // 与近平面相交的包围盒一律视为可见
+    if (clip.z < -clip.w) {
+      return true;
+    }
+    auto ndc = glm::vec3(clip) / clip.w;
+    lo = glm::min(lo, glm::vec2(ndc));
+    hi = glm::max(hi, glm::vec2(ndc));
+    nearest = std::min(nearest, ndc.z * 0.5f + 0.5f);
+    farthest = std::max(farthest, ndc.z * 0.5f + 0.5f);
+  }
+  // 先在浮点域内截断, 避免 w 很小时转 int 溢出
+  auto toPixel = [](float ndc, int size) {
+    auto pixel = (ndc * 0.5f + 0.5f) * size;
+    return static_cast<int>(
+        std::clamp(pixel, -1.0f, static_cast<float>(size)));
+  };
+  auto x0 = std::max(0, toPixel(lo.x, m_width));
+  auto y0 = std::max(0, toPixel(lo.y, m_height));
+  auto x1 = std::min(m_width - 1, toPixel(hi.x, m_width));
+  auto y1 = std::min(m_height - 1, toPixel(hi.y, m_height));
+  if (x0 > x1 || y0 > y1) {
+    return false; // 完全在屏幕外
+  }
+  // 选择让覆盖区域不超过 4x4 个纹素的层级
+  std::size_t level{};
+  while (level + 1 < m_levels.size() &&
+         ((x1 >> level) - (x0 >> level) >= 4 ||
+          (y1 >> level) - (y0 >> level) >= 4)) {
+    level++;
+  }
+  auto scan = [&](std::size_t l, float &minDepth, float &maxDepth) {
+    const auto &hiz = m_levels[l];
+    minDepth = 1.0f;
+    maxDepth = 0.0f;
+    for (int y = y0 >> l; y <= (y1 >> l); y++) {
+      for (int x = x0 >> l; x <= (x1 >> l); x++) {
+        minDepth = std::min(minDepth, hiz.minDepth[y * hiz.width + x]);
+        maxDepth = std::max(maxDepth, hiz.maxDepth[y * hiz.width + x]);
+      }
+    }
+  };
+  // 粗层级: 最多 2x2 个纹素, 快速拒绝或快速接受
+  float minDepth{}, maxDepth{};
+  scan(std::min(level + 1, m_levels.size() - 1), minDepth, maxDepth);
+  if (nearest > maxDepth) {
+    return false;
+  }
+  if (farthest < minDepth) {
+    return true; // 整个对象在所有遮挡体之前
+  }
+  // 细层级: 有一处遮挡体比对象最近点更远, 对象就可能露出来
+  const auto &hiz = m_levels[level];
+  for (int y = y0 >> level; y <= (y1 >> level); y++) {
+    for (int x = x0 >> level; x <= (x1 >> level); x++) {
+      if (hiz.maxDepth[y * hiz.width + x] >= nearest) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+} // namespace cg
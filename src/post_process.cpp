@@ -0,0 +1,199 @@
+#include <post_process.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace cg {
+namespace {
+// 与 quad.fs 中的操作码一致, 0 表示结束
+constexpr std::uint32_t opCode(PostEffect::Type type) {
+  return type == PostEffect::Type::invert ? 1 : 2;
+}
+constexpr int maxFusedOps = 7;
+constexpr std::array<float, 9> edgeDetectKernel{-1, -1, -1, -1, 8,
+                                                -1, -1, -1, -1};
+constexpr std::array<float, 9> sharpenKernel{0, -1, 0, -1, 5, -1, 0, -1, 0};
+} // namespace
+
+BlurTaps linearGaussian(float sigma, int radius) {
+  if (sigma <= 0.0f || radius < 0 ||
+      1 + (radius + 1) / 2 > BlurTaps::maxTaps) {
+    throw std::runtime_error("post process: unsupported blur size");
+  }
+  std::array<float, 2 * BlurTaps::maxTaps> discrete{};
+  auto total = 0.0f;
+  for (int i{}; i <= radius; i++) {
+    discrete[i] = std::exp(-float(i * i) / (2.0f * sigma * sigma));
+    total += i == 0 ? discrete[i] : 2.0f * discrete[i];
+  }
+  BlurTaps taps;
+  taps.weights[0] = discrete[0] / total;
+  taps.count = 1;
+  for (int i = 1; i <= radius; i += 2) {
+    auto a = discrete[i], b = i + 1 <= radius ? discrete[i + 1] : 0.0f;
+    taps.offsets[taps.count] = (i * a + (i + 1) * b) / (a + b);
+    taps.weights[taps.count] = (a + b) / total;
+    taps.count++;
+  }
+  return taps;
+}
+
+PostStack::PostStack(Shader &colorShader, Shader &blurShader,
+                     Shader &kernelShader, GLuint quadVAO)
+    : m_colorShader(colorShader), m_blurShader(blurShader),
+      m_kernelShader(kernelShader),
+      m_offsetsLocation(glGetUniformLocation(blurShader.ID, "offsets")),
+      m_weightsLocation(glGetUniformLocation(blurShader.ID, "weights")),
+      m_kernelLocation(glGetUniformLocation(kernelShader.ID, "kernel")),
+      m_quadVAO(quadVAO) {}
+
+void PostStack::setEffects(std::vector<PostEffect> effects) {
+  std::vector<Step> steps;
+  std::uint32_t pending{};
+  int pendingCount{}, divisor{1};
+  // 以一个颜色阶段输出到 target 分辨率, 顺带执行积累的逐像素操作
+  auto flush = [&](int target) {
+    steps.push_back({Step::Kind::color, target, pending});
+    pending = 0;
+    pendingCount = 0;
+    divisor = target;
+  };
+  for (const auto &effect : effects) {
+    if (effect.perPixel()) {
+      if (pendingCount == maxFusedOps) {
+        flush(divisor);
+      }
+      pending |= opCode(effect.type) << (4 * pendingCount++);
+      continue;
+    }
+    if (effect.divisor != 1 && effect.divisor != 2 && effect.divisor != 4) {
+      throw std::runtime_error("post process: divisor must be 1, 2 or 4");
+    }
+    // 邻域操作的输入与它分辨率相同: 缩小时每级只缩一半, 双线性采样
+    // 正好是 2x2 的盒式滤波
+    if (effect.divisor > divisor) {
+      while (divisor < effect.divisor) {
+        flush(divisor * 2);
+      }
+    } else if (effect.divisor < divisor || pendingCount > 0) {
+      flush(effect.divisor);
+    }
+    if (effect.type == PostEffect::Type::blur) {
+      auto taps = linearGaussian(effect.sigma, effect.radius);
+      steps.push_back({Step::Kind::blurHorizontal, divisor, 0, taps});
+      steps.push_back({Step::Kind::blurVertical, divisor, 0, taps});
+    } else {
+      steps.push_back({Step::Kind::kernel, divisor, 0, {},
+                       effect.type == PostEffect::Type::edgeDetect
+                           ? edgeDetectKernel
+                           : sharpenKernel});
+    }
+  }
+  m_effects = std::move(effects);
+  m_steps = std::move(steps);
+  m_presentOps = pending;
+}
+
+RenderGraph::Resource PostStack::addPasses(RenderGraph &graph,
+                                           RenderGraph::Resource input) const {
+  // createTexture 会改变资源表, 先复制输入的描述
+  const auto base = graph.desc(input);
+  auto current = input;
+  for (std::size_t i{}; i < m_steps.size(); i++) {
+    const auto &step = m_steps[i];
+    auto name = "post " + std::to_string(i);
+    auto output = graph.createTexture(
+        name,
+        {std::max(base.width / step.divisor, 1),
+         std::max(base.height / step.divisor, 1), base.format},
+        true);
+    graph
+        .addPass(name,
+                 [this, i, current](const RenderGraph &g) {
+                   draw(g, m_steps[i], current);
+                 })
+        .read(current)
+        .write(output);
+    current = output;
+  }
+  return current;
+}
+
+void PostStack::setPresentOps(const Shader &shader) const {
+  shader.setInt("opCodes", static_cast<GLint>(m_presentOps));
+}
+
+void PostStack::draw(const RenderGraph &graph, const Step &step,
+                     RenderGraph::Resource input) const {
+  auto [width, height] = graph.extent(input);
+  const auto &desc = graph.desc(input);
+  auto size = glm::vec2(desc.width, desc.height);
+  auto extent = glm::vec2(width, height);
+  auto texel = 1.0f / size;
+
+  Shader *shader{};
+  switch (step.kind) {
+  case Step::Kind::color:
+    shader = &m_colorShader;
+    shader->use();
+    shader->setInt("opCodes", static_cast<GLint>(step.opCodes));
+    break;
+  case Step::Kind::blurHorizontal:
+  case Step::Kind::blurVertical:
+    shader = &m_blurShader;
+    shader->use();
+    shader->setVec2("direction", step.kind == Step::Kind::blurHorizontal
+                                     ? glm::vec2(texel.x, 0.0f)
+                                     : glm::vec2(0.0f, texel.y));
+    shader->setInt("tapCount", step.taps.count);
+    glUniform1fv(m_offsetsLocation, step.taps.count, step.taps.offsets.data());
+    glUniform1fv(m_weightsLocation, step.taps.count, step.taps.weights.data());
+    break;
+  case Step::Kind::kernel:
+    shader = &m_kernelShader;
+    shader->use();
+    shader->setVec2("texel", texel);
+    glUniform1fv(m_kernelLocation, static_cast<GLsizei>(step.kernel.size()),
+                 step.kernel.data());
+    break;
+  }
+  // 只采样输入本帧渲染的区域
+  shader->setInt("texture1", 0);
+  shader->setVec2("uvScale", extent / size);
+  shader->setVec2("uvMax", (extent - 0.5f) / size);
+
+  glDisable(GL_BLEND);
+  glDisable(GL_DEPTH_TEST);
+  glDisable(GL_STENCIL_TEST);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, graph.texture(input));
+  glBindVertexArray(m_quadVAO);
+  glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+float PostStack::samplesPerPixel() const {
+  // present 采样一次
+  auto samples = 1.0f;
+  for (const auto &step : m_steps) {
+    auto taps = step.kind == Step::Kind::color    ? 1
+                : step.kind == Step::Kind::kernel ? 9
+                                                  : 2 * step.taps.count - 1;
+    samples += float(taps) / float(step.divisor * step.divisor);
+  }
+  return samples;
+}
+
+float PostStack::naiveSamplesPerPixel() const {
+  auto samples = 1.0f;
+  for (const auto &effect : m_effects) {
+    auto width = 2 * effect.radius + 1;
+    samples += effect.perPixel()                          ? 1.0f
+               : effect.type == PostEffect::Type::blur ? float(width * width)
+                                                       : 9.0f;
+  }
+  return samples;
+}
+} // namespace cg
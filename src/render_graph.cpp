@@ -0,0 +1,304 @@
+#include <render_graph.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace cg {
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::read(Resource resource) {
+  m_graph.validate(resource);
+  m_graph.m_passes[m_pass].reads.push_back(resource);
+  return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::write(Resource resource) {
+  m_graph.validate(resource);
+  m_graph.m_passes[m_pass].writes.push_back(resource);
+  return *this;
+}
+
+RenderGraph::PassBuilder &RenderGraph::PassBuilder::sideEffect() {
+  m_graph.m_passes[m_pass].sideEffect = true;
+  return *this;
+}
+
+RenderGraph::~RenderGraph() {
+  releaseFramebuffers();
+  releaseTextures();
+}
+
+RenderGraph::Resource RenderGraph::createTexture(std::string name,
+                                                 const TextureDesc &desc,
+                                                 bool dynamicResolution) {
+  // 提前检查格式, 错误出现在声明处而不是 compile 中
+  RenderTargetPool::bytesOf(desc);
+  m_compiled = false;
+  m_resources.push_back({std::move(name), desc, false, dynamicResolution});
+  return static_cast<Resource>(m_resources.size() - 1);
+}
+
+RenderGraph::Resource RenderGraph::backbuffer(GLsizei width, GLsizei height) {
+  m_compiled = false;
+  m_resources.push_back({"backbuffer", {width, height, GL_RGBA8}, true});
+  return static_cast<Resource>(m_resources.size() - 1);
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass(std::string name,
+                                              Execute execute) {
+  m_compiled = false;
+  m_passes.push_back({std::move(name), std::move(execute)});
+  return {*this, m_passes.size() - 1};
+}
+
+void RenderGraph::validate(Resource resource) const {
+  if (resource >= m_resources.size()) {
+    throw std::runtime_error("render graph: unknown resource");
+  }
+}
+
+void RenderGraph::compile() {
+  releaseFramebuffers();
+  m_order.clear();
+  // 从最后一个阶段往前: 写入输出或被后续阶段用到的资源的阶段才保留.
+  // 写入保留原有内容, 所以被保留的阶段写入的资源同样需要之前的写入者
+  std::vector<bool> needed(m_resources.size()), kept(m_passes.size());
+  for (auto p = m_passes.size(); p-- > 0;) {
+    const auto &pass = m_passes[p];
+    auto keep = pass.sideEffect ||
+                std::ranges::any_of(pass.writes, [&](Resource resource) {
+                  return m_resources[resource].backbuffer || needed[resource];
+                });
+    if (!keep) {
+      continue;
+    }
+    kept[p] = true;
+    for (auto resource : pass.reads) {
+      needed[resource] = true;
+    }
+    for (auto resource : pass.writes) {
+      needed[resource] = true;
+    }
+  }
+  // 依赖都来自声明顺序, 因此声明顺序就是一个合法的拓扑序
+  constexpr auto unused = std::numeric_limits<std::size_t>::max();
+  std::vector<std::size_t> firstUse(m_resources.size(), unused),
+      lastUse(m_resources.size());
+  std::vector<bool> written(m_resources.size());
+  auto touch = [&](Resource resource) {
+    firstUse[resource] = std::min(firstUse[resource], m_order.size());
+    lastUse[resource] = m_order.size();
+  };
+  for (std::size_t p{}; p < m_passes.size(); p++) {
+    if (!kept[p]) {
+      continue;
+    }
+    const auto &pass = m_passes[p];
+    for (auto resource : pass.reads) {
+      const auto &node = m_resources[resource];
+      if (node.backbuffer || !written[resource]) {
+        throw std::runtime_error("render graph: pass " + pass.name +
+                                 " reads " + node.name +
+                                 " before it is written");
+      }
+      if (std::ranges::find(pass.writes, resource) != pass.writes.end()) {
+        throw std::runtime_error("render graph: pass " + pass.name +
+                                 " reads and writes " + node.name);
+      }
+      touch(resource);
+    }
+    for (auto resource : pass.writes) {
+      written[resource] = true;
+      touch(resource);
+    }
+    m_order.push_back(p);
+  }
+  allocateTextures(firstUse, lastUse);
+  createFramebuffers();
+  m_compiled = true;
+}
+
+void RenderGraph::allocateTextures(const std::vector<std::size_t> &firstUse,
+                                   const std::vector<std::size_t> &lastUse) {
+  // 先把上一次的纹理还给池, 描述不变的目标在下面被原样取回
+  releaseTextures();
+  std::vector<Resource> transient;
+  for (Resource r{}; r < m_resources.size(); r++) {
+    m_resources[r].physical = -1;
+    if (!m_resources[r].backbuffer &&
+        firstUse[r] != std::numeric_limits<std::size_t>::max()) {
+      transient.push_back(r);
+    }
+  }
+  std::ranges::stable_sort(transient, {},
+                           [&](Resource r) { return firstUse[r]; });
+  // 按第一次使用的顺序分配: 同一描述且已经不再使用的纹理直接复用
+  for (auto r : transient) {
+    auto &node = m_resources[r];
+    auto first = static_cast<std::ptrdiff_t>(firstUse[r]);
+    auto it = std::ranges::find_if(m_textures, [&](const PhysicalTexture &t) {
+      return t.desc == node.desc && t.busyUntil < first;
+    });
+    if (it == m_textures.end()) {
+      m_textures.push_back({m_targets.acquire(node.desc), node.desc, -1});
+      it = std::prev(m_textures.end());
+    }
+    it->busyUntil = static_cast<std::ptrdiff_t>(lastUse[r]);
+    node.physical = std::distance(m_textures.begin(), it);
+  }
+}
+
+void RenderGraph::releaseTextures() {
+  for (const auto &texture : m_textures) {
+    m_targets.release(texture.id);
+  }
+  m_textures.clear();
+}
+
+void RenderGraph::createFramebuffers() {
+  for (auto p : m_order) {
+    auto &pass = m_passes[p];
+    pass.bindsFramebuffer = !pass.writes.empty();
+    if (!pass.bindsFramebuffer) {
+      continue;
+    }
+    const auto &first = m_resources[pass.writes.front()];
+    // 视口取第一个写入的资源, 其余附件必须一样大
+    for (auto resource : pass.writes) {
+      const auto &node = m_resources[resource];
+      if (node.desc.width != first.desc.width ||
+          node.desc.height != first.desc.height ||
+          node.dynamicResolution != first.dynamicResolution) {
+        throw std::runtime_error("render graph: pass " + pass.name +
+                                 " writes targets of different sizes");
+      }
+    }
+    if (first.backbuffer) {
+      if (pass.writes.size() > 1) {
+        throw std::runtime_error("render graph: pass " + pass.name +
+                                 " mixes the backbuffer with textures");
+      }
+      pass.framebuffer = 0;
+      continue;
+    }
+    glGenFramebuffers(1, &pass.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+    std::array<GLenum, 8> drawBuffers{};
+    GLsizei colorCount{};
+    for (auto resource : pass.writes) {
+      const auto &node = m_resources[resource];
+      if (node.backbuffer) {
+        throw std::runtime_error("render graph: pass " + pass.name +
+                                 " mixes the backbuffer with textures");
+      }
+      auto attachment = RenderTargetPool::depthAttachment(node.desc.format);
+      if (attachment == GL_NONE) {
+        if (colorCount == static_cast<GLsizei>(drawBuffers.size())) {
+          throw std::runtime_error("render graph: pass " + pass.name +
+                                   " writes too many color targets");
+        }
+        attachment = GL_COLOR_ATTACHMENT0 + colorCount;
+        drawBuffers[colorCount++] = attachment;
+      }
+      glFramebufferTexture2D(GL_FRAMEBUFFER, attachment,
+                             RenderTargetPool::textureTarget(node.desc),
+                             texture(resource), 0);
+    }
+    if (colorCount > 0) {
+      glDrawBuffers(colorCount, drawBuffers.data());
+    } else {
+      glDrawBuffer(GL_NONE);
+      glReadBuffer(GL_NONE);
+    }
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      std::cerr << "error::framebuffer:: render graph pass " << pass.name
+                << " is not complete!" << std::endl;
+    }
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void RenderGraph::releaseFramebuffers() {
+  for (auto &pass : m_passes) {
+    if (pass.framebuffer) {
+      glDeleteFramebuffers(1, &pass.framebuffer);
+      pass.framebuffer = 0;
+    }
+    pass.bindsFramebuffer = false;
+  }
+}
+
+void RenderGraph::execute() const {
+  if (!m_compiled) {
+    throw std::runtime_error("render graph: execute before compile");
+  }
+  for (auto p : m_order) {
+    const auto &pass = m_passes[p];
+    if (pass.bindsFramebuffer) {
+      auto [width, height] = extent(pass.writes.front());
+      glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+      glViewport(0, 0, width, height);
+    }
+    pass.execute(*this);
+  }
+}
+
+void RenderGraph::reset() {
+  releaseFramebuffers();
+  m_passes.clear();
+  m_resources.clear();
+  m_order.clear();
+  m_compiled = false;
+}
+
+void RenderGraph::setRenderScale(float scale) {
+  m_renderScale = std::clamp(scale, 1.0f / 16.0f, 1.0f);
+}
+
+GLuint RenderGraph::texture(Resource resource) const {
+  validate(resource);
+  auto physical = m_resources[resource].physical;
+  return physical >= 0 ? m_textures[physical].id : 0;
+}
+
+const RenderGraph::TextureDesc &RenderGraph::desc(Resource resource) const {
+  validate(resource);
+  return m_resources[resource].desc;
+}
+
+RenderGraph::Extent RenderGraph::extent(Resource resource) const {
+  validate(resource);
+  const auto &node = m_resources[resource];
+  if (!node.dynamicResolution) {
+    return {node.desc.width, node.desc.height};
+  }
+  auto scale = [&](GLsizei size) {
+    return std::max<GLsizei>(
+        1, static_cast<GLsizei>(std::lround(size * m_renderScale)));
+  };
+  return {scale(node.desc.width), scale(node.desc.height)};
+}
+
+std::size_t RenderGraph::textureBytes() const {
+  return std::transform_reduce(
+      m_textures.begin(), m_textures.end(), std::size_t{}, std::plus<>{},
+      [](const PhysicalTexture &texture) {
+        return RenderTargetPool::bytesOf(texture.desc);
+      });
+}
+
+std::size_t RenderGraph::requestedBytes() const {
+  return std::transform_reduce(m_resources.begin(), m_resources.end(),
+                               std::size_t{}, std::plus<>{},
+                               [](const ResourceNode &node) {
+                                 return node.physical >= 0
+                                            ? RenderTargetPool::bytesOf(
+                                                  node.desc)
+                                            : 0;
+                               });
+}
+} // namespace cg
@@ -0,0 +1,180 @@
+#include <render_targets.hpp>
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace cg {
+namespace {
+struct FormatInfo {
+  GLenum internalFormat, format, type;
+  // 每个像素的显存, RGB 格式按驱动通常的 4 字节对齐估算
+  std::size_t bytes;
+};
+constexpr std::array formats{
+    FormatInfo{GL_R8, GL_RED, GL_UNSIGNED_BYTE, 1},
+    FormatInfo{GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE, 4},
+    FormatInfo{GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4},
+    FormatInfo{GL_R16F, GL_RED, GL_HALF_FLOAT, 2},
+    FormatInfo{GL_RGB16F, GL_RGB, GL_HALF_FLOAT, 8},
+    FormatInfo{GL_RGBA16F, GL_RGBA, GL_HALF_FLOAT, 8},
+    FormatInfo{GL_R11F_G11F_B10F, GL_RGB, GL_FLOAT, 4},
+    FormatInfo{GL_R32F, GL_RED, GL_FLOAT, 4},
+    FormatInfo{GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8,
+               4},
+    FormatInfo{GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 4},
+    FormatInfo{GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT, GL_FLOAT, 4},
+};
+
+const FormatInfo &formatInfo(GLenum internalFormat) {
+  auto it = std::ranges::find(formats, internalFormat,
+                              &FormatInfo::internalFormat);
+  if (it == formats.end()) {
+    throw std::runtime_error("render target: unsupported texture format");
+  }
+  return *it;
+}
+
+GLuint makeTexture(const RenderTargetDesc &desc) {
+  const auto &info = formatInfo(desc.format);
+  auto target = RenderTargetPool::textureTarget(desc);
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(target, texture);
+  if (desc.samples > 1) {
+    // 多重采样纹理没有过滤和环绕参数, 只能用 texelFetch 读取或 blit
+    glTexImage2DMultisample(target, desc.samples, desc.format, desc.width,
+                            desc.height, GL_TRUE);
+  } else {
+    glTexImage2D(target, 0, static_cast<GLint>(desc.format), desc.width,
+                 desc.height, 0, info.format, info.type, nullptr);
+    auto depth = RenderTargetPool::depthAttachment(desc.format) != GL_NONE;
+    auto filter = depth ? GL_NEAREST : GL_LINEAR;
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
+  glBindTexture(target, 0);
+  return texture;
+}
+} // namespace
+
+RenderTargetPool::~RenderTargetPool() {
+  for (const auto &target : m_live) {
+    glDeleteTextures(1, &target.id);
+  }
+  for (const auto &target : m_idle) {
+    glDeleteTextures(1, &target.id);
+  }
+}
+
+GLuint RenderTargetPool::acquire(const RenderTargetDesc &desc) {
+  // 同一描述的空闲纹理中取最近放回的一个, 让久未使用的先过期
+  auto it = std::ranges::find(m_idle.rbegin(), m_idle.rend(), desc,
+                              &Target::desc);
+  if (it != m_idle.rend()) {
+    m_live.push_back(*it);
+    m_idle.erase(std::next(it).base());
+    return m_live.back().id;
+  }
+  if (desc.width <= 0 || desc.height <= 0 || desc.samples <= 0) {
+    throw std::runtime_error("render target: invalid size");
+  }
+  m_live.push_back({makeTexture(desc), desc});
+  m_created++;
+  return m_live.back().id;
+}
+
+void RenderTargetPool::release(GLuint texture) {
+  auto it = std::ranges::find(m_live, texture, &Target::id);
+  if (it == m_live.end()) {
+    return;
+  }
+  it->releasedAt = m_frame;
+  m_idle.push_back(*it);
+  *it = m_live.back();
+  m_live.pop_back();
+}
+
+void RenderTargetPool::endFrame() {
+  m_frame++;
+  std::erase_if(m_idle, [&](const Target &target) {
+    if (m_frame - target.releasedAt <= m_maxIdleFrames) {
+      return false;
+    }
+    glDeleteTextures(1, &target.id);
+    return true;
+  });
+}
+
+void RenderTargetPool::trim() {
+  for (const auto &target : m_idle) {
+    glDeleteTextures(1, &target.id);
+  }
+  m_idle.clear();
+}
+
+std::size_t RenderTargetPool::bytes() const {
+  auto sum = [](const std::vector<Target> &targets) {
+    return std::transform_reduce(
+        targets.begin(), targets.end(), std::size_t{}, std::plus<>{},
+        [](const Target &target) { return bytesOf(target.desc); });
+  };
+  return sum(m_live) + sum(m_idle);
+}
+
+GLenum RenderTargetPool::textureTarget(const RenderTargetDesc &desc) {
+  return desc.samples > 1 ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D;
+}
+
+std::size_t RenderTargetPool::bytesOf(const RenderTargetDesc &desc) {
+  return static_cast<std::size_t>(desc.width) * desc.height * desc.samples *
+         formatInfo(desc.format).bytes;
+}
+
+GLenum RenderTargetPool::depthAttachment(GLenum format) {
+  switch (format) {
+  case GL_DEPTH24_STENCIL8:
+    return GL_DEPTH_STENCIL_ATTACHMENT;
+  case GL_DEPTH_COMPONENT24:
+  case GL_DEPTH_COMPONENT32F:
+    return GL_DEPTH_ATTACHMENT;
+  default:
+    formatInfo(format);
+    return GL_NONE;
+  }
+}
+
+void ResizeDebouncer::request(GLsizei width, GLsizei height, double time) {
+  if (width <= 0 || height <= 0) {
+    return;
+  }
+  // 重复报告同一个大小不重新计时, 可以每帧调用
+  auto [lastWidth, lastHeight] =
+      m_pending ? std::pair{m_pendingWidth, m_pendingHeight}
+                : std::pair{m_width, m_height};
+  if (width == lastWidth && height == lastHeight) {
+    return;
+  }
+  m_pendingWidth = width;
+  m_pendingHeight = height;
+  m_requestedAt = time;
+  m_pending = true;
+}
+
+bool ResizeDebouncer::settle(double time, GLsizei &width, GLsizei &height) {
+  if (!m_pending || time - m_requestedAt < m_delay) {
+    return false;
+  }
+  m_pending = false;
+  if (m_pendingWidth == m_width && m_pendingHeight == m_height) {
+    return false;
+  }
+  m_width = width = m_pendingWidth;
+  m_height = height = m_pendingHeight;
+  return true;
+}
+} // namespace cg
@@ -0,0 +1,160 @@
+#include <resources.hpp>
+
+#include <utility>
+
+namespace cg {
+namespace {
+template <typename Pool, typename Delete>
+void eraseAll(Pool &pool, Delete deleteObject) {
+  while (!pool.empty()) {
+    auto last = pool.size() - 1;
+    deleteObject(*(pool.begin() + last));
+    pool.erase(pool.handleAt(last));
+  }
+}
+} // namespace
+
+ResourceManager::~ResourceManager() { clear(); }
+
+TextureHandle ResourceManager::addTexture(GLuint id, GLenum target,
+                                          std::string name) {
+  auto handle = m_textures.emplace(id, target, name);
+  if (!name.empty()) {
+    m_textureNames[std::move(name)] = handle;
+  }
+  return handle;
+}
+
+TextureHandle ResourceManager::findTexture(const std::string &name) const {
+  auto it = m_textureNames.find(name);
+  return it != m_textureNames.end() ? it->second : TextureHandle{};
+}
+
+GLuint ResourceManager::texture(TextureHandle handle) const {
+  const auto *texture = m_textures.get(handle);
+  return texture ? texture->id : 0;
+}
+
+bool ResourceManager::replaceTexture(TextureHandle handle, GLuint id) {
+  auto *texture = m_textures.get(handle);
+  if (!texture) {
+    return false;
+  }
+  if (texture->id != id) {
+    glDeleteTextures(1, &texture->id);
+    texture->id = id;
+  }
+  return true;
+}
+
+void ResourceManager::destroy(TextureHandle handle) {
+  const auto *texture = m_textures.get(handle);
+  if (!texture) {
+    return;
+  }
+  glDeleteTextures(1, &texture->id);
+  if (!texture->name.empty()) {
+    m_textureNames.erase(texture->name);
+  }
+  m_textures.erase(handle);
+}
+
+BufferHandle ResourceManager::addBuffer(GLuint id) {
+  return m_buffers.emplace(id);
+}
+
+GLuint ResourceManager::buffer(BufferHandle handle) const {
+  const auto *buffer = m_buffers.get(handle);
+  return buffer ? buffer->id : 0;
+}
+
+void ResourceManager::destroy(BufferHandle handle) {
+  if (const auto *buffer = m_buffers.get(handle)) {
+    glDeleteBuffers(1, &buffer->id);
+    m_buffers.erase(handle);
+  }
+}
+
+ProgramHandle ResourceManager::addProgram(GLuint id) {
+  return m_programs.emplace(id);
+}
+
+GLuint ResourceManager::program(ProgramHandle handle) const {
+  const auto *program = m_programs.get(handle);
+  return program ? program->id : 0;
+}
+
+bool ResourceManager::replaceProgram(ProgramHandle handle, GLuint id) {
+  auto *program = m_programs.get(handle);
+  if (!program) {
+    return false;
+  }
+  if (program->id != id) {
+    glDeleteProgram(program->id);
+    program->id = id;
+  }
+  return true;
+}
+
+void ResourceManager::destroy(ProgramHandle handle) {
+  if (const auto *program = m_programs.get(handle)) {
+    glDeleteProgram(program->id);
+    m_programs.erase(handle);
+  }
+}
+
+MeshHandle ResourceManager::addMesh(const MeshResource &mesh) {
+  return m_meshes.emplace(mesh);
+}
+
+const MeshResource *ResourceManager::mesh(MeshHandle handle) const {
+  return m_meshes.get(handle);
+}
+
+void ResourceManager::destroy(MeshHandle handle) {
+  const auto *mesh = m_meshes.get(handle);
+  if (!mesh) {
+    return;
+  }
+  glDeleteVertexArrays(1, &mesh->vao);
+  for (auto buffer : mesh->buffers) {
+    destroy(buffer);
+  }
+  m_meshes.erase(handle);
+}
+
+MaterialHandle ResourceManager::addMaterial(MaterialResource material) {
+  return m_materials.emplace(std::move(material));
+}
+
+const MaterialResource *
+ResourceManager::material(MaterialHandle handle) const {
+  return m_materials.get(handle);
+}
+
+MaterialResource *ResourceManager::material(MaterialHandle handle) {
+  return m_materials.get(handle);
+}
+
+void ResourceManager::destroy(MaterialHandle handle) {
+  m_materials.erase(handle);
+}
+
+void ResourceManager::clear() {
+  // 逐个删除而不是重建对象池, 使旧句柄的代数失配
+  eraseAll(m_meshes, [](const MeshResource &mesh) {
+    glDeleteVertexArrays(1, &mesh.vao);
+  });
+  eraseAll(m_buffers, [](const BufferResource &buffer) {
+    glDeleteBuffers(1, &buffer.id);
+  });
+  eraseAll(m_textures, [](const TextureResource &texture) {
+    glDeleteTextures(1, &texture.id);
+  });
+  eraseAll(m_programs, [](const ProgramResource &program) {
+    glDeleteProgram(program.id);
+  });
+  eraseAll(m_materials, [](const MaterialResource &) {});
+  m_textureNames.clear();
+}
+} // namespace cg
@@ -1,25 +1,46 @@
+#include <filesystem>
 #include <fstream>
 #include <glad/glad.h>
 #include <iostream>
 #include <shader.hpp>
 #include <sstream>
 #include <string>
+#include <string_view>
 
 namespace cg {
-Shader::Shader(const char *vertexPath, const char *fragmentPath) {
-  std::string vertexCode{vertexPath}, fragmentCode{fragmentPath};
-  std::ifstream vShaderFile{vertexCode};
-  std::ifstream fShaderFile(fragmentCode);
-  if (!vShaderFile.is_open() || !fShaderFile.is_open()) {
-    std::cout << "Failed to open shader file" << std::endl;
+namespace {
+/**
+ * @brief 读取着色器源码, 把 #include "file" 行替换为该文件的内容
+ * file 相对于当前文件所在的目录, 之后用 #line 恢复原文件的行号
+ */
+std::string readSource(const std::filesystem::path &path) {
+  std::ifstream file{path};
+  if (!file.is_open()) {
+    std::cout << "Failed to open shader file " << path.string() << std::endl;
+    return {};
   }
-  std::stringstream vShaderStream, fShaderStream;
-  vShaderStream << vShaderFile.rdbuf();
-  fShaderStream << fShaderFile.rdbuf();
-  vShaderFile.close();
-  fShaderFile.close();
-  vertexCode = vShaderStream.str();
-  fragmentCode = fShaderStream.str();
+  constexpr std::string_view directive = "#include \"";
+  std::stringstream source;
+  std::string line;
+  for (int number{1}; std::getline(file, line); number++) {
+    if (line.starts_with(directive) && line.size() > directive.size() &&
+        line.back() == '"') {
+      auto name = line.substr(directive.size(),
+                              line.size() - directive.size() - 1);
+      source << readSource(path.parent_path() / name) << "#line "
+             << number + 1 << '\n';
+    } else {
+      source << line << '\n';
+    }
+  }
+  return source.str();
+}
+} // namespace
+
+Shader::Shader(const char *vertexPath, const char *fragmentPath,
+               const char *geometryPath) {
+  auto vertexCode = readSource(vertexPath);
+  auto fragmentCode = readSource(fragmentPath);
   const char *vShaderCode = vertexCode.c_str();
   const char *fShaderCode = fragmentCode.c_str();
 
@@ -47,9 +68,27 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath) {
               << infoLog << std::endl;
   }
 
+  unsigned int geometry{};
+  if (geometryPath) {
+    auto geometryCode = readSource(geometryPath);
+    const char *gShaderCode = geometryCode.c_str();
+    geometry = glCreateShader(GL_GEOMETRY_SHADER);
+    glShaderSource(geometry, 1, &gShaderCode, NULL);
+    glCompileShader(geometry);
+    glGetShaderiv(geometry, GL_COMPILE_STATUS, &success);
+    if (!success) {
+      glGetShaderInfoLog(geometry, 512, NULL, infoLog);
+      std::cout << "ERROR::SHADER::GEOMETRY::COMPILATION_FAILED\n"
+                << infoLog << std::endl;
+    }
+  }
+
   ID = glCreateProgram();
   glAttachShader(ID, vertex);
   glAttachShader(ID, fragment);
+  if (geometryPath) {
+    glAttachShader(ID, geometry);
+  }
   glLinkProgram(ID);
   glGetProgramiv(ID, GL_LINK_STATUS, &success);
   if (!success) {
@@ -59,6 +98,9 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath) {
   }
   glDeleteShader(vertex);
   glDeleteShader(fragment);
+  if (geometryPath) {
+    glDeleteShader(geometry);
+  }
 }
 
 void Shader::use() { glUseProgram(ID); }
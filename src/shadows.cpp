@@ -0,0 +1,314 @@
+#include <shadows.hpp>
+
+#include <algorithm>
+#include <bvh.hpp>
+#include <cmath>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace cg {
+CascadedShadowMap::CascadedShadowMap(int resolution, float shadowDistance,
+                                     float lambda)
+    : m_resolution(resolution), m_shadowDistance(shadowDistance),
+      m_lambda(lambda) {
+  glGenTextures(1, &m_depth);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, m_depth);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, resolution,
+               resolution, cascadeCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT,
+               NULL);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  // 硬件比较, 配合 GL_LINEAR 得到 2x2 的 PCF
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE,
+                  GL_COMPARE_REF_TO_TEXTURE);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+  glGenFramebuffers(1, &m_fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+  glDrawBuffer(GL_NONE);
+  glReadBuffer(GL_NONE);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+CascadedShadowMap::~CascadedShadowMap() {
+  glDeleteFramebuffers(1, &m_fbo);
+  glDeleteTextures(1, &m_depth);
+}
+
+void CascadedShadowMap::update(const glm::mat4 &view, float fovy,
+                               float aspect, float zNear,
+                               const glm::vec3 &lightDirection,
+                               std::uint64_t staticVersion,
+                               const DrawCasters &drawCasters) {
+  auto direction = glm::normalize(lightDirection);
+  auto up = std::abs(direction.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f)
+                                          : glm::vec3(0.0f, 1.0f, 0.0f);
+  // 光源视图只取决于方向, 投影中心在光源空间中对齐
+  auto lightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+  auto cameraToWorld = glm::inverse(view);
+  auto tanY = std::tan(fovy * 0.5f), tanX = tanY * aspect;
+
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  m_rendered = 0;
+  bool cachedRefreshed = false;
+  auto splitNear = zNear;
+  for (int c{}; c < cascadeCount; c++) {
+    auto &cascade = m_cascades[c];
+    auto ratio = float(c + 1) / cascadeCount;
+    auto logSplit = zNear * std::pow(m_shadowDistance / zNear, ratio);
+    auto uniformSplit = zNear + (m_shadowDistance - zNear) * ratio;
+    auto splitFar = m_lambda * logSplit + (1.0f - m_lambda) * uniformSplit;
+
+    // 视锥切片的外接球 (视空间), 半径与相机朝向无关
+    glm::vec3 corners[8];
+    for (int k{}; k < 8; k++) {
+      auto depth = k & 4 ? splitFar : splitNear;
+      corners[k] = {(k & 1 ? 1.0f : -1.0f) * tanX * depth,
+                    (k & 2 ? 1.0f : -1.0f) * tanY * depth, -depth};
+    }
+    glm::vec3 center{0.0f, 0.0f, -(splitNear + splitFar) * 0.5f};
+    float radius{};
+    for (const auto &corner : corners) {
+      radius = std::max(radius, glm::length(corner - center));
+    }
+    radius = std::ceil(radius * 16.0f) / 16.0f;
+    auto lightCenter = glm::vec3(
+        lightView * cameraToWorld * glm::vec4(center, 1.0f));
+    splitNear = splitFar;
+
+    bool cached = c >= firstCachedCascade;
+    if (cached && cascade.valid && cascade.lightDirection == direction &&
+        cascade.staticVersion == staticVersion) {
+      auto offset = glm::abs(lightCenter - cascade.center);
+      if (std::max({offset.x, offset.y, offset.z}) + radius <=
+          cascade.halfSize) {
+        cascade.splitFar = splitFar;
+        continue; // 缓存仍然覆盖当前切片
+      }
+    }
+    if (cached && cachedRefreshed && cascade.valid) {
+      // 超出预算: 沿用旧的投影, 着色器在切片超出覆盖范围时退到下一级
+      cascade.splitFar = splitFar;
+      continue;
+    }
+
+    auto halfSize = cached ? radius * cachePadding : radius;
+    auto texel = 2.0f * halfSize / m_resolution;
+    lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+    lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+    // 光源空间看向 -z, near/far 为沿 -z 的距离
+    auto projection = glm::ortho(
+        lightCenter.x - halfSize, lightCenter.x + halfSize,
+        lightCenter.y - halfSize, lightCenter.y + halfSize,
+        -lightCenter.z - halfSize, -lightCenter.z + halfSize);
+    cascade = {projection * lightView, splitFar, lightCenter,  halfSize,
+               true,                   direction, staticVersion};
+    render(c, drawCasters);
+    cachedRefreshed |= cached;
+  }
+  glDisable(GL_POLYGON_OFFSET_FILL);
+  glDisable(GL_DEPTH_CLAMP);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void CascadedShadowMap::render(int cascade, const DrawCasters &drawCasters) {
+  if (m_rendered == 0) {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, m_resolution, m_resolution);
+    // 光源近平面之前的投射体被钳制到近平面, 深度范围可以只包住外接球
+    glEnable(GL_DEPTH_CLAMP);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+  }
+  glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depth, 0,
+                            cascade);
+  glClear(GL_DEPTH_BUFFER_BIT);
+  drawCasters(m_cascades[cascade].lightViewProjection,
+              cascade >= firstCachedCascade);
+  m_rendered++;
+}
+
+void CascadedShadowMap::bind(const cg::Shader &shader, int unit) const {
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, m_depth);
+  glActiveTexture(GL_TEXTURE0);
+  shader.setInt("shadowMap", unit);
+}
+
+CascadedShadowMap::Block CascadedShadowMap::block() const {
+  Block block{};
+  for (int c{}; c < cascadeCount; c++) {
+    block.lightSpaceMatrices[c] = m_cascades[c].lightViewProjection;
+    block.cascadeSplits[c] = m_cascades[c].splitFar;
+  }
+  return block;
+}
+
+namespace {
+GLuint createShadowTexture(GLenum target, int resolution, int layers) {
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(target, texture);
+  if (target == GL_TEXTURE_2D) {
+    glTexImage2D(target, 0, GL_DEPTH_COMPONENT32F, resolution, resolution, 0,
+                 GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+  } else {
+    glTexImage3D(target, 0, GL_DEPTH_COMPONENT32F, resolution, resolution,
+                 layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+  }
+  glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+  glTexParameteri(target, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+  glTexParameteri(target, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+  glBindTexture(target, 0);
+  return texture;
+}
+} // namespace
+
+LocalShadowMaps::LocalShadowMaps(int cubeResolution, int spotResolution)
+    : m_cubeResolution(cubeResolution), m_spotResolution(spotResolution) {
+  m_pointDepth = createShadowTexture(GL_TEXTURE_CUBE_MAP_ARRAY, cubeResolution,
+                                     6 * maxPointLights);
+  m_spotDepth = createShadowTexture(GL_TEXTURE_2D, spotResolution, 1);
+  glGenFramebuffers(1, &m_fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+  glDrawBuffer(GL_NONE);
+  glReadBuffer(GL_NONE);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+LocalShadowMaps::~LocalShadowMaps() {
+  glDeleteFramebuffers(1, &m_fbo);
+  GLuint textures[] = {m_pointDepth, m_spotDepth};
+  glDeleteTextures(2, textures);
+}
+
+void LocalShadowMaps::setPointLight(int index, const glm::vec3 &position,
+                                    float radius) {
+  auto &light = m_points[index];
+  m_pointCount = std::max(m_pointCount, index + 1);
+  if (light.position != position || light.radius != radius) {
+    light = {position, radius, true};
+  }
+}
+
+void LocalShadowMaps::setSpotLight(const glm::vec3 &position,
+                                   const glm::vec3 &direction,
+                                   float outerAngle, float range) {
+  auto &spot = m_spot;
+  if (spot.position == position && spot.direction == direction &&
+      spot.outerAngle == outerAngle && spot.range == range) {
+    return;
+  }
+  auto forward = glm::normalize(direction);
+  auto up = std::abs(forward.y) > 0.99f ? glm::vec3(1.0f, 0.0f, 0.0f)
+                                        : glm::vec3(0.0f, 1.0f, 0.0f);
+  // 视野略大于外锥, PCF 在锥的边缘不会取到图外
+  auto projection =
+      glm::perspective(2.0f * outerAngle + glm::radians(2.0f), 1.0f,
+                       0.05f, range);
+  spot = {position,
+          direction,
+          outerAngle,
+          range,
+          projection * glm::lookAt(position, position + forward, up),
+          true};
+}
+
+void LocalShadowMaps::invalidate(const Aabb &box) {
+  for (int i{}; i < m_pointCount; i++) {
+    auto &light = m_points[i];
+    if (light.radius > 0.0f &&
+        intersects(Sphere{light.position, light.radius}, box)) {
+      light.dirty = true;
+    }
+  }
+  // 以整个球作为聚光的影响范围, 偏保守
+  if (m_spot.range > 0.0f &&
+      intersects(Sphere{m_spot.position, m_spot.range}, box)) {
+    m_spot.dirty = true;
+  }
+}
+
+void LocalShadowMaps::update(const DrawCasters &drawCasters) {
+  m_rendered = 0;
+  auto pointsDirty = std::any_of(
+      m_points.begin(), m_points.begin() + m_pointCount,
+      [](const PointShadow &light) { return light.dirty && light.radius > 0; });
+  if (!pointsDirty && !m_spot.dirty) {
+    return;
+  }
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+
+  // 立方体的深度由片段着色器写出 (距离 / 半径), 偏移放在采样时处理
+  glViewport(0, 0, m_cubeResolution, m_cubeResolution);
+  // 各面的观察方向与上方向遵循立方体贴图的约定
+  const glm::vec3 faces[6][2] = {
+      {{1.0f, 0.0f, 0.0f}, {0.0f, -1.0f, 0.0f}},
+      {{-1.0f, 0.0f, 0.0f}, {0.0f, -1.0f, 0.0f}},
+      {{0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}},
+      {{0.0f, -1.0f, 0.0f}, {0.0f, 0.0f, -1.0f}},
+      {{0.0f, 0.0f, 1.0f}, {0.0f, -1.0f, 0.0f}},
+      {{0.0f, 0.0f, -1.0f}, {0.0f, -1.0f, 0.0f}}};
+  for (int i{}; i < m_pointCount; i++) {
+    auto &light = m_points[i];
+    if (!light.dirty || light.radius <= 0.0f) {
+      continue;
+    }
+    // 分层附着时 glClear 会清空所有光源, 只逐层清空这个光源的 6 层
+    for (int face{}; face < 6; face++) {
+      glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT,
+                                m_pointDepth, 0, 6 * i + face);
+      glClear(GL_DEPTH_BUFFER_BIT);
+    }
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_pointDepth, 0);
+    Pass pass{{light.position, light.radius}, true, {}, 6 * i};
+    auto projection =
+        glm::perspective(glm::radians(90.0f), 1.0f, 0.05f, light.radius);
+    for (int face{}; face < 6; face++) {
+      pass.matrices[face] =
+          projection * glm::lookAt(light.position,
+                                   light.position + faces[face][0],
+                                   faces[face][1]);
+    }
+    drawCasters(pass);
+    light.dirty = false;
+    m_rendered++;
+  }
+
+  if (m_spot.dirty) {
+    glViewport(0, 0, m_spotResolution, m_spotResolution);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_spotDepth, 0);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+    Pass pass{{m_spot.position, m_spot.range}, false, {}, 0};
+    pass.matrices[0] = m_spot.lightViewProjection;
+    drawCasters(pass);
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    m_spot.dirty = false;
+    m_rendered++;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void LocalShadowMaps::bind(const cg::Shader &shader, int unit) const {
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, m_pointDepth);
+  glActiveTexture(GL_TEXTURE0 + unit + 1);
+  glBindTexture(GL_TEXTURE_2D, m_spotDepth);
+  glActiveTexture(GL_TEXTURE0);
+  shader.setInt("pointShadowMaps", unit);
+  shader.setInt("spotShadowMap", unit + 1);
+}
+} // namespace cg
@@ -0,0 +1,99 @@
+#include <transform.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace cg {
+std::uint32_t TransformHierarchy::add(const glm::mat4 &local,
+                                      std::uint32_t parent) {
+  auto node = static_cast<std::uint32_t>(m_parent.size());
+  // 保持先序: 父节点的子树此时必须恰好结束在新节点处
+  if (parent != invalid && m_subtreeEnd[parent] != node) {
+    throw std::runtime_error("parent is not on the current depth-first path");
+  }
+  m_parent.push_back(parent);
+  m_subtreeEnd.push_back(node + 1);
+  for (auto ancestor = parent; ancestor != invalid;
+       ancestor = m_parent[ancestor]) {
+    m_subtreeEnd[ancestor] = node + 1;
+  }
+  m_local.push_back(local);
+  m_world.push_back(local);
+  m_dirty.push_back(1);
+  if (m_dirtyBegin == m_dirtyEnd) {
+    m_dirtyBegin = node;
+  }
+  m_dirtyEnd = node + 1;
+  return node;
+}
+
+void TransformHierarchy::setLocal(std::uint32_t node, const glm::mat4 &local) {
+  m_local[node] = local;
+  m_dirty[node] = 1;
+  if (m_dirtyBegin == m_dirtyEnd) {
+    m_dirtyBegin = node;
+    m_dirtyEnd = node + 1;
+  } else {
+    m_dirtyBegin = std::min<std::size_t>(m_dirtyBegin, node);
+    m_dirtyEnd = std::max<std::size_t>(m_dirtyEnd, node + 1);
+  }
+}
+
+std::size_t TransformHierarchy::nextDirty(std::size_t from,
+                                          std::size_t end) const {
+  auto i = from;
+#if defined(__SSE2__) || defined(_M_X64)
+  // 一次检查 16 个标记
+  const auto zero = _mm_setzero_si128();
+  for (; i + 16 <= end; i += 16) {
+    auto flags = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(m_dirty.data() + i));
+    auto mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(flags, zero)) & 0xffff;
+    if (mask) {
+      return i + std::countr_zero(static_cast<unsigned>(mask));
+    }
+  }
+#endif
+  for (; i < end; i++) {
+    if (m_dirty[i]) {
+      return i;
+    }
+  }
+  return end;
+}
+
+void TransformHierarchy::update() {
+  m_updated = 0;
+  auto i = m_dirtyBegin;
+  while ((i = nextDirty(i, m_dirtyEnd)) < m_dirtyEnd) {
+    // 整个子树都要重算; 区间内节点的父节点要么在区间之前 (已是最新),
+    // 要么在区间内且已经先算过
+    auto end = m_subtreeEnd[i];
+    for (auto node = i; node < end; node++) {
+      auto parent = m_parent[node];
+      m_world[node] = parent == invalid ? m_local[node]
+                                        : m_world[parent] * m_local[node];
+    }
+    std::memset(m_dirty.data() + i, 0, end - i);
+    m_updated += end - i;
+    i = end;
+  }
+  m_dirtyBegin = m_dirtyEnd = 0;
+}
+
+void TransformHierarchy::clear() {
+  m_parent.clear();
+  m_subtreeEnd.clear();
+  m_local.clear();
+  m_world.clear();
+  m_dirty.clear();
+  m_dirtyBegin = m_dirtyEnd = 0;
+  m_updated = 0;
+}
+} // namespace cg
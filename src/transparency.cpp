@@ -0,0 +1,76 @@
+#include <transparency.hpp>
+
+#include <frame_arena.hpp>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace cg {
+void TransparencyPass::beginAccumulate() {
+  const float zero[] = {0.0f, 0.0f, 0.0f, 0.0f};
+  const float one[] = {1.0f, 1.0f, 1.0f, 1.0f};
+  glClearBufferfv(GL_COLOR, 0, zero);
+  glClearBufferfv(GL_COLOR, 1, one);
+
+  glEnable(GL_DEPTH_TEST);
+  glDepthMask(GL_FALSE);
+  glEnable(GL_BLEND);
+  glBlendFunci(0, GL_ONE, GL_ONE);
+  glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+}
+
+void TransparencyPass::composite(GLuint accum, GLuint reveal,
+                                 cg::Shader &compositeShader, GLuint quadVAO) {
+  glDepthMask(GL_TRUE);
+  glDisable(GL_DEPTH_TEST);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  compositeShader.use();
+  compositeShader.setInt("accumTexture", 0);
+  compositeShader.setInt("revealTexture", 1);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, accum);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, reveal);
+  glBindVertexArray(quadVAO);
+  glDrawArrays(GL_TRIANGLES, 0, 6);
+  glActiveTexture(GL_TEXTURE0);
+  glEnable(GL_DEPTH_TEST);
+}
+
+void sortBackToFront(std::span<const float> viewDepth,
+                     std::vector<std::uint32_t> &order) {
+  constexpr int bits = 11;
+  constexpr std::uint32_t radix = 1u << bits;
+  auto count = viewDepth.size();
+  // 距离非负, 取反后按无符号整数升序即为从远到近
+  // 排序用的临时数组从当前线程的帧内存分配
+  FrameVector<std::uint32_t> keys(count), scratchKeys(count);
+  FrameVector<std::uint32_t> indices(count), scratch(count);
+  for (std::size_t i{}; i < count; i++) {
+    keys[i] = ~std::bit_cast<std::uint32_t>(std::max(viewDepth[i], 0.0f));
+    indices[i] = static_cast<std::uint32_t>(i);
+  }
+  for (int shift{}; shift < 32; shift += bits) {
+    std::array<std::uint32_t, radix> histogram{};
+    for (auto key : keys) {
+      histogram[(key >> shift) & (radix - 1)]++;
+    }
+    std::uint32_t sum{};
+    for (auto &h : histogram) {
+      auto c = h;
+      h = sum;
+      sum += c;
+    }
+    for (std::size_t i{}; i < count; i++) {
+      auto slot = histogram[(keys[i] >> shift) & (radix - 1)]++;
+      scratchKeys[slot] = keys[i];
+      scratch[slot] = indices[i];
+    }
+    keys.swap(scratchKeys);
+    indices.swap(scratch);
+  }
+  order.assign(indices.begin(), indices.end());
+}
+} // namespace cg
@@ -0,0 +1,90 @@
+#include <upload_ring.hpp>
+
+namespace cg {
+UploadRing::UploadRing(std::size_t frameBytes) : m_frameBytes(frameBytes) {
+  auto bytes = static_cast<GLsizeiptr>(frameBytes * framesInFlight);
+  glGenBuffers(1, &m_buffer);
+  // 缓冲对象不区分用途, 借用 GL_COPY_WRITE_BUFFER 创建, 以免改动其他绑定
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+  if (GLAD_GL_VERSION_4_4) {
+    constexpr GLbitfield flags =
+        GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_COPY_WRITE_BUFFER, bytes, nullptr, flags);
+    m_mapped = static_cast<std::byte *>(
+        glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, bytes, flags));
+  } else {
+    glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+UploadRing::~UploadRing() {
+  for (auto fence : m_fences) {
+    if (fence) {
+      glDeleteSync(fence);
+    }
+  }
+  if (m_mapped) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+  glDeleteBuffers(1, &m_buffer);
+}
+
+void UploadRing::beginFrame() {
+  m_head = m_frame * m_frameBytes;
+  auto &fence = m_fences[m_frame];
+  if (!fence) {
+    return;
+  }
+  // 先不等待地查询一次, 只有 GPU 确实落后 framesInFlight 帧时才阻塞
+  auto status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+  if (status == GL_TIMEOUT_EXPIRED) {
+    m_stalls++;
+    do {
+      status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                GLuint64{1'000'000'000});
+    } while (status == GL_TIMEOUT_EXPIRED);
+  }
+  glDeleteSync(fence);
+  fence = nullptr;
+}
+
+void UploadRing::endFrame() {
+  m_fences[m_frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  m_frame = (m_frame + 1) % framesInFlight;
+}
+
+UploadRing::Allocation UploadRing::allocate(std::size_t bytes,
+                                            std::size_t alignment) {
+  auto offset = (m_head + alignment - 1) & ~(alignment - 1);
+  if (offset + bytes > (m_frame + 1) * m_frameBytes) {
+    return {};
+  }
+  m_head = offset + bytes;
+  Allocation allocation{nullptr, static_cast<GLintptr>(offset), bytes};
+  if (m_mapped) {
+    allocation.data = m_mapped + offset;
+    return allocation;
+  }
+  // 该段所在的区域已经过栅栏, 不需要驱动再同步
+  glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+  allocation.data = glMapBufferRange(
+      GL_COPY_WRITE_BUFFER, allocation.offset,
+      static_cast<GLsizeiptr>(bytes),
+      GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT |
+          GL_MAP_UNSYNCHRONIZED_BIT);
+  m_open = allocation.data != nullptr;
+  return allocation;
+}
+
+void UploadRing::commit() {
+  if (m_open) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    m_open = false;
+  }
+}
+} // namespace cg